@@ -0,0 +1,561 @@
+// Standalone benchmark of the image processing kernels of ratognize.
+//
+// Frames are generated by cSyntheticVideo (deterministic for a given seed),
+// so no input video is needed and results are comparable between versions
+// and machines. Each configuration (resolution x number of colors) runs the
+// same DetectFrame() and WriteBlobFile() as ratognize and reports frames per
+// second and ns/pixel of each kernel in JSON format.
+//
+// With --golden the .blobs and .log output of all configurations is saved
+// as reference, with --compare it is checked against the saved reference,
+// so optimized code paths can be validated against the original ones.
+// With --video the frames and matching settings are written as a lossless
+// video and an ini file, to be processed by ratognize itself.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "blob.h"
+#include "color.h"
+#include "compare.h"
+#include "cvutils.h"
+#include "detection.h"
+#include "ini.h"
+#include "light.h"
+#include "log.h"
+#include "output_text.h"
+#include "profiler.h"
+#include "synthetic.h"
+#include "textwriter.h"
+#include "version.h"
+#include "workspace.h"
+
+// settings of a benchmark run
+typedef struct {
+    int frames;                 // number of measured frames per configuration
+    int warmup;                 // number of frames before measurement
+    std::vector<cv::Size> resolutions;
+    std::vector<int> colors;    // number of colors used
+    int rats;
+    int chips;                  // number of colored blobs on each rat
+    double noise;
+    unsigned int seed;
+    cCS cs;                     // processing settings (colors are set by the video)
+    char outputfile[MAXPATH];
+    char goldendir[MAXPATH];    // directory of golden output to write
+    char comparedir[MAXPATH];   // directory of golden output to compare with
+    char videodir[MAXPATH];     // directory of synthetic videos to write
+    double tolerance;           // [pixel]
+} tBenchSettings;
+
+// kernels reported, in the order of processing
+static const int kernels[] = {
+    STAGE_BLUR, STAGE_LED, STAGE_CLASSIFY, STAGE_TILES, STAGE_DETECTRATS, STAGE_RATREGIONS, STAGE_TRACKING,
+    STAGE_FINDHSVBLOBS,
+    STAGE_FILTERMOTION, STAGE_FINDMDBLOBS, STAGE_WRITEBLOBFILE, STAGE_PROCESSFRAME
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// parse comma separated list of resolutions (e.g. 640x480,1920x1080)
+static bool ParseResolutions(const char* str, std::vector<cv::Size>& resolutions) {
+    int w, h, n;
+    resolutions.clear();
+    while (sscanf(str, "%dx%d%n", &w, &h, &n) == 2 && w > 0 && h > 0) {
+        resolutions.push_back(cv::Size(w, h));
+        str += n;
+        if (*str != ',')
+            break;
+        str++;
+    }
+    return *str == 0 && !resolutions.empty();
+}
+
+// parse comma separated list of integers (e.g. 1,3,5)
+static bool ParseIntList(const char* str, std::vector<int>& list, int min, int max) {
+    char* end;
+    list.clear();
+    while (*str) {
+        long l = strtol(str, &end, 10);
+        if (end == str || l < min || l > max)
+            return false;
+        list.push_back((int)l);
+        str = end;
+        if (*str == ',')
+            str++;
+    }
+    return !list.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool ParseArgs(int argc, char *argv[], tBenchSettings* bs) {
+    std::list<cColorSet> mColorDataBase[2];
+    cColor mColor[MAXMBASE];
+    int i;
+
+    // settings of the ini file are overridden by all other arguments
+    for (i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "--inifile") == 0) {
+            strncpy(bs->cs.inifile, argv[i + 1], MAXPATH - 1);
+            if (!ReadIniFile(true, &bs->cs, mColorDataBase, mColor))
+                return false;
+        }
+    }
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--inifile") == 0 && i < argc - 1)
+            i++;
+        else if (strcmp(argv[i], "--frames") == 0 && i < argc - 1)
+            bs->frames = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--warmup") == 0 && i < argc - 1)
+            bs->warmup = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--resolutions") == 0 && i < argc - 1) {
+            if (!ParseResolutions(argv[++i], bs->resolutions)) {
+                LOG_ERROR("Could not parse resolutions '%s'.", argv[i]);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--colors") == 0 && i < argc - 1) {
+            if (!ParseIntList(argv[++i], bs->colors, 1, MAXMBASE)) {
+                LOG_ERROR("Could not parse number of colors '%s' (1-%d).", argv[i], MAXMBASE);
+                return false;
+            }
+        } else if (strcmp(argv[i], "--rats") == 0 && i < argc - 1)
+            bs->rats = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--chips") == 0 && i < argc - 1)
+            bs->chips = std::max(1, std::min(atoi(argv[++i]), MAXMCHIPS));
+        else if (strcmp(argv[i], "--noise") == 0 && i < argc - 1)
+            bs->noise = std::max(atof(argv[++i]), 0.0);
+        else if (strcmp(argv[i], "--seed") == 0 && i < argc - 1)
+            bs->seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--gausssmoothing") == 0 && i < argc - 1)
+            bs->cs.gausssmoothing = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--colorthreads") == 0 && i < argc - 1)
+            bs->cs.colorthreads = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--tilerows") == 0 && i < argc - 1)
+            bs->cs.tilerows = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--ratregions") == 0)
+            bs->cs.bRatRegions = true;
+        else if (strcmp(argv[i], "--trackingwindow") == 0 && i < argc - 1)
+            bs->cs.trackingwindow = std::max(atoi(argv[++i]), 0);
+        else if (strcmp(argv[i], "--trackingfullscan") == 0 && i < argc - 1)
+            bs->cs.trackingfullscan = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--ratdownscale") == 0 && i < argc - 1)
+            bs->cs.ratdownscale = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--nomotion") == 0)
+            bs->cs.bMotionDetection = false;
+        else if (strcmp(argv[i], "--output") == 0 && i < argc - 1)
+            strncpy(bs->outputfile, argv[++i], MAXPATH - 1);
+        else if (strcmp(argv[i], "--golden") == 0 && i < argc - 1)
+            strncpy(bs->goldendir, argv[++i], MAXPATH - 1);
+        else if (strcmp(argv[i], "--compare") == 0 && i < argc - 1)
+            strncpy(bs->comparedir, argv[++i], MAXPATH - 1);
+        else if (strcmp(argv[i], "--tolerance") == 0 && i < argc - 1)
+            bs->tolerance = std::max(atof(argv[++i]), 0.0);
+        else if (strcmp(argv[i], "--video") == 0 && i < argc - 1)
+            strncpy(bs->videodir, argv[++i], MAXPATH - 1);
+        else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            std::cout << "Usage: ratognize_bench [options]" << std::endl <<
+                    "  --frames N          measured frames per configuration (" << bs->frames << ")" << std::endl <<
+                    "  --warmup N          frames processed before measurement (" << bs->warmup << ")" << std::endl <<
+                    "  --resolutions list  e.g. 640x480,1280x720,1920x1080" << std::endl <<
+                    "  --colors list       number of colors used, e.g. 1,3,5" << std::endl <<
+                    "  --rats N            number of rats on the synthetic video (" << bs->rats << ")" << std::endl <<
+                    "  --chips N           colored blobs on each rat (" << bs->chips << ")" << std::endl <<
+                    "  --noise sigma       Gaussian pixel noise (" << bs->noise << ")" << std::endl <<
+                    "  --seed N            random seed of the synthetic video (" << bs->seed << ")" << std::endl <<
+                    "  --inifile file      processing settings (colors are set by the video)" << std::endl <<
+                    "  --gausssmoothing N  Gauss kernel size, 0 - no smoothing (" << bs->cs.gausssmoothing << ")" << std::endl <<
+                    "  --colorthreads N    threads of color blob detection (" << bs->cs.colorthreads << ")" << std::endl <<
+                    "  --tilerows N        rows of a band in tiled detection, 0 - off (" << bs->cs.tilerows << ")" << std::endl <<
+                    "  --ratregions        search colored blobs only around rats" << std::endl <<
+                    "  --trackingwindow N  search colors around last blobs, 0 - off (" << bs->cs.trackingwindow << ")" << std::endl <<
+                    "  --trackingfullscan N  frames between full searches in tracking mode (" << bs->cs.trackingfullscan << ")" << std::endl <<
+                    "  --ratdownscale N    detect rats and motion downscaled by N (" << bs->cs.ratdownscale << ")" << std::endl <<
+                    "  --nomotion          skip motion detection" << std::endl <<
+                    "  --output file       JSON report (default: stdout)" << std::endl <<
+                    "  --golden dir        write .blobs and .log output as reference to dir" << std::endl <<
+                    "  --compare dir       compare .blobs and .log output with reference in dir" << std::endl <<
+                    "  --tolerance t       tolerance of centers and axes [pixel] (" << bs->tolerance << ")" << std::endl <<
+                    "  --video dir         write the synthetic video and a matching ini file to dir" << std::endl;
+            exit(0);
+        } else {
+            LOG_ERROR("Unknown argument '%s'. Try '--help'.", argv[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// file name of golden output or video of a configuration (golden output has
+// the same name as the output of ratognize on the video)
+static std::string GoldenFileName(const char* dir, cv::Size size, int ncolors,
+        const char* ext) {
+    char cc[MAXPATH];
+    snprintf(cc, sizeof(cc), "%s/bench_%dx%d_c%d%s", dir, size.width,
+            size.height, ncolors, ext);
+    return std::string(cc);
+}
+
+// write an ini file with the settings and colors of a configuration, so that
+// ratognize processes the synthetic video the same way as the benchmark
+// (output is written next to the video)
+static bool WriteVideoIniFile(const char* dir, const char* inifile,
+        const char* videofile, cCS* cs, std::list<cColorSet>* mColorDataBase, cColor* mColor) {
+    cTextWriter ofs;
+    cColorSet& colorset = mColorDataBase[NIGHTLIGHT].front();
+    int i;
+
+    if (!ofs.Open(inifile)) {
+        LOG_ERROR("Could not open ini file '%s'.", inifile);
+        return false;
+    }
+    ofs << "# ratognize settings of a ratognize_bench synthetic video\n" <<
+            "inputvideofile=\"" << videofile << "\"\n" <<
+            "outputdirectory=\"" << dir << "/\"\n" <<
+            "bShowVideo=0\nbShowDebugVideo=0\nbWriteVideo=0\nbWriteText=1\n" <<
+            "bProcessImage=1\nbProcessText=0\nbCout=0\nbCin=0\n" <<
+            "bInputVideoIsInterlaced=0\n" <<
+            "gausssmoothing=" << cs->gausssmoothing << "\n" <<
+            "bMotionDetection=" << (int)cs->bMotionDetection << "\n" <<
+            "mdAlpha=" << cs->mdAlpha << "\n" <<
+            "mdThreshold=" << cs->mdThreshold << "\n" <<
+            "mdAreaMin=" << cs->mdAreaMin << "\n" <<
+            "mdAreaMax=" << cs->mdAreaMax << "\n" <<
+            "mRats=" << cs->mRats << "\n" <<
+            "mChips=" << cs->mChips << "\n" <<
+            "mBase=" << cs->mBase << "\n";
+    ofs << "mDiaMin=";
+    for (i = 0; i < MAXMBASE; i++)
+        ofs << cs->mDiaMin[i] << (i < MAXMBASE - 1 ? " " : "\n");
+    ofs << "mDiaMax=";
+    for (i = 0; i < MAXMBASE; i++)
+        ofs << cs->mDiaMax[i] << (i < MAXMBASE - 1 ? " " : "\n");
+    ofs << "mElongationMax=";
+    for (i = 0; i < MAXMBASE; i++)
+        ofs << cs->mElongationMax[i] << (i < MAXMBASE - 1 ? " " : "\n");
+    ofs << "bBlobE=" << (int)cs->bBlobE << "\n" <<
+            "mErodeBlob=" << cs->mErodeBlob << "\n" <<
+            "mDilateBlob=" << cs->mDilateBlob << "\n" <<
+            "mErodeRat=" << cs->mErodeRat << "\n" <<
+            "mDilateRat=" << cs->mDilateRat << "\n" <<
+            "bLED=" << (int)cs->bLED << "\n" <<
+            "LEDdetectionskipfactor=" << cs->LEDdetectionskipfactor << "\n" <<
+            "mLEDPos=" << cs->mLEDPos.x << " " << cs->mLEDPos.y << "\n" <<
+            "mLEDColor=" << (int)cs->mLEDColor.mColorHSV[0] << " " <<
+                    (int)cs->mLEDColor.mColorHSV[1] << " " <<
+                    (int)cs->mLEDColor.mColorHSV[2] << "\n" <<
+            "mLEDRange=" << (int)cs->mLEDColor.mRangeHSV[0] << " " <<
+                    (int)cs->mLEDColor.mRangeHSV[1] << " " <<
+                    (int)cs->mLEDColor.mRangeHSV[2] << "\n" <<
+            "dayssincelastpaint=" << cs->dayssincelastpaint << "\n" <<
+            "colorselectionmethod=" << (int)cs->colorselectionmethod << "\n";
+    for (i = 0; i < MAXMBASE; i++) {
+        ofs << "mUse" << i << "=" << mColor[i].name << " " <<
+                (int)mColor[i].mUse << "\n";
+    }
+    // the same colors for day and night light
+    for (int light = 0; light < 2; light++) {
+        ofs << (light == DAYLIGHT ? "DAYLIGHT" : "NIGHTLIGHT") <<
+                "=2011-10-11_05-11-00 " << colorset.day << "\n";
+        for (i = 0; i < MAXMBASE; i++) {
+            tColor& c = colorset.mColor[i];
+            ofs << "mColorHSV" << i << "=" << (int)c.mColorHSV[0] << " " <<
+                    (int)c.mColorHSV[1] << " " << (int)c.mColorHSV[2] << "\n" <<
+                    "mRangeHSV" << i << "=" << (int)c.mRangeHSV[0] << " " <<
+                    (int)c.mRangeHSV[1] << " " << (int)c.mRangeHSV[2] << "\n";
+        }
+        ofs << "mBGColorHSV=" << (int)colorset.mBGColor.mColorHSV[0] << " " <<
+                (int)colorset.mBGColor.mColorHSV[1] << " " <<
+                (int)colorset.mBGColor.mColorHSV[2] << "\n" <<
+                "mBGRangeHSV=" << (int)colorset.mBGColor.mRangeHSV[0] << " " <<
+                (int)colorset.mBGColor.mRangeHSV[1] << " " <<
+                (int)colorset.mBGColor.mRangeHSV[2] << "\n";
+    }
+    if (!ofs.Close()) {
+        LOG_ERROR("Could not write ini file '%s'.", inifile);
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// run all kernels on the frames of a single configuration,
+// .blobs and .log output is collected in outdat and outlog if not NULL
+static bool RunBenchmark(tBenchSettings* bs, cv::Size size, int ncolors,
+        cTextWriter* outdat, cTextWriter* outlog) {
+    cCS cs = bs->cs;
+    cColor mColor[MAXMBASE];
+    tColor mBGColor;
+    std::list<cColorSet> mColorDataBase[2];
+    tHSVLookup mHSVLookup;
+    cWorkspace workspace;
+    cWorkspace* ws = &workspace;
+    lighttype_t mLight = UNINITIALIZEDLIGHT;
+    cFrame frame;
+    cFrame* f = &frame;
+    cTextWriter framelog, ofsdat;
+    cv::VideoWriter videowriter;
+
+    // settings and colors of the synthetic video
+    cSyntheticVideo video(size, bs->rats, bs->chips, ncolors, bs->noise, bs->seed);
+    cs.bLED = true;
+    cs.LEDdetectionskipfactor = 1;
+    cs.bShowDebugVideo = false;
+    cs.imageROI = cv::Rect(0, 0, 0, 0);
+    video.SetupColors(&cs, mColorDataBase, mColor, &mBGColor);
+    BuildHSVLookup(&mHSVLookup, mColor, &mBGColor);
+    // lossless video and settings for processing the same frames with ratognize
+    if (bs->videodir[0]) {
+        std::string videofile = GoldenFileName(bs->videodir, size, ncolors, ".avi");
+        std::string inifile = GoldenFileName(bs->videodir, size, ncolors, ".ini");
+        if (!WriteVideoIniFile(bs->videodir, inifile.c_str(), videofile.c_str(),
+                &cs, mColorDataBase, mColor))
+            return false;
+        if (!videowriter.open(videofile, cv::VideoWriter::fourcc('F', 'F', 'V', '1'),
+                25, size)) {
+            LOG_ERROR("Could not open video file '%s'.", videofile.c_str());
+            return false;
+        }
+    }
+    ws->Create(size);
+    // same blob capacity as the workspace and the frames of ratognize
+    ws->ReserveBlobs(cs.mRats * 20);
+    f->ReserveBlobs(cs.mRats * 20 * MAXMBASE, cs.mRats * 2);
+    // same precision as WriteBlobFileHeader()
+    ofsdat.SetFixed(1);
+    video.Next(f->inputimage);
+    if (videowriter.isOpened())
+        videowriter.write(f->inputimage);
+    if (cs.bMotionDetection)
+        InitMotionDetection(f, f->inputimage, &cs, ws);
+    // same log records around the frames as in ratognize
+    if (outlog)
+        *outlog << 0 << "\tFIRSTFRAME\n";
+
+    for (f->currentframe = 0; f->currentframe < bs->warmup + bs->frames;
+            f->currentframe++) {
+        // only kernels are measured, not the generation of frames
+        if (f->currentframe == bs->warmup)
+            profiler.Reset();
+        if (f->currentframe) {
+            video.Next(f->inputimage);
+            if (videowriter.isOpened())
+                videowriter.write(f->inputimage);
+        }
+        f->mBlobParticles.clear();
+        f->mMDParticles.clear();
+        f->mRatParticles.clear();
+        framelog.clear();
+        ofsdat.clear();
+
+        {
+            // same stages as ReadNextFrame() and ProcessFrame() of ratognize
+            cStageTimer stagetimer(STAGE_PROCESSFRAME);
+            // the image is smoothed band by band by tiled detection
+            if (!cs.tilerows) {
+                MEASURE_DURATION(STAGE_BLUR, SmoothFrame(f, f->inputimage, &cs));
+            }
+            if (!DetectFrame(f, f->inputimage, framelog, &cs, mColorDataBase,
+                    mColor, &mBGColor, &mHSVLookup, ws, &mLight, 0)) {
+                return false;
+            }
+        }
+        // text output is written to memory only
+        MEASURE_DURATION(STAGE_WRITEBLOBFILE, WriteBlobFile(&cs, ofsdat,
+                f->blobframe, f->mBlobParticles, f->mMDParticles,
+                f->mRatParticles, f->currentframe));
+        if (outdat)
+            *outdat << ofsdat;
+        if (outlog)
+            *outlog << framelog;
+    }
+    if (outlog)
+        *outlog << f->currentframe - 1 << "\tLASTFRAME\n";
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write results of the last configuration
+static void WriteResult(cTextWriter& ofs, cv::Size size, int ncolors,
+        bool bFirst) {
+    char cc[256];
+    size_t i;
+    bool bFirstKernel = true;
+    double pixels = (double)size.width * size.height;
+
+    ofs << (bFirst ? "\n" : ",\n") << "    {\"width\": " << size.width <<
+            ", \"height\": " << size.height << ", \"colors\": " << ncolors <<
+            ", \"kernels\": {";
+    snprintf(cc, sizeof(cc), "%dx%d, %d colors:", size.width, size.height, ncolors);
+    std::cerr << cc << std::endl;
+    for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        cStageStats& s = profiler.stages[kernels[i]];
+        if (!s.count)
+            continue;
+        double mean = (double)s.sum / s.count;
+        ofs << (bFirstKernel ? "\n" : ",\n") << "      \"" << s.name << "\": {" <<
+                "\"fps\": " << (mean > 0 ? 1e9 / mean : 0.0) <<
+                ", \"ns_per_pixel\": " << mean / pixels <<
+                ", \"mean_us\": " << mean / 1e3 <<
+                ", \"p50_us\": " << s.Percentile(50) / 1e3 <<
+                ", \"p99_us\": " << s.Percentile(99) / 1e3 << "}";
+        snprintf(cc, sizeof(cc), "  %-20s %10.1f FPS %8.3f ns/pixel",
+                s.name.c_str(), mean > 0 ? 1e9 / mean : 0.0, mean / pixels);
+        std::cerr << cc << std::endl;
+        bFirstKernel = false;
+    }
+    ofs << "\n    }}";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write output of a configuration as golden output
+static bool WriteGolden(tBenchSettings* bs, cv::Size size, int ncolors,
+        cTextWriter& outdat, cTextWriter& outlog) {
+    cCS cs = bs->cs;
+    cTextWriter ofsdat, ofslog;
+    std::string datfile = GoldenFileName(bs->goldendir, size, ncolors, ".avi.blobs");
+    std::string logfile = GoldenFileName(bs->goldendir, size, ncolors, ".avi.log");
+
+    strncpy(cs.outputdatfile, datfile.c_str(), MAXPATH - 1);
+    if (!WriteBlobFileHeader(&cs, ofsdat) || !ofslog.Open(logfile.c_str())) {
+        LOG_ERROR("Could not open golden output files in '%s'.", bs->goldendir);
+        return false;
+    }
+    ofsdat << outdat;
+    ofslog << "# ratognize_bench golden log, " << RATOGNIZE_DETAILED_VERSION_STRING <<
+            ", seed " << (long long)bs->seed << "\n" << outlog;
+    if (!ofsdat.Close() || !ofslog.Close()) {
+        LOG_ERROR("Could not write golden output files in '%s'.", bs->goldendir);
+        return false;
+    }
+    return true;
+}
+
+// compare output of a configuration with golden output, returns
+// number of differences (frames and log lines), negative on error
+static int CompareGolden(tBenchSettings* bs, cv::Size size, int ncolors,
+        cTextWriter& outdat, cTextWriter& outlog) {
+    std::string datfile = GoldenFileName(bs->comparedir, size, ncolors, ".avi.blobs");
+    std::string logfile = GoldenFileName(bs->comparedir, size, ncolors, ".avi.log");
+    std::ifstream goldendat(datfile.c_str()), goldenlog(logfile.c_str());
+    std::istringstream dat(outdat.str()), log(outlog.str());
+    int i, j;
+
+    if (!goldendat.is_open() || !goldenlog.is_open()) {
+        LOG_ERROR("Could not open golden output '%s' or '%s'.", datfile.c_str(),
+                logfile.c_str());
+        return -1;
+    }
+    std::cout << "Comparing with " << datfile << std::endl;
+    i = CompareBlobStreams(dat, goldendat, bs->tolerance, COMPAREANGLETOLERANCE);
+    j = CompareLogStreams(log, goldenlog, bs->tolerance);
+    if (i < 0)
+        return -1;
+    return i + j;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[]) {
+    tBenchSettings bs;
+    cTextWriter ofs, outdat, outlog;
+    size_t i, j;
+    int n, ndiff = 0;
+    bool bOutput;
+
+    // defaults
+    bs.frames = 200;
+    bs.warmup = 10;
+    bs.resolutions.push_back(cv::Size(640, 480));
+    bs.resolutions.push_back(cv::Size(1280, 720));
+    bs.resolutions.push_back(cv::Size(1920, 1080));
+    bs.colors.push_back(1);
+    bs.colors.push_back(3);
+    bs.colors.push_back(5);
+    bs.rats = 28;
+    bs.chips = 3;
+    bs.noise = 4;
+    bs.seed = 42;
+    bs.cs.gausssmoothing = 3;
+    bs.cs.colorthreads = 0;
+    bs.cs.bMotionDetection = true;
+    bs.outputfile[0] = 0;
+    bs.goldendir[0] = 0;
+    bs.comparedir[0] = 0;
+    bs.videodir[0] = 0;
+    bs.tolerance = COMPARETOLERANCE;
+    if (!ParseArgs(argc, argv, &bs))
+        return -1;
+    bOutput = bs.goldendir[0] || bs.comparedir[0];
+
+    ofs << "{\n";
+    ofs << "  \"version\": \"" << RATOGNIZE_DETAILED_VERSION_STRING << "\",\n";
+    ofs << "  \"opencv\": \"" << CV_VERSION << "\",\n";
+    ofs << "  \"frames\": " << bs.frames << ", \"warmup\": " << bs.warmup <<
+            ", \"rats\": " << bs.rats << ", \"chips\": " << bs.chips <<
+            ", \"noise\": " << bs.noise << ", \"seed\": " << (long long)bs.seed <<
+            ", \"gausssmoothing\": " << bs.cs.gausssmoothing <<
+            ", \"colorthreads\": " << bs.cs.colorthreads <<
+            ", \"tilerows\": " << bs.cs.tilerows <<
+            ", \"ratregions\": " << (bs.cs.bRatRegions ? "true" : "false") <<
+            ", \"trackingwindow\": " << bs.cs.trackingwindow <<
+            ", \"trackingfullscan\": " << bs.cs.trackingfullscan <<
+            ", \"ratdownscale\": " << bs.cs.ratdownscale <<
+            ", \"motiondetection\": " << (bs.cs.bMotionDetection ? "true" : "false") << ",\n";
+    ofs << "  \"results\": [";
+    for (i = 0; i < bs.resolutions.size(); i++) {
+        for (j = 0; j < bs.colors.size(); j++) {
+            outdat.clear();
+            outlog.clear();
+            if (!RunBenchmark(&bs, bs.resolutions[i], bs.colors[j],
+                    bOutput ? &outdat : NULL, bOutput ? &outlog : NULL))
+                return -1;
+            WriteResult(ofs, bs.resolutions[i], bs.colors[j], !i && !j);
+            if (bs.goldendir[0] && !WriteGolden(&bs, bs.resolutions[i],
+                    bs.colors[j], outdat, outlog))
+                return -1;
+            if (bs.comparedir[0]) {
+                n = CompareGolden(&bs, bs.resolutions[i], bs.colors[j], outdat, outlog);
+                if (n < 0)
+                    return -1;
+                ndiff += n;
+            }
+        }
+    }
+    ofs << "\n  ]";
+    if (bs.comparedir[0])
+        ofs << ",\n  \"golden_differences\": " << ndiff;
+    ofs << "\n}\n";
+
+    // write report
+    if (!bs.outputfile[0]) {
+        std::cout << ofs.str();
+        return ndiff ? 1 : 0;
+    }
+    std::string report = ofs.str();
+    ofs.clear();
+    if (!ofs.Open(bs.outputfile)) {
+        LOG_ERROR("Could not open output file '%s'.", bs.outputfile);
+        return -1;
+    }
+    ofs << report;
+    if (!ofs.Close()) {
+        LOG_ERROR("Could not write output file '%s'.", bs.outputfile);
+        return -1;
+    }
+    std::cerr << "Report is written to " << bs.outputfile << std::endl;
+    if (ndiff) {
+        std::cerr << "Output differs from golden output in " << bs.comparedir <<
+                " (" << ndiff << " differences)." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "synthetic.h"
+
+// HSV definitions of the synthetic scene
+static const cv::Scalar BGHSV(0, 30, 60);           // background
+static const cv::Scalar BGRANGEHSV(90, 30, 40);     // (all hues)
+static const cv::Scalar RATHSV(0, 0, 210);          // rat body (no saturation)
+static const cv::Scalar BLOBRANGEHSV(6, 50, 50);    // range of blob colors
+static const cv::Scalar LEDHSV(0, 255, 255);        // LED (red, see ini file)
+static const cv::Scalar LEDRANGEHSV(10, 80, 80);
+
+////////////////////////////////////////////////////////////////////////////////
+cSyntheticVideo::cSyntheticVideo(cv::Size size, int nrats, int nchips,
+        int ncolors, double noise, unsigned int seed) : framenum(0),
+        size(size), nchips(std::min(nchips, MAXMCHIPS)),
+        ncolors(std::max(1, std::min(ncolors, MAXMBASE))), noise(noise),
+        rng(seed) {
+    int i, j;
+
+    // sizes scale with resolution (a rat is ~1/10 of the image height)
+    ratlength = size.height / 10.0;
+    ratwidth = ratlength / 2.5;
+    blobradius = std::max(5, (int)(ratwidth / 4));
+    LEDpos = cv::Point(std::min(120, size.width / 8), std::min(120, size.height / 8));
+    // random initial positions, directions and blob colors
+    rats.resize(nrats);
+    for (i = 0; i < nrats; i++) {
+        tSyntheticRat& rat = rats[i];
+        rat.mCenter.x = rng.uniform(ratlength, size.width - ratlength);
+        rat.mCenter.y = rng.uniform(ratlength, size.height - ratlength);
+        rat.mVelocity.x = rng.uniform(-3.0, 3.0);
+        rat.mVelocity.y = rng.uniform(-3.0, 3.0);
+        rat.mOrientation = rng.uniform(0.0, 180.0);
+        rat.mAngularVelocity = rng.uniform(-2.0, 2.0);
+        for (j = 0; j < MAXMCHIPS; j++)
+            rat.mColors[j] = rng.uniform(0, this->ncolors);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+cv::Scalar cSyntheticVideo::HSVToBGR(cv::Scalar hsv) {
+    cv::Mat pixel(1, 1, CV_8UC3, hsv);
+    cv::cvtColor(pixel, pixel, cv::COLOR_HSV2BGR);
+    cv::Vec3b bgr = pixel.at<cv::Vec3b>(0, 0);
+
+    return cv::Scalar(bgr[0], bgr[1], bgr[2]);
+}
+
+cv::Scalar cSyntheticVideo::BlobHSV(int i) const {
+    // hues are spread evenly, away from the red LED
+    return cv::Scalar(20 + i * 150 / ncolors, 200, 200);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cSyntheticVideo::SetupColors(cCS* cs, std::list<cColorSet>* mColorDataBase,
+        cColor* mColor, tColor* mBGColor) {
+    static const char* names[MAXMBASE] = {"C0", "C1", "C2", "C3", "C4", "C5"};
+    cColorSet colorset;
+    int i;
+
+    cs->mBase = ncolors;
+    cs->mChips = nchips;
+    for (i = 0; i < MAXMBASE; i++) {
+        mColor[i].Reset();
+        mColor[i].mUse = (i < ncolors);
+        strncpy(mColor[i].name, names[i], sizeof(mColor[i].name));
+        colorset.mColor[i].mColorHSV = BlobHSV(i);
+        colorset.mColor[i].mRangeHSV = BLOBRANGEHSV;
+        mColor[i].mColor = colorset.mColor[i];
+        // blobs are eroded and dilated, allow a wide size range
+        cs->mDiaMin[i] = blobradius;
+        cs->mDiaMax[i] = blobradius * 4;
+        cs->mAreaMin[i] = (double)cs->mDiaMin[i] * cs->mDiaMin[i] / 4 * M_PI;
+        cs->mAreaMax[i] = (double)cs->mDiaMax[i] * cs->mDiaMax[i] / 4 * M_PI;
+        cs->mElongationMax[i] = 4;
+    }
+    colorset.mBGColor.mColorHSV = BGHSV;
+    colorset.mBGColor.mRangeHSV = BGRANGEHSV;
+    *mBGColor = colorset.mBGColor;
+    // the same colors for day and night light
+    colorset.day = cs->dayssincelastpaint;
+    for (i = 0; i < 2; i++) {
+        mColorDataBase[i].clear();
+        mColorDataBase[i].push_back(colorset);
+    }
+    // motion and rat blobs
+    cs->mdAreaMin = (int)(ratwidth * ratwidth / 4);
+    cs->mdAreaMax = (int)(ratlength * ratlength * 4);
+    // LED
+    cs->mLEDPos = LEDpos;
+    cs->mLEDColor.mColorHSV = LEDHSV;
+    cs->mLEDColor.mRangeHSV = LEDRANGEHSV;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cSyntheticVideo::Next(cv::Mat& frame) {
+    cv::Scalar rat = HSVToBGR(RATHSV);
+    size_t i;
+    int j;
+
+    frame.create(size, CV_8UC3);
+    frame.setTo(HSVToBGR(BGHSV));
+    // move and draw rats
+    for (i = 0; i < rats.size(); i++) {
+        tSyntheticRat& r = rats[i];
+        if (framenum) {
+            r.mCenter += r.mVelocity;
+            r.mOrientation += r.mAngularVelocity;
+            if (r.mCenter.x < ratlength || r.mCenter.x > size.width - ratlength)
+                r.mVelocity.x = -r.mVelocity.x;
+            if (r.mCenter.y < ratlength || r.mCenter.y > size.height - ratlength)
+                r.mVelocity.y = -r.mVelocity.y;
+        }
+        cv::ellipse(frame, cv::Point(cvRound(r.mCenter.x), cvRound(r.mCenter.y)),
+                cv::Size(cvRound(ratlength / 2), cvRound(ratwidth / 2)),
+                r.mOrientation, 0, 360, rat, -1);
+        // blobs along the body axis
+        double a = r.mOrientation * M_PI / 180;
+        for (j = 0; j < nchips; j++) {
+            double d = (j - (nchips - 1) / 2.0) * 2.5 * blobradius;
+            cv::circle(frame, cv::Point(cvRound(r.mCenter.x + d * cos(a)),
+                    cvRound(r.mCenter.y + d * sin(a))), blobradius,
+                    HSVToBGR(BlobHSV(r.mColors[j])), -1);
+        }
+    }
+    // LED
+    cv::circle(frame, LEDpos, 8, HSVToBGR(LEDHSV), -1);
+    // noise
+    if (noise > 0) {
+        noiseimage.create(size, CV_16SC3);
+        rng.fill(noiseimage, cv::RNG::NORMAL, 0, noise);
+        cv::add(frame, noiseimage, frame, cv::noArray(), CV_8UC3);
+    }
+    framenum++;
+}
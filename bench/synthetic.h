@@ -0,0 +1,59 @@
+#ifndef HEADER_SYNTHETIC
+#define HEADER_SYNTHETIC
+
+#include <list>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "color.h"
+#include "ini.h"
+
+// A rat on the synthetic video: a light ellipse with colored blobs on it.
+typedef struct {
+    cv::Point2d mCenter;        // [pixel]
+    cv::Point2d mVelocity;      // [pixel/frame]
+    double mOrientation;        // [deg]
+    double mAngularVelocity;    // [deg/frame]
+    int mColors[MAXMCHIPS];     // color index of blobs along the body
+} tSyntheticRat;
+
+// Deterministic synthetic video generator for benchmarks: dark background,
+// light rats (ellipses) moving around with colored blobs on their back,
+// a red LED and Gaussian pixel noise. Colors are spread evenly on the hue
+// circle and SetupColors() creates matching color definitions, so that
+// all detection stages have realistic work to do.
+class cSyntheticVideo {
+  public:
+    //! Constructor.
+    cSyntheticVideo(cv::Size size, int nrats, int nchips, int ncolors,
+            double noise, unsigned int seed);
+    //! Destructor.
+    ~cSyntheticVideo() {
+    }
+    // set color definitions, blob sizes and LED position of the video
+    void SetupColors(cCS* cs, std::list<cColorSet>* mColorDataBase,
+            cColor* mColor, tColor* mBGColor);
+    // render the next frame (BGR)
+    void Next(cv::Mat& frame);
+    int framenum;               // number of frames rendered
+
+  private:
+    cv::Size size;
+    int nchips;
+    int ncolors;
+    double noise;               // sigma of Gaussian noise added to all channels
+    double ratlength;           // major axis of rats [pixel]
+    double ratwidth;            // minor axis of rats [pixel]
+    int blobradius;             // radius of colored blobs [pixel]
+    cv::Point LEDpos;
+    cv::RNG rng;
+    std::vector<tSyntheticRat> rats;
+    cv::Mat noiseimage;
+    // BGR color of a HSV color
+    static cv::Scalar HSVToBGR(cv::Scalar hsv);
+    // HSV color of the colored blobs
+    cv::Scalar BlobHSV(int i) const;
+};
+
+#endif
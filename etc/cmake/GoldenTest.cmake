@@ -0,0 +1,99 @@
+# - Golden output test of ratognize, run by ctest
+#
+# Writes the synthetic video of ratognize_bench with a matching ini file,
+# processes it with ratognize and checks the .blobs and .log output against
+# the golden output stored in the source tree, using 'ratognize
+# --compareblobs' and 'ratognize --comparelogs'. Binary blob output
+# (blobfileformat=1) is compared as well, and is converted to text with
+# 'ratognize --convertblobs' and back, which must give the same file.
+# Finally ratognize_bench runs with the same settings and checks that its
+# output is identical to that of ratognize.
+#
+# Usage:
+#  cmake -DBENCH=<ratognize_bench> -DRATOGNIZE=<ratognize> -DINIFILE=<ini file>
+#        -DGOLDENDIR=<golden dir> -DOUTPUTDIR=<output dir>
+#        [-DINILINES=<extra ini lines separated by ;>]
+#        [-DLOGTOLERANCE=<tolerance of log values>] -P GoldenTest.cmake
+#
+# Extra ini lines override the settings written by ratognize_bench, e.g.
+# colorthreads=3. See README.md on how the golden output was created.
+
+set(GOLDENNAME bench_320x240_c5)
+if (NOT LOGTOLERANCE)
+    # motion blob areas of the fixed-point moving average may differ by
+    # a pixel or two from the floating point one of the original version
+    set(LOGTOLERANCE 2)
+endif()
+
+file(REMOVE_RECURSE ${OUTPUTDIR})
+file(MAKE_DIRECTORY ${OUTPUTDIR})
+execute_process(
+    COMMAND ${BENCH} --inifile ${INIFILE} --frames 20 --warmup 0
+            --resolutions 320x240 --colors 5 --video ${OUTPUTDIR}
+            --output ${OUTPUTDIR}/bench.json
+    RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "ratognize_bench failed (${result})")
+endif()
+
+foreach(line ${INILINES})
+    file(APPEND ${OUTPUTDIR}/${GOLDENNAME}.ini "${line}\n")
+endforeach()
+execute_process(
+    COMMAND ${RATOGNIZE} --inifile ${OUTPUTDIR}/${GOLDENNAME}.ini
+    OUTPUT_FILE ${OUTPUTDIR}/ratognize.out
+    RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "ratognize failed (${result}), see ${OUTPUTDIR}/ratognize.out")
+endif()
+
+set(BLOBS ${OUTPUTDIR}/${GOLDENNAME}.avi.blobs)
+if (EXISTS ${BLOBS}.bin)
+    execute_process(
+        COMMAND ${RATOGNIZE} --compareblobs ${BLOBS}.bin
+                ${GOLDENDIR}/${GOLDENNAME}.avi.blobs
+        RESULT_VARIABLE result)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "binary .blobs output differs from golden output")
+    endif()
+    # text version for the checks below, and back to binary
+    foreach(conversion "${BLOBS}.bin;${BLOBS}" "${BLOBS};${BLOBS}.converted.bin")
+        execute_process(
+            COMMAND ${RATOGNIZE} --convertblobs ${conversion}
+            OUTPUT_QUIET
+            RESULT_VARIABLE result)
+        if (NOT result EQUAL 0)
+            message(FATAL_ERROR "could not convert binary .blobs output")
+        endif()
+    endforeach()
+    file(SHA256 ${BLOBS}.bin hash)
+    file(SHA256 ${BLOBS}.converted.bin converted_hash)
+    if (NOT hash STREQUAL converted_hash)
+        message(FATAL_ERROR "binary .blobs output changed by conversion to text and back")
+    endif()
+endif()
+
+execute_process(
+    COMMAND ${RATOGNIZE} --compareblobs ${BLOBS}
+            ${GOLDENDIR}/${GOLDENNAME}.avi.blobs
+    RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR ".blobs output differs from golden output")
+endif()
+
+execute_process(
+    COMMAND ${RATOGNIZE} --comparelogs ${OUTPUTDIR}/${GOLDENNAME}.avi.log
+            ${GOLDENDIR}/${GOLDENNAME}.avi.log ${LOGTOLERANCE}
+    RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR ".log output differs from golden output")
+endif()
+
+execute_process(
+    COMMAND ${BENCH} --inifile ${OUTPUTDIR}/${GOLDENNAME}.ini --frames 20
+            --warmup 0 --resolutions 320x240 --colors 5
+            --compare ${OUTPUTDIR} --tolerance 0 --output ${OUTPUTDIR}/compare.json
+    RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "ratognize_bench output differs from ratognize output")
+endif()
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef ON_LINUX
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "batch.h"
+#include "fileutils.h"
+#include "log.h"
+#include "mappedfile.h"
+#include "textwriter.h"
+
+// video file extensions used when the file list is a directory
+static const char* videoextensions[] = {
+    ".avi", ".mp4", ".m4v", ".mov", ".mkv", ".ts", ".mts", ".mpg", ".mpeg", ".wmv"
+};
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReadFileList(const char* filelist, std::vector<std::string>& files) {
+    cMappedFile ifs;
+    const char *line, *lineend;
+
+    // all video files of a directory
+    if (IsDirectory(filelist)) {
+        std::vector<std::string> extensions(videoextensions, videoextensions +
+                sizeof(videoextensions) / sizeof(videoextensions[0]));
+        if (!ListDirectory(filelist, extensions, files)) {
+            LOG_ERROR("Could not read directory '%s'.", filelist);
+            return false;
+        }
+        return true;
+    }
+    // list of video files
+    if (!ifs.Open(filelist)) {
+        LOG_ERROR("Could not open file list '%s'.", filelist);
+        return false;
+    }
+    while (ifs.NextLine(&line, &lineend)) {
+        // trim whitespace (and windows line ends)
+        while (line < lineend && isspace((unsigned char)*line))
+            line++;
+        while (lineend > line && isspace((unsigned char)lineend[-1]))
+            lineend--;
+        if (line == lineend || *line == '#')
+            continue;
+        files.push_back(std::string(line, lineend));
+    }
+
+    return true;
+}
+
+#ifdef ON_LINUX
+// a video being processed by a worker process
+struct tBatchJob {
+    pid_t pid;
+    int fd;                     // read end of the pipe to get the number of frames
+    size_t index;               // index of the video in the file list
+    std::chrono::steady_clock::time_point start;
+};
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+int RunBatch(cCS* cs, int (*ProcessVideo)(int* nframes)) {
+#ifdef ON_LINUX
+    std::vector<std::string> files;
+    std::vector<tBatchJob> jobs;
+    cTextWriter summary;
+    char summaryfile[MAXPATH];
+    size_t i, next = 0;
+    int nframes, status, nfailed = 0, maxjobs = std::max(cs->batchjobs, 1);
+
+    if (!ReadFileList(cs->filelist, files))
+        return -1;
+    std::cout << "Batch mode: " << files.size() << " videos, " << maxjobs <<
+            " at a time." << std::endl;
+    snprintf(summaryfile, MAXPATH, "%s" BATCHSUMMARYFILE, cs->outputdirectory);
+    if (!summary.Open(summaryfile)) {
+        LOG_ERROR("Could not open batch summary file '%s'.", summaryfile);
+        return -1;
+    }
+    summary << "# video\tstatus\tframes\ttime [s]\tFPS\n";
+    summary.Flush();
+
+    while (next < files.size() || !jobs.empty()) {
+        // start new workers while there are free slots
+        while (next < files.size() && (int)jobs.size() < maxjobs) {
+            tBatchJob job;
+            int fds[2];
+            if (pipe(fds) != 0) {
+                LOG_ERROR("Could not create pipe for worker process.");
+                return -1;
+            }
+            // do not duplicate buffered output in the workers
+            std::cout.flush();
+            fflush(stdout);
+            job.pid = fork();
+            if (job.pid < 0) {
+                LOG_ERROR("Could not create worker process.");
+                close(fds[0]);
+                close(fds[1]);
+                return -1;
+            }
+            // worker: process a single video with the inherited settings
+            if (job.pid == 0) {
+                close(fds[0]);
+                for (i = 0; i < jobs.size(); i++)
+                    close(jobs[i].fd);
+                strncpy(cs->inputvideofile, files[next].c_str(), MAXPATH - 1);
+                nframes = 0;
+                status = ProcessVideo(&nframes);
+                if (write(fds[1], &nframes, sizeof(nframes)) != sizeof(nframes))
+                    status = -1;
+                close(fds[1]);
+                exit(status ? 1 : 0);
+            }
+            close(fds[1]);
+            job.fd = fds[0];
+            job.index = next++;
+            job.start = std::chrono::steady_clock::now();
+            jobs.push_back(job);
+        }
+        // wait for any worker to finish
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            LOG_ERROR("Could not wait for worker processes.");
+            return -1;
+        }
+        for (i = 0; i < jobs.size() && jobs[i].pid != pid; i++);
+        if (i == jobs.size())
+            continue;
+        double t = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - jobs[i].start).count();
+        bool bOK = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (read(jobs[i].fd, &nframes, sizeof(nframes)) != sizeof(nframes))
+            nframes = 0;
+        close(jobs[i].fd);
+        if (!bOK)
+            nfailed++;
+        // summary line of the video
+        std::cout << "[" << jobs[i].index + 1 << "/" << files.size() << "] " <<
+                files[jobs[i].index] << ": " << (bOK ? "OK" : "FAILED") <<
+                ", frames: " << nframes << ", time: " << (int)t << " s" << std::endl;
+        summary << files[jobs[i].index] << "\t" << (bOK ? "OK" : "FAILED") <<
+                "\t" << nframes << "\t" << t << "\t" << (t > 0 ? nframes / t : 0.0) << "\n";
+        summary.Flush();
+        jobs.erase(jobs.begin() + i);
+    }
+    std::cout << "Batch finished: " << files.size() - nfailed << " OK, " <<
+            nfailed << " failed. Summary is written to " << summaryfile << std::endl;
+    summary.Close();
+
+    return nfailed;
+#else
+    LOG_ERROR("Batch mode is only available on Linux.");
+    return -1;
+#endif
+}
@@ -0,0 +1,41 @@
+#ifndef HEADER_BATCH
+#define HEADER_BATCH
+
+#include <string>
+#include <vector>
+
+#include "ini.h"
+
+// file name of the batch summary (in the output directory)
+#define BATCHSUMMARYFILE "ratognize_batch.log"
+
+/**
+ * Read the list of videos to process in batch mode.
+ *
+ * \param filelist  a text file with one video file name in each line
+ *                  (empty lines and lines starting with # are skipped),
+ *                  or a directory, where all video files are used
+ * \param files     the video files (appended)
+ *
+ * \return false on error
+ */
+bool ReadFileList(const char* filelist, std::vector<std::string>& files);
+
+/**
+ * Process all videos of the file list, each in a separate worker process.
+ *
+ * Settings are parsed once by the caller and inherited by the workers,
+ * which set cs->inputvideofile to their own video and call ProcessVideo().
+ * At most cs->batchjobs workers run at the same time. A summary line of
+ * each video (status, frames processed, time) is printed and written to
+ * BATCHSUMMARYFILE in the output directory.
+ *
+ * \param cs            control states structure
+ * \param ProcessVideo  processes cs->inputvideofile, returns 0 on success
+ *                      and sets the number of frames processed
+ *
+ * \return the number of videos that could not be processed, or -1 on error
+ */
+int RunBatch(cCS* cs, int (*ProcessVideo)(int* nframes));
+
+#endif
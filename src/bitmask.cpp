@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <bitset>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "bitmask.h"
+
+// index of the lowest set bit of a nonzero word
+static inline int LowestBit(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i;
+    _BitScanForward64(&i, word);
+    return (int)i;
+#else
+    int i = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+void cBitMask::Create(cv::Size size) {
+    width = size.width;
+    height = size.height;
+    stride = (width + 63) >> 6;
+    words.resize((size_t)height * stride);
+}
+
+void cBitMask::Clear() {
+    std::fill(words.begin(), words.end(), 0);
+}
+
+void cBitMask::FromLabel(cv::Mat &label, unsigned char bits, bool bInvert) {
+    int x, x0, x1, y, w;
+    uint64_t word, invert = bInvert ? ~(uint64_t)0 : 0;
+
+    Create(label.size());
+    for (y = 0; y < height; y++) {
+        const unsigned char* src = label.ptr<unsigned char>(y);
+        uint64_t* dst = Row(y);
+        for (w = 0; w < stride; w++) {
+            x0 = w << 6;
+            x1 = std::min(width, x0 + 64);
+            word = 0;
+            for (x = x0; x < x1; x++)
+                word |= (uint64_t)((src[x] & bits) != 0) << (x - x0);
+            dst[w] = word ^ invert;
+        }
+        dst[stride - 1] &= LastWordMask();
+    }
+}
+
+void cBitMask::FromBinary(cv::Mat &bin) {
+    int x, x0, x1, y, w;
+    uint64_t word;
+
+    Create(bin.size());
+    for (y = 0; y < height; y++) {
+        const unsigned char* src = bin.ptr<unsigned char>(y);
+        uint64_t* dst = Row(y);
+        for (w = 0; w < stride; w++) {
+            x0 = w << 6;
+            x1 = std::min(width, x0 + 64);
+            word = 0;
+            for (x = x0; x < x1; x++)
+                word |= (uint64_t)(src[x] != 0) << (x - x0);
+            dst[w] = word;
+        }
+    }
+}
+
+void cBitMask::ToBinary(cv::Mat &bin) const {
+    int x, x0, x1, y, w;
+    uint64_t word;
+
+    bin.create(Size(), CV_8UC1);
+    for (y = 0; y < height; y++) {
+        const uint64_t* src = Row(y);
+        unsigned char* dst = bin.ptr<unsigned char>(y);
+        for (w = 0; w < stride; w++) {
+            x0 = w << 6;
+            x1 = std::min(width, x0 + 64);
+            word = src[w];
+            for (x = x0; x < x1; x++, word >>= 1)
+                dst[x] = (word & 1) ? 255 : 0;
+        }
+    }
+}
+
+void cBitMask::And(const cBitMask &other) {
+    for (size_t i = 0; i < words.size(); i++)
+        words[i] &= other.words[i];
+}
+
+void cBitMask::Or(const cBitMask &other) {
+    for (size_t i = 0; i < words.size(); i++)
+        words[i] |= other.words[i];
+}
+
+void cBitMask::Not() {
+    uint64_t last = LastWordMask();
+
+    for (size_t i = 0; i < words.size(); i++)
+        words[i] = ~words[i];
+    // keep bits beyond the width zero
+    for (int y = 0; y < height; y++)
+        Row(y)[stride - 1] &= last;
+}
+
+int cBitMask::Count() const {
+    size_t count = 0;
+
+    for (size_t i = 0; i < words.size(); i++)
+        count += std::bitset<64>(words[i]).count();
+    return (int)count;
+}
+
+bool cBitMask::Any(cv::Rect rect) const {
+    rect &= cv::Rect(0, 0, width, height);
+    for (int y = rect.y; y < rect.y + rect.height; y++) {
+        if (NextBit(y, rect.x, true) < rect.x + rect.width)
+            return true;
+    }
+    return false;
+}
+
+int cBitMask::NextBit(int y, int x, bool bSet) const {
+    const uint64_t* row = Row(y);
+    uint64_t invert = bSet ? 0 : ~(uint64_t)0;
+    int w = x >> 6;
+    uint64_t word;
+
+    if (w >= stride)
+        return stride << 6;
+    // skip whole words without the bit searched for
+    word = (row[w] ^ invert) & (~(uint64_t)0 << (x & 63));
+    while (!word) {
+        if (++w >= stride)
+            return stride << 6;
+        word = row[w] ^ invert;
+    }
+    return (w << 6) + LowestBit(word);
+}
@@ -0,0 +1,61 @@
+#ifndef HEADER_BITMASK
+#define HEADER_BITMASK
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+// a binary mask with one bit per pixel: pixel x of row y is bit x % 64 of
+// word x / 64 of the row, bits beyond the width of the mask are always zero
+class cBitMask {
+  public:
+    int width;                  // width of the mask [pixel]
+    int height;                 // height of the mask [pixel]
+    int stride;                 // number of 64-bit words in a row
+    std::vector<uint64_t> words; // the rows of the mask
+    //! Constructor.
+    cBitMask() : width(0), height(0), stride(0) {
+    }
+    //! Destructor.
+    ~cBitMask() {
+    }
+    // set the size of the mask (memory is kept, content is undefined)
+    void Create(cv::Size size);
+    // size of the mask
+    cv::Size Size() const {
+        return cv::Size(width, height);
+    }
+    // words of row y
+    uint64_t* Row(int y) {
+        return &words[(size_t)y * stride];
+    }
+    const uint64_t* Row(int y) const {
+        return &words[(size_t)y * stride];
+    }
+    // mask of the valid bits of the last word of a row
+    uint64_t LastWordMask() const {
+        return (width & 63) ? ((uint64_t)1 << (width & 63)) - 1 : ~(uint64_t)0;
+    }
+    // clear all pixels
+    void Clear();
+    // create from a label image, a pixel is set where any of the given
+    // label bits is set (or none of them with bInvert)
+    void FromLabel(cv::Mat &label, unsigned char bits, bool bInvert = false);
+    // create from a binary image, a pixel is set where it is nonzero
+    void FromBinary(cv::Mat &bin);
+    // convert to a binary image of 0/255 (e.g. for debug display)
+    void ToBinary(cv::Mat &bin) const;
+    // pixelwise operations with a mask of the same size
+    void And(const cBitMask &other);
+    void Or(const cBitMask &other);
+    void Not();
+    // number of set pixels
+    int Count() const;
+    // true if any pixel of the rectangle is set
+    bool Any(cv::Rect rect) const;
+    // first pixel of row y at or after x that is set (or clear if !bSet),
+    // 64 * stride if there is none
+    int NextBit(int y, int x, bool bSet) const;
+};
+
+#endif
@@ -1,10 +1,12 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <algorithm>
 
 #include <opencv2/opencv.hpp>
 
 #include "blob.h"
 #include "cvutils.h"
+#include "profiler.h"
 
 
 void FillParticleFromMoments(cBlob* particle, cv::Moments &moments, bool bSkew) {
@@ -49,130 +51,650 @@ void FillParticleFromMoments(cBlob* particle, cv::Moments &moments, bool bSkew)
     }
 }
 
+// find the root run of a component (with path halving)
+static int FindRootRun(std::vector<cRun>& runs, int i) {
+    while (runs[i].parent != i) {
+        runs[i].parent = runs[runs[i].parent].parent;
+        i = runs[i].parent;
+    }
+    return i;
+}
+
+// merge two components, the root is always the first run in raster order
+static void UnionRuns(std::vector<cRun>& runs, int i, int j) {
+    i = FindRootRun(runs, i);
+    j = FindRootRun(runs, j);
+    if (i < j)
+        runs[j].parent = i;
+    else if (j < i)
+        runs[i].parent = j;
+}
+
+// sum of k^0, k^1, k^2 and k^3 for k = 0..n
+static inline void PowerSums(long long n, long long* s) {
+    s[0] = n + 1;
+    s[1] = n * (n + 1) / 2;
+    s[2] = n * (n + 1) * (2 * n + 1) / 6;
+    s[3] = s[1] * s[1];
+}
+
+void cComponentLabeler::Reset() {
+    runs.clear();
+    prevstart = prevend = 0;
+}
+
+void cComponentLabeler::AddRun(int y, int x0, int x1, int& k) {
+    cRun run;
+    int j;
+
+    run.y = y;
+    run.x0 = x0;
+    run.x1 = x1;
+    run.parent = (int) runs.size();
+    runs.push_back(run);
+    // 8-connectivity: diagonal neighbours are also connected
+    while (k < prevend && runs[k].x1 < run.x0 - 1)
+        k++;
+    for (j = k; j < prevend && runs[j].x0 <= run.x1 + 1; j++)
+        UnionRuns(runs, j, run.parent);
+}
+
+void cComponentLabeler::AddRows(cv::Mat &srcBin, int y0, int y1) {
+    int x, x0, y, k;
+
+    // collect runs and connect them to overlapping runs in the previous row
+    for (y = y0; y < y1; y++) {
+        const unsigned char* p = srcBin.ptr<unsigned char>(y);
+        int rowstart = (int) runs.size();
+        k = prevstart;
+        x = 0;
+        while (x < srcBin.cols) {
+            if (!p[x]) {
+                x++;
+                continue;
+            }
+            x0 = x;
+            while (x < srcBin.cols && p[x])
+                x++;
+            AddRun(y, x0, x - 1, k);
+        }
+        prevstart = rowstart;
+        prevend = (int) runs.size();
+    }
+}
+
+void cComponentLabeler::AddRows(cBitMask &srcMask, int y0, int y1) {
+    int x, x0, y, k;
+
+    // same as above, but run ends are found a word at a time
+    for (y = y0; y < y1; y++) {
+        int rowstart = (int) runs.size();
+        k = prevstart;
+        x = 0;
+        while ((x0 = srcMask.NextBit(y, x, true)) < srcMask.width) {
+            x = srcMask.NextBit(y, x0, false);
+            AddRun(y, x0, x - 1, k);
+        }
+        prevstart = rowstart;
+        prevend = (int) runs.size();
+    }
+}
+
+void cComponentLabeler::GetMoments(std::vector<cv::Moments>& blobmoments,
+        cv::Point offset, std::vector<cv::Point>* firstpixels) {
+    int j, k, n;
+    long long a[4], b[4], sx[4], yy;
+
+    // number components in raster order of their first pixel
+    component.resize(runs.size());
+    for (j = 0, n = 0; j < (int) runs.size(); j++) {
+        k = FindRootRun(runs, j);
+        component[j] = (k == j) ? n++ : component[k];
+        if (k == j && firstpixels)
+            firstpixels->push_back(cv::Point(runs[j].x0, runs[j].y) + offset);
+    }
+    if (firstpixels)
+        std::reverse(firstpixels->end() - n, firstpixels->end());
+
+    // accumulate raw moments m00, m10, m01, m20, m11, m02, m30, m21, m12, m03
+    m.assign(10 * n, 0);
+    for (j = 0; j < (int) runs.size(); j++) {
+        double* mm = &m[10 * component[j]];
+        PowerSums(runs[j].x1 + offset.x, b);
+        PowerSums(runs[j].x0 - 1 + offset.x, a);
+        for (k = 0; k < 4; k++)
+            sx[k] = b[k] - a[k];
+        yy = runs[j].y + offset.y;
+        mm[0] += (double) sx[0];
+        mm[1] += (double) sx[1];
+        mm[2] += (double) (sx[0] * yy);
+        mm[3] += (double) sx[2];
+        mm[4] += (double) (sx[1] * yy);
+        mm[5] += (double) (sx[0] * yy * yy);
+        mm[6] += (double) sx[3];
+        mm[7] += (double) (sx[2] * yy);
+        mm[8] += (double) (sx[1] * yy * yy);
+        mm[9] += (double) (sx[0] * yy * yy * yy);
+    }
+
+    // same order as cv::findContours(), i.e. reverse raster order
+    for (j = n - 1; j >= 0; j--) {
+        double* mm = &m[10 * j];
+        blobmoments.push_back(cv::Moments(mm[0], mm[1], mm[2], mm[3], mm[4],
+                mm[5], mm[6], mm[7], mm[8], mm[9]));
+    }
+}
+
+void cComponentLabeler::GetBoundingRects(std::vector<cv::Rect>& rects) {
+    int j, k, n;
+    size_t first = rects.size();
+
+    // same numbering as in GetMoments()
+    component.resize(runs.size());
+    for (j = 0, n = 0; j < (int) runs.size(); j++) {
+        cv::Rect rect(runs[j].x0, runs[j].y, runs[j].x1 - runs[j].x0 + 1, 1);
+        k = FindRootRun(runs, j);
+        if (k == j) {
+            component[j] = n++;
+            rects.push_back(rect);
+        } else {
+            component[j] = component[k];
+            rects[first + component[j]] |= rect;
+        }
+    }
+}
+
+void FindBlobMoments(cv::Mat &srcBin, std::vector<cv::Moments>& blobmoments,
+        blobextraction_t method, cBlobWorkspace* bws, cv::Point offset,
+        std::vector<cv::Point>* firstpixels) {
+    blobmoments.clear();
+    if (firstpixels)
+        firstpixels->clear();
+    if (method == BLOB_EXTRACT_COMPONENTS) {
+        bws->labeler.Reset();
+        bws->labeler.AddRows(srcBin, 0, srcBin.rows);
+        bws->labeler.GetMoments(blobmoments, offset, firstpixels);
+    } else {
+        std::vector<std::vector<cv::Point>> contours;
+        std::vector<cv::Vec4i> hierarchy;
+
+        // find blob contours
+        cv::findContours(srcBin, contours, hierarchy, cv::RETR_EXTERNAL,
+                cv::CHAIN_APPROX_NONE, offset);
+        // Compute the moments
+        for (unsigned int j = 0; j < contours.size(); j++) {
+            blobmoments.push_back(cv::moments(contours[j]));
+            // contours start at their first pixel in raster order
+            if (firstpixels)
+                firstpixels->push_back(contours[j][0]);
+        }
+    }
+}
+
+void FindBlobMoments(cBitMask &srcMask, std::vector<cv::Moments>& blobmoments,
+        blobextraction_t method, cBlobWorkspace* bws, cv::Point offset,
+        std::vector<cv::Point>* firstpixels) {
+    if (method == BLOB_EXTRACT_COMPONENTS) {
+        blobmoments.clear();
+        if (firstpixels)
+            firstpixels->clear();
+        bws->labeler.Reset();
+        bws->labeler.AddRows(srcMask, 0, srcMask.height);
+        bws->labeler.GetMoments(blobmoments, offset, firstpixels);
+    } else {
+        // contours are found on a binary image
+        srcMask.ToBinary(bws->binary);
+        FindBlobMoments(bws->binary, blobmoments, method, bws, offset,
+                firstpixels);
+    }
+}
+
 void FindSubBlobs(cv::Mat &srcBin, int i, cColor* mColor, cCS* cs,
-		tBlob& mBlobParticles, int currentframe, std::ofstream& ofslog) {
+		cBlobWorkspace* bws, tBlob& mBlobParticles, int currentframe,
+		cTextWriter& ofslog) {
+    // find blobs and their moments
+    FindBlobMoments(srcBin, bws->blobmoments, cs->blobextraction, bws);
+    SubBlobsFromMoments(bws->blobmoments, i, mColor, cs, bws, mBlobParticles,
+            currentframe, ofslog);
+}
+
+void FindSubBlobs(cBitMask &srcMask, int i, cColor* mColor, cCS* cs,
+		cBlobWorkspace* bws, tBlob& mBlobParticles, int currentframe,
+		cTextWriter& ofslog) {
+    // find blobs and their moments
+    FindBlobMoments(srcMask, bws->blobmoments, cs->blobextraction, bws);
+    SubBlobsFromMoments(bws->blobmoments, i, mColor, cs, bws, mBlobParticles,
+            currentframe, ofslog);
+}
+
+// returns true if a blob of color i is properly sized, counts it for the log
+// otherwise
+static bool CheckBlobSize(double m00, int i, cCS* cs, int& overmaxcount,
+        double& maxsize, int& undermincount, double& minsize) {
+    if (m00 >= cs->mAreaMin[i] && m00 <= cs->mAreaMax[i])
+        return true;
+    // too big
+    if (m00 > cs->mAreaMax[i]) {
+        overmaxcount++;
+        if (m00 > maxsize)
+            maxsize = m00;
+    }
+    // too small (but larger than one pixel)
+    else if (m00 > cs->mAreaMin[i] * 0.8) {
+        undermincount++;
+        if (m00 < minsize)
+            minsize = m00;
+    }
+    return false;
+}
+
+void SubBlobsFromMoments(std::vector<cv::Moments>& blobmoments, int i,
+        cColor* mColor, cCS* cs, cBlobWorkspace* bws, tBlob& mBlobParticles,
+        int currentframe, cTextWriter& ofslog) {
+    cMomentBatch& batch = bws->batch;
+    cEllipseBatch& ellipses = bws->ellipses;
+    std::vector<unsigned int>& index = bws->batchindex;
     double maxsize = cs->mAreaMin[i];
 	double minsize = cs->mAreaMax[i];
     int overmaxcount = 0;
     int undermincount = 0;
-    std::vector<std::vector<cv::Point>> contours;
-    std::vector<cv::Vec4i> hierarchy;
-    cv::Moments moments;
     unsigned int j = 0;
+    unsigned int end = blobmoments.size();
+    int k = 0;
 
-    // find blob contours
-    cv::findContours(srcBin, contours, hierarchy, cv::RETR_EXTERNAL,
-            cv::CHAIN_APPROX_NONE, cv::Point(0, 0));
-
-    // Iterate over first blobs
-    for (j = 0; j < contours.size(); j++) {
-        // allow for more than final number, but not infinitely
-        if (mColor[i].mNumBlobsFound >= cs->mRats * 20) {
-            break;
+    // sort out the blobs by size and compute the ellipses of all properly
+    // sized blobs at once
+    batch.Clear();
+    index.clear();
+    for (j = 0; j < blobmoments.size(); j++) {
+        if (CheckBlobSize(blobmoments[j].m00, i, cs, overmaxcount, maxsize,
+                undermincount, minsize)) {
+            batch.Add(blobmoments[j]);
+            index.push_back(j);
         }
-        // Compute the moments
-        moments = cv::moments(contours[j]);
-
-        // store properly sized and shaped particles
-        if (moments.m00 >= cs->mAreaMin[i] && moments.m00 <= cs->mAreaMax[i]) {
-            // Compute particle parameters
-            cBlob newparticle;
-            FillParticleFromMoments(&newparticle, moments, cs->bBlobE);
-
-            // check elongation
-            if (newparticle.mAxisB && newparticle.mAxisA / newparticle.mAxisB <=
-                    cs->mElongationMax[i]) {
-                // set ID and increase blobnum
-                mColor[i].mNumBlobsFound++;
-                newparticle.index = i;
-
-                // insert particle to common blobparticle list
-                mBlobParticles.push_back(newparticle);
+    }
+    FillEllipsesFromMoments(batch, ellipses, cs->bBlobE);
+
+    // store properly shaped particles
+    // allow for more than final number, but not infinitely
+    if (mColor[i].mNumBlobsFound >= cs->mRats * 20)
+        end = 0;
+    for (k = 0; k < batch.Size() && end; k++) {
+        // check elongation
+        if (ellipses.axisB[k] && ellipses.axisA[k] / ellipses.axisB[k] <=
+                cs->mElongationMax[i]) {
+            // increase blobnum
+            mColor[i].mNumBlobsFound++;
+
+            // insert particle to common blobparticle list
+            mBlobParticles.Add(i, ellipses.cx[k], ellipses.cy[k],
+                    ellipses.axisA[k], ellipses.axisB[k],
+                    ellipses.orientation[k], batch.m00[k], ellipses.radius[k]);
+
+            if (mColor[i].mNumBlobsFound >= cs->mRats * 20) {
+                end = index[k] + 1;
+                break;
             }
         }
-        // too big
-        else if (moments.m00 > cs->mAreaMax[i]) {
-            overmaxcount++;
-            if (moments.m00 > maxsize)
-                maxsize = moments.m00;
-        }
-        // too small (but larger than one pixel)
-        else if (moments.m00 > cs->mAreaMin[i] * 0.8) {
-            undermincount++;
-            if (moments.m00 < minsize)
-                minsize = moments.m00;
-        }
+    }
+
+    // blobs after the limit are not logged (rare, count again until there)
+    if (end < blobmoments.size()) {
+        maxsize = cs->mAreaMin[i];
+        minsize = cs->mAreaMax[i];
+        overmaxcount = undermincount = 0;
+        for (j = 0; j < end; j++)
+            CheckBlobSize(blobmoments[j].m00, i, cs, overmaxcount, maxsize,
+                    undermincount, minsize);
     }
 
     // write to log file, if needed
     if (overmaxcount) {
         ofslog << currentframe << "\tBLOBOVERSIZE\tc" << i << "-" << mColor[i].
-                name << "\t" << overmaxcount << "\t" << maxsize << std::endl;
+                name << "\t" << overmaxcount << "\t" << maxsize << "\n";
     }
     if (undermincount) {
         ofslog << currentframe << "\tBLOBUNDERSIZE\tc" << i << "-" << mColor[i].
-                name << "\t" << undermincount << std::endl;  //<< "\t" << minsize << endl;
+                name << "\t" << undermincount << "\n";  //<< "\t" << minsize << endl;
     }
 }
 
-void FindHSVBlobs(cv::Mat &HSVimage, int i, cv::Mat &filterimage,
-		cColor* mColor, cCS* cs,  tBlob& mBlobParticles,
-		int currentframe, std::ofstream& ofslog) {
+void ClassifyColors(cv::Mat &BGRimage, cv::Mat &labelimage,
+		tHSVLookup* mHSVLookup) {
+	cvClassifyBGR(labelimage, BGRimage, mHSVLookup->mH, mHSVLookup->mS,
+			mHSVLookup->mV);
+}
+
+void MaskColorLabels(cv::Mat &labelimage, cv::Mat &maskimage,
+		tHSVLookup* mHSVLookup) {
+	// masked out pixels are black, which might also belong to some colors
+	cvMaskLabel(labelimage, maskimage,
+			mHSVLookup->mH[0] & mHSVLookup->mS[0] & mHSVLookup->mV[0]);
+}
+
+void MaskColorLabels(cv::Mat &labelimage, cBitMask &mask,
+		tHSVLookup* mHSVLookup) {
+	cvMaskLabel(labelimage, mask,
+			mHSVLookup->mH[0] & mHSVLookup->mS[0] & mHSVLookup->mV[0]);
+}
+
+int RegionPadding(cCS* cs) {
+	return cs->mDilateBlob + cs->mErodeBlob + 1;
+}
+
+void FindRatRegions(cBitMask &mask, cCS* cs, cColor* mColor,
+		tHSVLookup* mHSVLookup, cComponentLabeler& labeler,
+		std::vector<cv::Rect>& regions) {
+	cv::Rect image(0, 0, mask.width, mask.height);
+	// pixels farther from the mask are not changed by dilate + erode
+	int padding = RegionPadding(cs);
+	unsigned char outside = mHSVLookup->mH[0] & mHSVLookup->mS[0] & mHSVLookup->mV[0];
+	size_t j;
+
+	regions.clear();
+	// masked out pixels belong to a color, blobs can be anywhere
+	for (j = 0; (int)j < cs->mBase; j++) {
+		if (mColor[j].mUse && (outside & (1 << j))) {
+			regions.push_back(image);
+			return;
+		}
+	}
+	// padded bounding rectangles of the mask components
+	labeler.Reset();
+	labeler.AddRows(mask, 0, mask.height);
+	labeler.GetBoundingRects(regions);
+	for (j = 0; j < regions.size(); j++) {
+		regions[j] = cv::Rect(regions[j].x - padding, regions[j].y - padding,
+				regions[j].width + 2 * padding, regions[j].height + 2 * padding) & image;
+	}
+	MergeRegions(regions);
+}
+
+void MergeRegions(std::vector<cv::Rect>& regions) {
+	size_t j, k;
+	bool bMerged;
+
+	do {
+		bMerged = false;
+		for (j = 0; j < regions.size() && !bMerged; j++) {
+			for (k = j + 1; k < regions.size(); k++) {
+				if ((regions[j] & regions[k]).area()) {
+					regions[j] |= regions[k];
+					regions.erase(regions.begin() + k);
+					bMerged = true;
+					break;
+				}
+			}
+		}
+	} while (bMerged);
+}
+
+// true if the filtered mask of a region has pixels closer than the padding to
+// a region border that is not the image border, i.e. a blob might continue
+// outside the region or be changed by pixels outside of it
+static bool BlobsAtRegionBorder(cBitMask &mask, cv::Rect region, cv::Size size,
+		int padding) {
+	int px = std::min(padding, region.width);
+	int py = std::min(padding, region.height);
+
+	return (region.x > 0 && mask.Any(cv::Rect(0, 0, px, region.height))) ||
+			(region.y > 0 && mask.Any(cv::Rect(0, 0, region.width, py))) ||
+			(region.x + region.width < size.width && mask.Any(cv::Rect(
+			region.width - px, 0, px, region.height))) ||
+			(region.y + region.height < size.height && mask.Any(cv::Rect(
+			0, region.height - py, region.width, py)));
+}
 
+// FindHSVBlobs() on regions only: each region is filtered as a separate mask
+// in filtermask, so that pixels outside it are not used. Regions that are
+// not padded around all pixels of the color (bWindows) are checked for blobs
+// at their border, false is returned without any blob found if there are.
+static bool FindHSVBlobsInRegions(cv::Mat &labelimage, int i,
+		std::vector<cv::Rect>& regions, bool bWindows, cColor* mColor,
+		cCS* cs, cBlobWorkspace* bws, tBlob& mBlobParticles, int currentframe,
+		cTextWriter& ofslog) {
+	cBitMask& filtermask = bws->filtermask;
+	std::vector<cv::Moments>& blobmoments = bws->blobmoments;
+	std::vector<cv::Moments>& regionmoments = bws->regionmoments;
+	std::vector<cv::Point>& firstpixels = bws->firstpixels;
+	std::vector<cv::Point>& regionfirstpixels = bws->regionfirstpixels;
+	std::vector<int>& order = bws->order;
+	size_t j;
+
+	blobmoments.clear();
+	firstpixels.clear();
+	for (j = 0; j < regions.size(); j++) {
+		cv::Mat labelrect = labelimage(regions[j]);
+		filtermask.FromLabel(labelrect, 1 << i);
+		if (cs->mDilateBlob) {
+			cvDilateBinary(filtermask, cs->mDilateBlob, bws->morph);
+		}
+		if (cs->mErodeBlob) {
+			cvErodeBinary(filtermask, cs->mErodeBlob, bws->morph);
+		}
+		if (bWindows && BlobsAtRegionBorder(filtermask, regions[j],
+				labelimage.size(), RegionPadding(cs))) {
+			return false;
+		}
+		FindBlobMoments(filtermask, regionmoments, cs->blobextraction, bws,
+				regions[j].tl(), &regionfirstpixels);
+		blobmoments.insert(blobmoments.end(), regionmoments.begin(), regionmoments.end());
+		firstpixels.insert(firstpixels.end(), regionfirstpixels.begin(), regionfirstpixels.end());
+	}
+	// same order as on the whole image, i.e. reverse raster order of first pixels
+	order.resize(blobmoments.size());
+	for (j = 0; j < order.size(); j++)
+		order[j] = (int)j;
+	std::sort(order.begin(), order.end(), [&firstpixels](int a, int b) {
+		return firstpixels[a].y > firstpixels[b].y || (firstpixels[a].y ==
+				firstpixels[b].y && firstpixels[a].x > firstpixels[b].x);
+	});
+	regionmoments.clear();
+	for (j = 0; j < order.size(); j++)
+		regionmoments.push_back(blobmoments[order[j]]);
+	SubBlobsFromMoments(regionmoments, i, mColor, cs, bws, mBlobParticles,
+			currentframe, ofslog);
+
+	return true;
+}
+
+void FindHSVBlobs(cv::Mat &labelimage, int i, cColor* mColor, cCS* cs,
+		cBlobWorkspace* bws, tBlob& mBlobParticles,
+		int currentframe, cTextWriter& ofslog,
+		std::vector<cv::Rect>* regions, std::vector<cv::Rect>* windows,
+		bool* bFullScan) {
+	cBitMask& filtermask = bws->filtermask;
 	char cc[16];
-	// filter with current HSV color into filterimage
-    cvFilterHSV(filterimage, HSVimage, mColor[i].mColor.mColorHSV,
-            mColor[i].mColor.mRangeHSV);
+
+	if (windows) {
+		if (FindHSVBlobsInRegions(labelimage, i, *windows, true, mColor, cs,
+				bws, mBlobParticles, currentframe, ofslog)) {
+			return;
+		}
+		// a blob is cut by a window, search the whole image (or regions)
+		if (bFullScan) {
+			*bFullScan = true;
+		}
+	}
+	if (regions) {
+		FindHSVBlobsInRegions(labelimage, i, *regions, false, mColor, cs, bws,
+				mBlobParticles, currentframe, ofslog);
+		return;
+	}
+	// get current color from label image into filtermask
+	filtermask.FromLabel(labelimage, 1 << i);
 	if (cs->mDilateBlob) {
-		cv::dilate(filterimage, filterimage, cv::Mat(), cv::Point(-1,-1), cs->mDilateBlob);
+		cvDilateBinary(filtermask, cs->mDilateBlob, bws->morph);
 	}
 	if (cs->mErodeBlob) {
-		cv::erode(filterimage, filterimage, cv::Mat(), cv::Point(-1,-1), cs->mErodeBlob);
+		cvErodeBinary(filtermask, cs->mErodeBlob, bws->morph);
 	}
-	// show debug images before they are modified by the contour finding method
+	// show debug images
 	if (cs->bShowDebugVideo) {
+		cv::Mat debugimage;
+		filtermask.ToBinary(debugimage);
 		snprintf(cc, sizeof(cc), "c%d-%s", i, mColor[i].name);
-		cv::imshow(cc, filterimage);
+		cv::imshow(cc, debugimage);
+	}
+    FindSubBlobs(filtermask, i, mColor, cs, bws, mBlobParticles, currentframe,
+            ofslog);
+}
+
+// arguments of the FindHSVBlobsParallel() job of the workers
+class cHSVBlobsJob {
+  public:
+    cv::Mat* labelimage;
+    cBlobWorkspace* colorws;
+    cColor* mColor;
+    cCS* cs;
+    tBlob* colorParticles;
+    cTextWriter* colorLog;
+    int currentframe;
+    std::vector<cv::Rect>** regions;
+    std::vector<cv::Rect>** windows;
+    bool* bFullScan;
+    int workers;                // number of workers
+};
+
+// job of FindHSVBlobsParallel: worker w processes every nth color from w
+static void FindHSVBlobsWorker(void* arg, int worker) {
+	cHSVBlobsJob* job = (cHSVBlobsJob*) arg;
+	cColor* mColor = job->mColor;
+	for (int i = worker; i < job->cs->mBase; i += job->workers) {
+		if (!mColor[i].mUse)
+			continue;
+		mColor[i].mNumBlobsFound = 0;
+		MEASURE_DURATION(STAGE_FINDHSVBLOBS_COLOR + i, FindHSVBlobs(
+				*job->labelimage, i, mColor, job->cs, &job->colorws[worker],
+				job->colorParticles[i], job->currentframe, job->colorLog[i],
+				job->regions ? job->regions[i] : NULL,
+				job->windows ? job->windows[i] : NULL,
+				job->bFullScan ? &job->bFullScan[i] : NULL));
+	}
+}
+
+void FindHSVBlobsParallel(cv::Mat &labelimage, cWorkerPool* workers,
+		cBlobWorkspace* colorws, tBlob* colorParticles, cTextWriter* colorLog,
+		cColor* mColor, cCS* cs, tBlob& mBlobParticles,
+		int currentframe, cTextWriter& ofslog,
+		std::vector<cv::Rect>** regions, std::vector<cv::Rect>** windows,
+		bool* bFullScan) {
+	cHSVBlobsJob job;
+	int i, n = std::min(cs->colorthreads, cs->mBase);
+
+	// threads are only started once, each color is handled by exactly
+	// one of them
+	if (workers->Size() != n)
+		workers->Start(n);
+	for (i = 0; i < cs->mBase; i++) {
+		colorParticles[i].clear();
+		colorLog[i].clear();
+	}
+	job.labelimage = &labelimage;
+	job.colorws = colorws;
+	job.mColor = mColor;
+	job.cs = cs;
+	job.colorParticles = colorParticles;
+	job.colorLog = colorLog;
+	job.currentframe = currentframe;
+	job.regions = regions;
+	job.windows = windows;
+	job.bFullScan = bFullScan;
+	job.workers = n;
+	workers->Run(FindHSVBlobsWorker, &job);
+
+	// merge blobs and log lines in the same order as the serial version
+	for (i = 0; i < cs->mBase; i++) {
+		mBlobParticles.Append(colorParticles[i]);
+		ofslog << colorLog[i];
 	}
-    FindSubBlobs(filterimage, i, mColor, cs, mBlobParticles, currentframe, ofslog);
 }
 
-void FindMDorRatBlobs(cv::Mat &srcBin, cCS* cs, tBlob& mParticles,
-		int currentframe, std::ofstream& ofslog) {
+// moments of a blob on the original image from its moments on an image
+// downscaled by the given factor (pixel centers are mapped as in cvDownscale()).
+// Each small pixel stands for a full block of s x s pixels, so the variance
+// of the pixels within the blocks, (s^2-1)/12 in x and y, is added to mu20
+// and mu02. mu11 and the third order moments do not change by that.
+static cv::Moments UpscaleMoments(cv::Moments& moments, int downscale) {
+    double s = downscale, s2 = s * s;
+    double m00 = moments.m00 * s2;
+    if (!moments.m00)
+        return cv::Moments();
+    // center and central moments
+    double x = (moments.m10 / moments.m00) * s + (s - 1) / 2;
+    double y = (moments.m01 / moments.m00) * s + (s - 1) / 2;
+    double mu20 = moments.mu20 * s2 * s2 + m00 * (s2 - 1) / 12;
+    double mu11 = moments.mu11 * s2 * s2;
+    double mu02 = moments.mu02 * s2 * s2 + m00 * (s2 - 1) / 12;
+    double mu30 = moments.mu30 * s2 * s2 * s, mu21 = moments.mu21 * s2 * s2 * s;
+    double mu12 = moments.mu12 * s2 * s2 * s, mu03 = moments.mu03 * s2 * s2 * s;
+    // back to raw moments
+    double m20 = mu20 + m00 * x * x, m11 = mu11 + m00 * x * y;
+    double m02 = mu02 + m00 * y * y;
+
+    return cv::Moments(m00, m00 * x, m00 * y, m20, m11, m02,
+            mu30 + 3 * x * m20 - 2 * m00 * x * x * x,
+            mu21 + 2 * x * m11 + y * m20 - 2 * m00 * x * x * y,
+            mu12 + 2 * y * m11 + x * m02 - 2 * m00 * x * y * y,
+            mu03 + 3 * y * m02 - 2 * m00 * y * y * y);
+}
+
+// second half of FindMDorRatBlobs() with moments on a downscaled image
+static void MDorRatBlobsFromDownscaledMoments(std::vector<cv::Moments>& blobmoments,
+        cCS* cs, cBlobWorkspace* bws, tBlob& mParticles, int currentframe,
+        cTextWriter& ofslog, int downscale) {
+    if (downscale > 1) {
+        for (unsigned int j = 0; j < blobmoments.size(); j++)
+            blobmoments[j] = UpscaleMoments(blobmoments[j], downscale);
+    }
+    MDorRatBlobsFromMoments(blobmoments, cs, bws, mParticles, currentframe,
+            ofslog);
+}
+
+void FindMDorRatBlobs(cv::Mat &srcBin, cCS* cs, cBlobWorkspace* bws,
+		tBlob& mParticles, int currentframe, cTextWriter& ofslog,
+		int downscale) {
+    // find blobs and their moments
+    FindBlobMoments(srcBin, bws->blobmoments, cs->blobextraction, bws);
+    MDorRatBlobsFromDownscaledMoments(bws->blobmoments, cs, bws, mParticles,
+            currentframe, ofslog, downscale);
+}
+
+void FindMDorRatBlobs(cBitMask &srcMask, cCS* cs, cBlobWorkspace* bws,
+		tBlob& mParticles, int currentframe, cTextWriter& ofslog,
+		int downscale) {
+    // find blobs and their moments
+    FindBlobMoments(srcMask, bws->blobmoments, cs->blobextraction, bws);
+    MDorRatBlobsFromDownscaledMoments(bws->blobmoments, cs, bws, mParticles,
+            currentframe, ofslog, downscale);
+}
+
+void MDorRatBlobsFromMoments(std::vector<cv::Moments>& blobmoments, cCS* cs,
+        cBlobWorkspace* bws, tBlob& mParticles, int currentframe,
+        cTextWriter& ofslog) {
+    cMomentBatch& batch = bws->batch;
+    cEllipseBatch& ellipses = bws->ellipses;
     double maxsize = cs->mAreaMin[0]; // TODO: this is not accurate
     double minsize = cs->mAreaMax[0]; // TODO: this is not accurate
     int overmaxcount = 0;
     int undermincount = 0;
-    std::vector<std::vector<cv::Point>> contours;
-    std::vector<cv::Vec4i> hierarchy;
     cv::Moments moments;
     unsigned int j = 0;
-
-    // find blob contours
-    cv::findContours(srcBin, contours, hierarchy, cv::RETR_EXTERNAL,
-            cv::CHAIN_APPROX_NONE, cv::Point(0, 0));
+    int k = 0;
 
     // Iterate over blobs
-    for (j = 0; j < contours.size();j++) {
+    batch.Clear();
+    for (j = 0; j < blobmoments.size();j++) {
         // (no need to have more than ID's)
-        if ((int)mParticles.size() >= cs->mRats * 2) {
+        if ((int)mParticles.size() + batch.Size() >= cs->mRats * 2) {
             break;
         }
-        // Compute the moments
-        moments = cv::moments(contours[j]);
+        moments = blobmoments[j];
 
         // store properly sized particles
 		// TODO: separate size restriction for RAT and MD?
         if (moments.m00 >= cs->mdAreaMin && moments.m00 <= cs->mdAreaMax) {
-            // Compute particle parameters
-            cBlob newparticle;
-            FillParticleFromMoments(&newparticle, moments, cs->bBlobE);
-
-            // reset unused variables
-            newparticle.index = 0;
-
-            // insert particle to common blobparticle list
-            mParticles.push_back(newparticle);
+            batch.Add(moments);
         }
         // too big
         else if (moments.m00 > cs->mdAreaMax) {
@@ -188,36 +710,114 @@ void FindMDorRatBlobs(cv::Mat &srcBin, cCS* cs, tBlob& mParticles,
         }
     }
 
+    // compute the ellipses of all properly sized particles at once and
+    // insert them to common blobparticle list
+    FillEllipsesFromMoments(batch, ellipses, cs->bBlobE);
+    for (k = 0; k < batch.Size(); k++) {
+        mParticles.Add(0, ellipses.cx[k], ellipses.cy[k], ellipses.axisA[k],
+                ellipses.axisB[k], ellipses.orientation[k], batch.m00[k],
+                ellipses.radius[k]);
+    }
+
     // write to log file, if needed
     if (overmaxcount)
         ofslog << currentframe << "\t" << "BLOBOVERSIZE\tMD\t" << overmaxcount
-                << "\t" << maxsize << std::endl;
+                << "\t" << maxsize << "\n";
     if (undermincount)
-        ofslog << currentframe << "\t" << "BLOBUNDERSIZE\tMD\t" << undermincount << std::endl; //"\t" << minsize << std::endl;
+        ofslog << currentframe << "\t" << "BLOBUNDERSIZE\tMD\t" << undermincount << "\n"; //"\t" << minsize << std::endl;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // filter backgroud and get only high saturation and different hue rat blobs
-void DetectRats(cv::Mat &hsvimage, cv::Mat &maskimage, tColor* mBGColor,
-	   cCS* cs, tBlob& mParticles, int currentframe, std::ofstream& ofslog) {
-	// init variables
-	cv::Mat binary(hsvimage.size(), CV_8UC1);
+void DetectRats(cv::Mat &labelimage, cBitMask &mask, cCS* cs,
+		cBlobWorkspace* bws, tBlob& mParticles, int currentframe,
+		cTextWriter& ofslog) {
+	// get background from label image and invert it to detect rats as set pixels
+	mask.FromLabel(labelimage, 1 << BGLABELBIT, true);
+	// filter noise and possibly enlarge rat blobs
+	if (cs->mErodeRat) {
+		cvErodeBinary(mask, cs->mErodeRat, bws->morph);
+	}
+	if (cs->mDilateRat) {
+		cvDilateBinary(mask, cs->mDilateRat, bws->morph);
+	}
+    // debug show
+    if (cs->bShowDebugVideo) {
+        cv::Mat debugimage;
+        mask.ToBinary(debugimage);
+        cv::imshow("rats", debugimage);
+    }
+    // find rat blobs
+    FindMDorRatBlobs(mask, cs, bws, mParticles, currentframe, ofslog);
+}
+
+// set pixels [x0, x1) of a mask row
+static inline void SetBitRange(uint64_t* row, int x0, int x1) {
+    int w0 = x0 >> 6;
+    int w1 = (x1 - 1) >> 6;
+    uint64_t first = ~(uint64_t)0 << (x0 & 63);
+    uint64_t last = ~(uint64_t)0 >> (63 - ((x1 - 1) & 63));
 
-	// detect background and invert it to detect rats as white blobs
-	cvFilterHSV(binary, hsvimage, mBGColor->mColorHSV, mBGColor->mRangeHSV);
+    if (w0 == w1) {
+        row[w0] |= first & last;
+        return;
+    }
+    row[w0] |= first;
+    std::fill(row + w0 + 1, row + w1, ~(uint64_t)0);
+    row[w1] |= last;
+}
+
+// upscale a mask by repeating its pixels, the last column and row of blocks
+// also cover the columns and rows left over by cvDownscale()
+static void UpscaleMask(cBitMask &dst, cBitMask &src, int downscale) {
+    int x0, x1, y, k, yend;
+
+    dst.Clear();
+    for (y = 0; y < src.height; y++) {
+        uint64_t* row = dst.Row(y * downscale);
+        // expand runs of set pixels
+        for (x0 = src.NextBit(y, 0, true); x0 < src.width;
+                x0 = src.NextBit(y, x1, true)) {
+            x1 = std::min(src.NextBit(y, x0, false), src.width);
+            SetBitRange(row, x0 * downscale,
+                    x1 == src.width ? dst.width : x1 * downscale);
+        }
+        yend = (y == src.height - 1) ? dst.height : (y + 1) * downscale;
+        for (k = y * downscale + 1; k < yend; k++)
+            std::copy(row, row + dst.stride, dst.Row(k));
+    }
+}
+
+void DetectRatsDownscaled(cv::Mat &labelimage, cBitMask &mask,
+		cv::Mat &binary, cv::Mat &smallimage, cBitMask &smallmask, cCS* cs,
+		cBlobWorkspace* bws, tBlob& mParticles, int currentframe,
+		cTextWriter& ofslog) {
+	int downscale = cs->ratdownscale;
+	// get background from label image and invert it to detect rats as white blobs
+	cvLabelToBinary(binary, labelimage, 1 << BGLABELBIT);
 	cv::bitwise_not(binary, binary);
+	// downscale, a pixel is rat if more than half of its block is rat
+	cvDownscale(smallimage, binary, downscale);
+	cv::threshold(smallimage, smallimage, 127, 255, cv::THRESH_BINARY);
+	smallmask.FromBinary(smallimage);
 	// filter noise and possibly enlarge rat blobs
 	if (cs->mErodeRat) {
-		cv::erode(binary, binary, cv::Mat(), cv::Point(-1,-1), cs->mErodeRat);
+		cvErodeBinary(smallmask, ScaleIterations(cs->mErodeRat, downscale),
+				bws->morph);
 	}
 	if (cs->mDilateRat) {
-		cv::dilate(binary, binary, cv::Mat(), cv::Point(-1,-1), cs->mDilateRat);
+		cvDilateBinary(smallmask, ScaleIterations(cs->mDilateRat, downscale),
+				bws->morph);
 	}
     // debug show
-    if (cs->bShowDebugVideo)
-        cv::imshow("rats", binary);
-    // copy to mask image
-    binary.copyTo(maskimage);
+    if (cs->bShowDebugVideo) {
+        smallmask.ToBinary(smallimage);
+        cv::imshow("rats", smallimage);
+    }
+    // upscale to mask
+    mask.Create(labelimage.size());
+    UpscaleMask(mask, smallmask, downscale);
     // find rat blobs
-    FindMDorRatBlobs(binary, cs, mParticles, currentframe, ofslog);
+    FindMDorRatBlobs(smallmask, cs, bws, mParticles, currentframe, ofslog,
+            downscale);
 }
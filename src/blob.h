@@ -4,8 +4,12 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+#include "bitmask.h"
 #include "color.h"
+#include "cvutils.h"
 #include "ini.h"
+#include "pipeline.h"
+#include "textwriter.h"
 
 // a particle (or chip/bin/blob)
 class cBlob {
@@ -37,8 +41,189 @@ class cBlob {
     }
 };
 
-// particle/blob vector type
-typedef std::vector < cBlob > tBlob;
+// Blobs of a frame in structure-of-arrays layout: blob j is the j-th element
+// of each column. Columns are only cleared between frames, so after they
+// are reserved for a run, no memory is allocated while processing frames.
+class cBlobStore {
+  public:
+    std::vector<int> index;             // color index
+    std::vector<double> cx, cy;         // center [pixel]
+    std::vector<double> axisA, axisB;   // major and minor axis, assuming elliptical shape [pixel]
+    std::vector<double> orientation;    // orientation angle [rad]
+    std::vector<double> area;           // area [pixel^2]
+    std::vector<double> radius;         // radius, assuming circular shape [pixel]
+    //! Constructor.
+    cBlobStore() {
+    }
+    //! Destructor.
+    ~cBlobStore() {
+    }
+    // number of blobs
+    size_t size() const {
+        return index.size();
+    }
+    // remove all blobs (memory is kept)
+    void clear() {
+        index.clear();
+        cx.clear();
+        cy.clear();
+        axisA.clear();
+        axisB.clear();
+        orientation.clear();
+        area.clear();
+        radius.clear();
+    }
+    // reserve memory for n blobs
+    void reserve(size_t n) {
+        index.reserve(n);
+        cx.reserve(n);
+        cy.reserve(n);
+        axisA.reserve(n);
+        axisB.reserve(n);
+        orientation.reserve(n);
+        area.reserve(n);
+        radius.reserve(n);
+    }
+    // append a blob
+    void Add(int i, double x, double y, double a, double b, double o,
+            double ar, double r) {
+        index.push_back(i);
+        cx.push_back(x);
+        cy.push_back(y);
+        axisA.push_back(a);
+        axisB.push_back(b);
+        orientation.push_back(o);
+        area.push_back(ar);
+        radius.push_back(r);
+    }
+    void push_back(const cBlob& blob) {
+        Add(blob.index, blob.mCenter.x, blob.mCenter.y, blob.mAxisA,
+                blob.mAxisB, blob.mOrientation, blob.mArea, blob.mRadius);
+    }
+    // append all blobs of another store
+    void Append(const cBlobStore& other) {
+        index.insert(index.end(), other.index.begin(), other.index.end());
+        cx.insert(cx.end(), other.cx.begin(), other.cx.end());
+        cy.insert(cy.end(), other.cy.begin(), other.cy.end());
+        axisA.insert(axisA.end(), other.axisA.begin(), other.axisA.end());
+        axisB.insert(axisB.end(), other.axisB.begin(), other.axisB.end());
+        orientation.insert(orientation.end(), other.orientation.begin(),
+                other.orientation.end());
+        area.insert(area.end(), other.area.begin(), other.area.end());
+        radius.insert(radius.end(), other.radius.begin(), other.radius.end());
+    }
+};
+
+// particle/blob list type
+typedef cBlobStore tBlob;
+
+// a horizontal run of foreground pixels on a binary image
+class cRun {
+  public:
+    int y;                      // row of the run
+    int x0;                     // first pixel of the run
+    int x1;                     // last pixel of the run
+    int parent;                 // union-find parent run index
+};
+
+// Labeling of 8-connected components of a binary image by pixel runs.
+// Rows must be added in order, but can be added in several parts (e.g.
+// band by band), components are merged across the parts.
+class cComponentLabeler {
+  public:
+    //! Constructor.
+    cComponentLabeler() : prevstart(0), prevend(0) {
+    }
+    //! Destructor.
+    ~cComponentLabeler() {
+    }
+    // start a new image (memory is kept)
+    void Reset();
+    // add rows [y0, y1) of a binary image
+    void AddRows(cv::Mat &srcBin, int y0, int y1);
+    // add rows [y0, y1) of a bit-packed mask
+    void AddRows(cBitMask &srcMask, int y0, int y1);
+    // append pixel moments of all components found (in reverse raster
+    // order of their first pixel, see FindBlobMoments()), the image is
+    // translated by offset, first pixels are also appended if needed
+    void GetMoments(std::vector<cv::Moments>& blobmoments,
+            cv::Point offset = cv::Point(0, 0),
+            std::vector<cv::Point>* firstpixels = NULL);
+    // append bounding rectangles of all components found (in raster order)
+    void GetBoundingRects(std::vector<cv::Rect>& rects);
+
+  private:
+    // add a run of row y and connect it to the runs of the previous row
+    // from k on (k is advanced along the row)
+    void AddRun(int y, int x0, int x1, int& k);
+    std::vector<cRun> runs;
+    std::vector<int> component; // component index of runs
+    std::vector<double> m;      // raw moments of components
+    int prevstart;              // first run of the previous row
+    int prevend;                // end of runs of the previous row
+};
+
+// moments of a batch of blobs in structure-of-arrays layout
+class cMomentBatch {
+  public:
+    std::vector<double> m00, m10, m01;  // raw moments
+    std::vector<double> mu20, mu11, mu02, mu30, mu03; // central moments
+    //! Constructor.
+    cMomentBatch() {
+    }
+    //! Destructor.
+    ~cMomentBatch() {
+    }
+    // remove all blobs (memory is kept)
+    void Clear();
+    // append the moments of a blob
+    void Add(cv::Moments &moments);
+    // number of blobs
+    int Size() const {
+        return (int) m00.size();
+    }
+};
+
+// ellipses of a batch of blobs (see FillParticleFromMoments()) in
+// structure-of-arrays layout
+class cEllipseBatch {
+  public:
+    std::vector<double> cx, cy;         // center [pixel]
+    std::vector<double> radius;         // radius assuming circular shape [pixel]
+    std::vector<double> axisA, axisB;   // major and minor axis [pixel]
+    std::vector<double> orientation;    // orientation angle [rad]
+    //! Constructor.
+    cEllipseBatch() {
+    }
+    //! Destructor.
+    ~cEllipseBatch() {
+    }
+};
+
+// Scratch memory of blob finding, reused on consecutive frames so that no
+// memory is allocated once it has grown large enough. Threads finding
+// blobs at the same time must use separate workspaces.
+class cBlobWorkspace {
+  public:
+    cComponentLabeler labeler;  // component labeling of FindBlobMoments()
+    cv::Mat binary;             // binary image of a mask (contour finding only)
+    std::vector<cv::Moments> blobmoments;   // moments of all blobs found
+    std::vector<cv::Moments> regionmoments; // moments of the blobs of a region
+    std::vector<cv::Point> firstpixels;     // first pixels of blobmoments
+    std::vector<cv::Point> regionfirstpixels; // first pixels of regionmoments
+    std::vector<int> order;     // raster order of the blobs of all regions
+    cMomentBatch batch;         // moments of the properly sized blobs
+    std::vector<unsigned int> batchindex;   // index of each blob of batch
+    cEllipseBatch ellipses;     // ellipses of the properly sized blobs
+    cMorphBuffers morph;        // row buffers of mask erode/dilate
+    cBitMask filtermask;        // mask of the actual color filter
+    //! Constructor.
+    cBlobWorkspace() {
+    }
+    //! Destructor.
+    ~cBlobWorkspace() {
+    }
+};
 
 /**
  * Fill a particle/blob structure from its moments.
@@ -54,6 +239,61 @@ typedef std::vector < cBlob > tBlob;
  */
 void FillParticleFromMoments(cBlob* particle, cv::Moments &moments, bool bSkew);
 
+/**
+ * FillParticleFromMoments() on a batch of blobs at once: the square roots
+ * and divisions of four blobs are computed together with AVX if available.
+ * Results are exactly the same as those of FillParticleFromMoments().
+ *
+ * \param moments    the moments of the blobs
+ * \param ellipses   the output ellipses, in the order of moments
+ * \param bSkew      if true, skew parameters are also calculated
+ */
+void FillEllipsesFromMoments(cMomentBatch &moments, cEllipseBatch &ellipses,
+        bool bSkew);
+
+/**
+ * Find all blobs on a binary image and calculate their moments.
+ *
+ * With BLOB_EXTRACT_CONTOURS outer contours are found and the moments of
+ * the contour polygons are returned. With BLOB_EXTRACT_COMPONENTS
+ * 8-connected components are labeled in a single raster pass over pixel
+ * runs and pixel moments are accumulated in the same pass, without
+ * allocating any contour. Note that the two methods give different
+ * moments (e.g. m00 is the polygon area or the number of pixels) and
+ * blobs inside holes of other blobs are only found by the latter.
+ * Blobs are returned in reverse raster order of their first pixel in
+ * both cases.
+ *
+ * \param srcBin       the binary image on which blobs are to be found
+ * \param blobmoments  the moments of all blobs found
+ * \param method       the blob extraction method
+ * \param bws          blob workspace (its labeler is used)
+ * \param offset       offset of srcBin, added to all coordinates
+ * \param firstpixels  if not NULL, the first pixel of each blob (with
+ *                     offset) is stored here, in the order of blobmoments
+ */
+void FindBlobMoments(cv::Mat &srcBin, std::vector<cv::Moments>& blobmoments,
+        blobextraction_t method, cBlobWorkspace* bws,
+        cv::Point offset = cv::Point(0, 0),
+        std::vector<cv::Point>* firstpixels = NULL);
+
+/**
+ * FindBlobMoments() on a bit-packed mask. Components are labeled directly
+ * on the packed rows, contours are found on its binary image.
+ *
+ * \param srcMask      the mask on which blobs are to be found
+ * \param blobmoments  the moments of all blobs found
+ * \param method       the blob extraction method
+ * \param bws          blob workspace (its labeler and binary image are used)
+ * \param offset       offset of srcMask, added to all coordinates
+ * \param firstpixels  if not NULL, the first pixel of each blob (with
+ *                     offset) is stored here, in the order of blobmoments
+ */
+void FindBlobMoments(cBitMask &srcMask, std::vector<cv::Moments>& blobmoments,
+        blobextraction_t method, cBlobWorkspace* bws,
+        cv::Point offset = cv::Point(0, 0),
+        std::vector<cv::Point>* firstpixels = NULL);
+
 /**
  * Finds all blobs on a binary image belonging to a given color.
  *
@@ -61,45 +301,235 @@ void FillParticleFromMoments(cBlob* particle, cv::Moments &moments, bool bSkew);
  * \param i       the color index corresponding to the image
  * \param mColor  the color definition database
  * \param cs      control state structure
+ * \param bws     blob workspace
  * \param mBlobParticles  structure holding the found blobs
  * \param currentframe  the current video frame index
  * \param ofslog  output log file stream
  */
 void FindSubBlobs(cv::Mat &srcBin, int i, cColor* mColor, cCS* cs,
-        tBlob& mBlobParticles, int currentframe, std::ofstream& ofslog);
+        cBlobWorkspace* bws, tBlob& mBlobParticles, int currentframe,
+        cTextWriter& ofslog);
 
 /**
- * Finds all blobs on a HSV image belonging to a given color.
+ * FindSubBlobs() on a bit-packed mask.
  *
- * \param HSVimage    the HSV image on which blobs are to be found
+ * \param srcMask  the mask on which blobs are to be found
+ * \param i        the color index corresponding to the mask
+ * \param mColor   the color definition database
+ * \param cs       control state structure
+ * \param bws      blob workspace
+ * \param mBlobParticles  structure holding the found blobs
+ * \param currentframe  the current video frame index
+ * \param ofslog   output log file stream
+ */
+void FindSubBlobs(cBitMask &srcMask, int i, cColor* mColor, cCS* cs,
+        cBlobWorkspace* bws, tBlob& mBlobParticles, int currentframe,
+        cTextWriter& ofslog);
+
+/**
+ * Store properly sized blobs of a given color from blob moments
+ * (second half of FindSubBlobs()).
+ *
+ * \param blobmoments  the moments of all blobs found on the binary image
+ * \param i       the color index corresponding to the blobs
+ * \param mColor  the color definition database
+ * \param cs      control state structure
+ * \param bws     blob workspace (its moment and ellipse batches are used)
+ * \param mBlobParticles  structure holding the found blobs
+ * \param currentframe  the current video frame index
+ * \param ofslog  output log file stream
+ */
+void SubBlobsFromMoments(std::vector<cv::Moments>& blobmoments, int i,
+        cColor* mColor, cCS* cs, cBlobWorkspace* bws, tBlob& mBlobParticles,
+        int currentframe, cTextWriter& ofslog);
+
+/**
+ * Classify all pixels of a BGR image with all used colors and the
+ * background color in a single pass, without creating the HSV image.
+ *
+ * \param BGRimage    the BGR image to classify
+ * \param labelimage  the output label image, bit i is set where color i
+ *                    would be found by cvFilterHSV() on the HSV image and
+ *                    bit BGLABELBIT where the background color would be found
+ * \param mHSVLookup  the lookup table of the current color definitions
+ */
+void ClassifyColors(cv::Mat &BGRimage, cv::Mat &labelimage,
+		tHSVLookup* mHSVLookup);
+
+/**
+ * Mask a label image as if the HSV image had been masked before
+ * classification, i.e. pixels outside the mask get the labels of black.
+ *
+ * \param labelimage  the label image created by ClassifyColors()
+ * \param maskimage   the binary mask image
+ * \param mHSVLookup  the lookup table of the current color definitions
+ */
+void MaskColorLabels(cv::Mat &labelimage, cv::Mat &maskimage,
+		tHSVLookup* mHSVLookup);
+
+/**
+ * MaskColorLabels() with a bit-packed mask.
+ *
+ * \param labelimage  the label image created by ClassifyColors()
+ * \param mask        the mask of the same size
+ * \param mHSVLookup  the lookup table of the current color definitions
+ */
+void MaskColorLabels(cv::Mat &labelimage, cBitMask &mask,
+		tHSVLookup* mHSVLookup);
+
+/**
+ * Get the padding needed around a region of the image so that
+ * FindHSVBlobs() on the region gives the same blobs inside it as on the
+ * whole image (the dilate/erode operations do not reach farther).
+ *
+ * \param cs  control state structure
+ *
+ * \return the padding [pixel]
+ */
+int RegionPadding(cCS* cs);
+
+/**
+ * Merge overlapping regions until no two of them overlap.
+ *
+ * \param regions  the regions to merge
+ */
+void MergeRegions(std::vector<cv::Rect>& regions);
+
+/**
+ * Find the regions of the image where colored blobs can be found after
+ * MaskColorLabels(): the bounding rectangles of the mask components,
+ * padded with the rows/columns needed by the dilate/erode operations of
+ * FindHSVBlobs() and merged until they do not overlap. Blobs found in the
+ * regions are the same as on the whole image. If masked out pixels
+ * belong to a used color, the region is the whole image.
+ *
+ * \param mask        the rat mask created by DetectRats()
+ * \param cs          control state structure
+ * \param mColor      the color definition database
+ * \param mHSVLookup  the lookup table of the current color definitions
+ * \param labeler     component labeler used on the mask
+ * \param regions     the output regions
+ */
+void FindRatRegions(cBitMask &mask, cCS* cs, cColor* mColor,
+		tHSVLookup* mHSVLookup, cComponentLabeler& labeler,
+		std::vector<cv::Rect>& regions);
+
+/**
+ * Finds all blobs on a label image belonging to a given color.
+ *
+ * \param labelimage  the label image created by ClassifyColors()
  * \param i           the color index corresponding to the image
- * \param filterimage the filtered binary image containing blobs
-                      (note that its output is also modified by
-					  the contour finding method during processing)
  * \param mColor      the color definition database
  * \param cs          control state structure
+ * \param bws         blob workspace, bws->filtermask is the filtered mask
+ *                    containing blobs (output)
  * \param mBlobParticles  structure holding the found blobs
  * \param currentframe  the current video frame index
  * \param ofslog      output log file stream
+ * \param regions     if not NULL, only these regions created by
+ *                    FindRatRegions() are processed (filtermask then
+ *                    holds the last region)
+ * \param windows     if not NULL, only these search windows created by
+ *                    GetTrackingWindows() are processed. If a blob is
+ *                    closer to a window border inside the image than
+ *                    RegionPadding(), it might continue outside the window,
+ *                    so the color is searched in regions (or on the whole
+ *                    image) instead.
+ * \param bFullScan   set to true if windows were not enough (if not NULL)
  *
  */
-void FindHSVBlobs(cv::Mat &HSVimage, int i, cv::Mat &filterimage,
-		cColor* mColor, cCS* cs,  tBlob& mBlobParticles,
-		int currentframe, std::ofstream& ofslog);
+void FindHSVBlobs(cv::Mat &labelimage, int i, cColor* mColor, cCS* cs,
+		cBlobWorkspace* bws, tBlob& mBlobParticles,
+		int currentframe, cTextWriter& ofslog,
+		std::vector<cv::Rect>* regions = NULL,
+		std::vector<cv::Rect>* windows = NULL, bool* bFullScan = NULL);
+
+/**
+ * Finds all blobs of all used colors on a label image in parallel.
+ *
+ * Colors are distributed between cs->colorthreads worker threads, each
+ * worker having its own blob workspace and each color its own blob list
+ * and log buffer. Results are merged in increasing color order, so
+ * mBlobParticles and the log output are the same as with consecutive
+ * FindHSVBlobs() calls. The worker threads are started on the first call
+ * (or when cs->colorthreads changes) and are reused on later calls.
+ *
+ * \param labelimage    the label image created by ClassifyColors()
+ * \param workers       the pool of worker threads
+ * \param colorws       array of MAXMBASE blob workspaces, one for each worker
+ * \param colorParticles  array of MAXMBASE blob stores, one for each color
+ *                      (cleared here, kept to reuse their memory)
+ * \param colorLog      array of MAXMBASE log buffers, one for each color
+ *                      (cleared here)
+ * \param mColor        the color definition database
+ * \param cs            control state structure
+ * \param mBlobParticles  structure holding the found blobs
+ * \param currentframe  the current video frame index
+ * \param ofslog        output log file stream
+ * \param regions       if not NULL, array of MAXMBASE region lists, the
+ *                      regions of each color (NULL - whole image)
+ * \param windows       if not NULL, array of MAXMBASE search window lists
+ *                      of each color (NULL - use regions)
+ * \param bFullScan     if not NULL, array of MAXMBASE flags, set for the
+ *                      colors where windows were not enough (see FindHSVBlobs())
+ *
+ * Note that debug windows can only be shown from the main thread, so
+ * cs->bShowDebugVideo must be false (use FindHSVBlobs() otherwise).
+ */
+void FindHSVBlobsParallel(cv::Mat &labelimage, cWorkerPool* workers,
+		cBlobWorkspace* colorws, tBlob* colorParticles, cTextWriter* colorLog,
+		cColor* mColor, cCS* cs, tBlob& mBlobParticles,
+		int currentframe, cTextWriter& ofslog,
+		std::vector<cv::Rect>** regions = NULL,
+		std::vector<cv::Rect>** windows = NULL, bool* bFullScan = NULL);
 
 /**
  * Finds motion / rat blobs on a binary image.
  *
  * \param srcBin        the binary image on which blobs are to be found
  * \param cs            control state structure
+ * \param bws           blob workspace
  * \param mParticles    structure holding the found blobs
  * \param currentframe  the current video frame index
  * \param ofslog        output log file stream
+ * \param downscale     srcBin is downscaled by this factor (see
+ *                      cvDownscale()), blobs are given in original pixels
  *
  * Note that srcBin is modified due to the inner contour finding method.
  */
-void FindMDorRatBlobs(cv::Mat &srcBin, cCS* cs, tBlob& mParticles,
-		int currentframe, std::ofstream& ofslog);
+void FindMDorRatBlobs(cv::Mat &srcBin, cCS* cs, cBlobWorkspace* bws,
+		tBlob& mParticles, int currentframe, cTextWriter& ofslog,
+		int downscale = 1);
+
+/**
+ * FindMDorRatBlobs() on a bit-packed mask (the mask is not modified).
+ *
+ * \param srcMask       the mask on which blobs are to be found
+ * \param cs            control state structure
+ * \param bws           blob workspace
+ * \param mParticles    structure holding the found blobs
+ * \param currentframe  the current video frame index
+ * \param ofslog        output log file stream
+ * \param downscale     srcMask is downscaled by this factor
+ */
+void FindMDorRatBlobs(cBitMask &srcMask, cCS* cs, cBlobWorkspace* bws,
+		tBlob& mParticles, int currentframe, cTextWriter& ofslog,
+		int downscale = 1);
+
+/**
+ * Store properly sized motion / rat blobs from blob moments
+ * (second half of FindMDorRatBlobs()).
+ *
+ * \param blobmoments   the moments of all blobs found on the binary image
+ * \param cs            control state structure
+ * \param bws           blob workspace (its moment and ellipse batches are used)
+ * \param mParticles    structure holding the found blobs
+ * \param currentframe  the current video frame index
+ * \param ofslog        output log file stream
+ */
+void MDorRatBlobsFromMoments(std::vector<cv::Moments>& blobmoments, cCS* cs,
+        cBlobWorkspace* bws, tBlob& mParticles, int currentframe,
+        cTextWriter& ofslog);
 
 /**
  * Filter background and return remaining image and its 'rat' blobs found.
@@ -107,16 +537,39 @@ void FindMDorRatBlobs(cv::Mat &srcBin, cCS* cs, tBlob& mParticles,
  * Name 'rat' comes from the fact that in the original experiment we had
  * rats to be found on the images.
  *
- * \param hsvimage      the HSV image on which background needs to be filtered
- * \param maskimage     the output binary mask image after filtering
- * \param mBGColor      the color definition of the background
+ * \param labelimage    the label image created by ClassifyColors()
+ * \param mask          the output rat mask after filtering
  * \param cs            control state structure
+ * \param bws           blob workspace
  * \param mParticles    structure holding the found non-bacground blobs
  * \param currentframe  the current video frame index
  * \param ofslog        output log file stream
  *
  */
-void DetectRats(cv::Mat &hsvimage, cv::Mat &maskimage, tColor* mBGColor,
-		cCS* cs, tBlob& mParticles, int currentframe, std::ofstream& ofslog);
+void DetectRats(cv::Mat &labelimage, cBitMask &mask, cCS* cs,
+		cBlobWorkspace* bws, tBlob& mParticles, int currentframe,
+		cTextWriter& ofslog);
+
+/**
+ * DetectRats() on an image downscaled by cs->ratdownscale: the rat blobs
+ * are filtered and found on the small image (with scaled erode/dilate
+ * iterations), mask is its full resolution upscaled version and rat
+ * blobs are given in full resolution coordinates.
+ *
+ * \param labelimage    the label image created by ClassifyColors()
+ * \param mask          the output rat mask after filtering
+ * \param binary        temporary binary image of the rat blobs
+ * \param smallimage    temporary downscaled binary image of the rat blobs
+ * \param smallmask     temporary downscaled mask of the rat blobs
+ * \param cs            control state structure
+ * \param bws           blob workspace
+ * \param mParticles    structure holding the found non-bacground blobs
+ * \param currentframe  the current video frame index
+ * \param ofslog        output log file stream
+ */
+void DetectRatsDownscaled(cv::Mat &labelimage, cBitMask &mask,
+		cv::Mat &binary, cv::Mat &smallimage, cBitMask &smallmask, cCS* cs,
+		cBlobWorkspace* bws, tBlob& mParticles, int currentframe,
+		cTextWriter& ofslog);
 
 #endif
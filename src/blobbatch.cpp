@@ -0,0 +1,116 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "blob.h"
+#include "simd.h"
+
+void cMomentBatch::Clear() {
+    m00.clear();
+    m10.clear();
+    m01.clear();
+    mu20.clear();
+    mu11.clear();
+    mu02.clear();
+    mu30.clear();
+    mu03.clear();
+}
+
+void cMomentBatch::Add(cv::Moments &moments) {
+    m00.push_back(moments.m00);
+    m10.push_back(moments.m10);
+    m01.push_back(moments.m01);
+    mu20.push_back(moments.mu20);
+    mu11.push_back(moments.mu11);
+    mu02.push_back(moments.mu02);
+    mu30.push_back(moments.mu30);
+    mu03.push_back(moments.mu03);
+}
+
+// scalar version of center, radius and axes from blob j to n-1, with the
+// same operations as FillParticleFromMoments()
+static void FillEllipseRange(cMomentBatch &m, cEllipseBatch &e, int j, int n) {
+    double d1, d2, x;
+
+    for (; j < n; j++) {
+        e.radius[j] = sqrt(m.m00[j] / M_PI);
+        e.cx[j] = m.m10[j] / m.m00[j];
+        e.cy[j] = m.m01[j] / m.m00[j];
+        d1 = (m.mu20[j] + m.mu02[j]) / 2;
+        d2 = sqrt(4 * m.mu11[j] * m.mu11[j] + (m.mu20[j] - m.mu02[j]) *
+                (m.mu20[j] - m.mu02[j])) / 2;
+        x = sqrt((d1 - d2) / (d1 + d2));
+        e.axisA[j] = sqrt(m.m00[j] / (M_PI * x));
+        e.axisB[j] = e.axisA[j] * x;
+    }
+}
+
+#ifdef SIMD_X86
+
+// AVX version, four blobs at a time, returns the number of blobs processed
+// (IEEE division and square root give the same results as the scalar code)
+TARGET_AVX static int FillEllipseRangeAVX(cMomentBatch &m, cEllipseBatch &e,
+        int n) {
+    const __m256d pi = _mm256_set1_pd(M_PI);
+    const __m256d two = _mm256_set1_pd(2);
+    const __m256d four = _mm256_set1_pd(4);
+    __m256d m00, mu20, mu11, mu02, diff, d1, d2, x, a;
+    int j;
+
+    for (j = 0; j + 4 <= n; j += 4) {
+        m00 = _mm256_loadu_pd(&m.m00[j]);
+        mu20 = _mm256_loadu_pd(&m.mu20[j]);
+        mu11 = _mm256_loadu_pd(&m.mu11[j]);
+        mu02 = _mm256_loadu_pd(&m.mu02[j]);
+        _mm256_storeu_pd(&e.radius[j], _mm256_sqrt_pd(_mm256_div_pd(m00, pi)));
+        _mm256_storeu_pd(&e.cx[j], _mm256_div_pd(_mm256_loadu_pd(&m.m10[j]), m00));
+        _mm256_storeu_pd(&e.cy[j], _mm256_div_pd(_mm256_loadu_pd(&m.m01[j]), m00));
+        diff = _mm256_sub_pd(mu20, mu02);
+        d1 = _mm256_div_pd(_mm256_add_pd(mu20, mu02), two);
+        d2 = _mm256_div_pd(_mm256_sqrt_pd(_mm256_add_pd(
+                _mm256_mul_pd(_mm256_mul_pd(four, mu11), mu11),
+                _mm256_mul_pd(diff, diff))), two);
+        x = _mm256_sqrt_pd(_mm256_div_pd(_mm256_sub_pd(d1, d2), _mm256_add_pd(d1, d2)));
+        a = _mm256_sqrt_pd(_mm256_div_pd(m00, _mm256_mul_pd(pi, x)));
+        _mm256_storeu_pd(&e.axisA[j], a);
+        _mm256_storeu_pd(&e.axisB[j], _mm256_mul_pd(a, x));
+    }
+    return j;
+}
+
+#endif // SIMD_X86
+
+void FillEllipsesFromMoments(cMomentBatch &moments, cEllipseBatch &ellipses,
+        bool bSkew) {
+    int j = 0, n = moments.Size();
+    double sx, sy, sA;
+
+    ellipses.cx.resize(n);
+    ellipses.cy.resize(n);
+    ellipses.radius.resize(n);
+    ellipses.axisA.resize(n);
+    ellipses.axisB.resize(n);
+    ellipses.orientation.resize(n);
+
+    // center, radius and axes
+#ifdef SIMD_X86
+    static const bool bAVX = cv::checkHardwareSupport(CV_CPU_AVX);
+    if (bAVX)
+        j = FillEllipseRangeAVX(moments, ellipses, n);
+#endif
+    // remaining blobs (or all on other architectures)
+    FillEllipseRange(moments, ellipses, j, n);
+
+    // orientation, with the optional skew correction
+    for (j = 0; j < n; j++) {
+        ellipses.orientation[j] = atan2(2 * moments.mu11[j],
+                moments.mu20[j] - moments.mu02[j]) / 2;
+        if (bSkew) {
+            sx = moments.mu30[j] / pow(moments.mu20[j], 1.5);
+            sy = moments.mu03[j] / pow(moments.mu02[j], 1.5);
+            sA = sx * cos(ellipses.orientation[j]) +
+                    sy * sin(ellipses.orientation[j]);
+            if (sA > 0)
+                ellipses.orientation[j] += M_PI;
+        }
+    }
+}
@@ -0,0 +1,548 @@
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+
+#include "blobfile.h"
+#include "log.h"
+#include "output_text.h"
+
+#define BINARYBLOBHEADERSIZE 16   // magic, version, flags
+#define BINARYBLOBTRAILERSIZE 24  // index offset, number of frames, magic
+
+////////////////////////////////////////////////////////////////////////////////
+// binary helpers
+
+template <typename T>
+static void WriteValue(std::ostream& ofs, T value) {
+    ofs.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static bool ReadValue(std::istream& ifs, T* value) {
+    return (bool)ifs.read((char*)value, sizeof(T));
+}
+
+template <typename T>
+static void WriteColumn(std::ostream& ofs, std::vector<T>& column) {
+    if (!column.empty())
+        ofs.write((const char*)column.data(), column.size() * sizeof(T));
+}
+
+template <typename T>
+static bool ReadColumn(std::istream& ifs, std::vector<T>& column, int count) {
+    column.resize(count);
+    if (!count)
+        return true;
+    return (bool)ifs.read((char*)column.data(), count * sizeof(T));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// reads all lines of a frame after the frame number, flags must be set
+static bool ReadFrameColumns(std::istream& ifs, cBlobFrame& frame) {
+    int i;
+    int32_t count;
+    // MD
+    if (frame.flags & BLOBFILE_MD) {
+        if (!ReadValue(ifs, &count) || count < 0)
+            return false;
+        for (i = 0; i < BLOBFILE_MD_COLUMNS; i++)
+            if (!ReadColumn(ifs, frame.md[i], count))
+                return false;
+    }
+    // RAT
+    if (!ReadValue(ifs, &count) || count < 0)
+        return false;
+    for (i = 0; i < BLOBFILE_RAT_COLUMNS; i++)
+        if (!ReadColumn(ifs, frame.rat[i], count))
+            return false;
+    // BLOB/BLOBE
+    if (!ReadValue(ifs, &count) || count < 0 ||
+            !ReadColumn(ifs, frame.color, count))
+        return false;
+    for (i = 0; i < frame.BlobColumns(); i++)
+        if (!ReadColumn(ifs, frame.blob[i], count))
+            return false;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cBinaryBlobWriter::Open(const char* filename, int flags) {
+    this->flags = flags;
+    index.clear();
+    ofs.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!ofs.is_open()) {
+        LOG_ERROR("Could not open binary blob file '%s' for writing.", filename);
+        return false;
+    }
+    ofs.write(BINARYBLOBMAGIC, 8);
+    WriteValue<int32_t>(ofs, BINARYBLOBVERSION);
+    WriteValue<int32_t>(ofs, flags);
+
+    return ofs.good();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cBinaryBlobWriter::Write(cBlobFrame& frame) {
+    int i;
+    index.push_back(std::make_pair(frame.framenum, (long long)ofs.tellp()));
+    WriteValue<int32_t>(ofs, frame.framenum);
+    // MD
+    if (flags & BLOBFILE_MD) {
+        WriteValue<int32_t>(ofs, (int32_t)frame.md[0].size());
+        for (i = 0; i < BLOBFILE_MD_COLUMNS; i++)
+            WriteColumn(ofs, frame.md[i]);
+    }
+    // RAT
+    WriteValue<int32_t>(ofs, (int32_t)frame.rat[0].size());
+    for (i = 0; i < BLOBFILE_RAT_COLUMNS; i++)
+        WriteColumn(ofs, frame.rat[i]);
+    // BLOB/BLOBE
+    WriteValue<int32_t>(ofs, (int32_t)frame.color.size());
+    WriteColumn(ofs, frame.color);
+    for (i = 0; i < ((flags & BLOBFILE_BLOBE) ? BLOBFILE_BLOBE_COLUMNS :
+            BLOBFILE_BLOB_COLUMNS); i++)
+        WriteColumn(ofs, frame.blob[i]);
+
+    return ofs.good();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cBinaryBlobWriter::Close() {
+    bool ret;
+    if (!ofs.is_open())
+        return true;
+    // write index and trailer
+    long long indexoffset = (long long)ofs.tellp();
+    for (size_t i = 0; i < index.size(); i++) {
+        WriteValue<int32_t>(ofs, index[i].first);
+        WriteValue<int32_t>(ofs, 0);
+        WriteValue<int64_t>(ofs, index[i].second);
+    }
+    WriteValue<int64_t>(ofs, indexoffset);
+    WriteValue<int64_t>(ofs, (int64_t)index.size());
+    ofs.write(BINARYBLOBINDEXMAGIC, 8);
+    ofs.flush();
+    ret = ofs.good();
+    ofs.close();
+    index.clear();
+
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cBinaryBlobReader::Open(const char* filename) {
+    char magic[8];
+    int32_t version, fileflags, framenum, reserved;
+    int64_t indexoffset, nframes, offset;
+    long long filesize;
+
+    index.clear();
+    lastframe = -1;
+    ifs.open(filename, std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) {
+        LOG_ERROR("Could not open binary blob file '%s'.", filename);
+        return false;
+    }
+    // read header
+    if (!ifs.read(magic, 8) || memcmp(magic, BINARYBLOBMAGIC, 8) ||
+            !ReadValue(ifs, &version) || !ReadValue(ifs, &fileflags)) {
+        LOG_ERROR("'%s' is not a binary blob file.", filename);
+        return false;
+    }
+    if (version != BINARYBLOBVERSION) {
+        LOG_ERROR("Unsupported binary blob file version (%d).", version);
+        return false;
+    }
+    flags = fileflags;
+    // read index from the end of file, if it was closed properly
+    ifs.seekg(0, std::ios::end);
+    filesize = (long long)ifs.tellg();
+    dataend = filesize;
+    if (filesize >= BINARYBLOBHEADERSIZE + BINARYBLOBTRAILERSIZE) {
+        ifs.seekg(filesize - BINARYBLOBTRAILERSIZE);
+        if (ReadValue(ifs, &indexoffset) && ReadValue(ifs, &nframes) &&
+                ifs.read(magic, 8) && !memcmp(magic, BINARYBLOBINDEXMAGIC, 8) &&
+                indexoffset >= BINARYBLOBHEADERSIZE && nframes >= 0 &&
+                indexoffset + nframes * 16 + BINARYBLOBTRAILERSIZE == filesize) {
+            ifs.seekg(indexoffset);
+            index.reserve((size_t)nframes);
+            for (int64_t i = 0; i < nframes; i++) {
+                if (!ReadValue(ifs, &framenum) || !ReadValue(ifs, &reserved) ||
+                        !ReadValue(ifs, &offset)) {
+                    LOG_ERROR("Could not read index of binary blob file.");
+                    return false;
+                }
+                index.push_back(std::make_pair((int)framenum, (long long)offset));
+            }
+            dataend = indexoffset;
+        } else {
+            std::cout << "Warning: binary blob file has no index, seeking is disabled." << std::endl;
+        }
+    }
+    ifs.clear();
+    ifs.seekg(BINARYBLOBHEADERSIZE);
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int cBinaryBlobReader::Read(cBlobFrame& frame) {
+    int32_t framenum;
+
+    if ((long long)ifs.tellg() >= dataend)
+        return 0;
+    frame.Reset();
+    frame.flags = flags;
+    if (!ReadValue(ifs, &framenum)) {
+        // truncated file without index
+        if (index.empty())
+            return 0;
+        LOG_ERROR("Could not read frame from binary blob file.");
+        return -1;
+    }
+    frame.framenum = framenum;
+    if (!ReadFrameColumns(ifs, frame)) {
+        LOG_ERROR("Invalid binary blob file format at frame %d.", framenum);
+        return -1;
+    }
+    lastframe = framenum;
+
+    return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cBinaryBlobReader::Seek(int framenum) {
+    std::vector<std::pair<int, long long> >::iterator it;
+    if (index.empty())
+        return false;
+    it = std::lower_bound(index.begin(), index.end(),
+            std::make_pair(framenum, (long long)-1));
+    ifs.clear();
+    ifs.seekg(it == index.end() ? dataend : it->second);
+    lastframe = (it == index.begin() || it == index.end()) ? -1 : (it - 1)->first;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cBinaryBlobReader::Close() {
+    ifs.close();
+    index.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// round to the precision of text blob files
+static inline double RoundBlobValue(double value) {
+    return RoundFixed(value, BLOBFILEDECIMALS);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// output coordinates are in total image coordinates, not ROI
+void FillBlobFrame(cCS* cs, cBlobFrame& frame, tBlob& mBlobParticles,
+        tBlob& mMDParticles, tBlob& mRatParticles, int currentframe) {
+    size_t j;
+    frame.Reset();
+    frame.framenum = currentframe;
+    frame.flags = (cs->bMotionDetection ? BLOBFILE_MD : 0) |
+            (cs->bBlobE ? BLOBFILE_BLOBE : 0);
+    // MD
+    if (cs->bMotionDetection) {
+        for (j = 0; j < mMDParticles.size(); j++) {
+            frame.md[0].push_back(RoundBlobValue(mMDParticles.cx[j] + cs->imageROI.x));
+            frame.md[1].push_back(RoundBlobValue(mMDParticles.cy[j] + cs->imageROI.y));
+            frame.md[2].push_back(RoundBlobValue(mMDParticles.axisA[j]));
+            frame.md[3].push_back(RoundBlobValue(mMDParticles.axisB[j]));
+            frame.md[4].push_back(RoundBlobValue(mMDParticles.orientation[j] * 180 / M_PI)); // [deg]
+        }
+    }
+    // RAT
+    for (j = 0; j < mRatParticles.size(); j++) {
+        frame.rat[0].push_back(RoundBlobValue(mRatParticles.cx[j] + cs->imageROI.x));
+        frame.rat[1].push_back(RoundBlobValue(mRatParticles.cy[j] + cs->imageROI.y));
+        frame.rat[2].push_back(RoundBlobValue(mRatParticles.axisA[j]));
+        frame.rat[3].push_back(RoundBlobValue(mRatParticles.axisB[j]));
+        frame.rat[4].push_back(RoundBlobValue(mRatParticles.orientation[j] * 180 / M_PI)); // [deg]
+    }
+    // BLOB/BLOBE
+    for (j = 0; j < mBlobParticles.size(); j++) {
+        frame.color.push_back(mBlobParticles.index[j]);
+        frame.blob[0].push_back(RoundBlobValue(mBlobParticles.cx[j] + cs->imageROI.x));
+        frame.blob[1].push_back(RoundBlobValue(mBlobParticles.cy[j] + cs->imageROI.y));
+        if (cs->bBlobE) {
+            frame.blob[2].push_back(RoundBlobValue(mBlobParticles.axisA[j]));
+            frame.blob[3].push_back(RoundBlobValue(mBlobParticles.axisB[j]));
+            frame.blob[4].push_back(RoundBlobValue(mBlobParticles.orientation[j] * 180 / M_PI)); // [deg]
+        } else {
+            frame.blob[2].push_back(RoundBlobValue(mBlobParticles.radius[j]));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BlobFrameToParticles(cCS* cs, cBlobFrame& frame, tBlob& mBlobParticles,
+        tBlob& mMDParticles, tBlob& mRatParticles) {
+    double a, b, r;
+    size_t i;
+    // MD
+    for (i = 0; i < frame.md[0].size(); i++) {
+        mMDParticles.Add(0, frame.md[0][i] - cs->imageROI.x,
+                frame.md[1][i] - cs->imageROI.y, frame.md[2][i], frame.md[3][i],
+                frame.md[4][i] * M_PI / 180.0, 0, 0); // [rad]
+    }
+    // RAT
+    for (i = 0; i < frame.rat[0].size(); i++) {
+        mRatParticles.Add(0, frame.rat[0][i] - cs->imageROI.x,
+                frame.rat[1][i] - cs->imageROI.y, frame.rat[2][i], frame.rat[3][i],
+                frame.rat[4][i] * M_PI / 180.0, 0, 0); // [rad]
+    }
+    // BLOB/BLOBE
+    for (i = 0; i < frame.color.size(); i++) {
+        if (frame.flags & BLOBFILE_BLOBE) {
+            a = frame.blob[2][i];
+            b = frame.blob[3][i];
+            mBlobParticles.Add(frame.color[i], frame.blob[0][i] - cs->imageROI.x,
+                    frame.blob[1][i] - cs->imageROI.y, a, b,
+                    frame.blob[4][i] * M_PI / 180.0, 0, sqrt(a * b)); // [rad]
+        } else {
+            r = frame.blob[2][i];
+            mBlobParticles.Add(frame.color[i], frame.blob[0][i] - cs->imageROI.x,
+                    frame.blob[1][i] - cs->imageROI.y, r, r, 0, 0, r);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteBlobFrameText(cTextWriter& ofs, cBlobFrame& frame) {
+    size_t i;
+    // write MD line
+    if (frame.flags & BLOBFILE_MD) {
+        ofs << frame.framenum << "\tMD\t" << (int) frame.md[0].size() << "\t";
+        for (i = 0; i < frame.md[0].size(); i++) {
+            ofs << "{" << frame.md[0][i] << "\t" << frame.md[1][i] << "\t" << frame.md[2][i] << "\t" << frame.md[3][i] << "\t" << frame.md[4][i] << "}\t";
+        }
+        ofs << "\n";
+    }
+    // write RAT line
+    ofs << frame.framenum << "\tRAT\t" << (int) frame.rat[0].size() << "\t";
+    for (i = 0; i < frame.rat[0].size(); i++) {
+        ofs << "{" << frame.rat[0][i] << "\t" << frame.rat[1][i] << "\t" << frame.rat[2][i] << "\t" << frame.rat[3][i] << "\t" << frame.rat[4][i] << "}\t";
+    }
+    ofs << "\n";
+    // write BLOBE line (as ellipse)
+    if (frame.flags & BLOBFILE_BLOBE) {
+        ofs << frame.framenum << "\tBLOBE\t" << (int) frame.color.size() << "\t";
+        for (i = 0; i < frame.color.size(); i++) {
+            ofs << "{" << frame.color[i] << "\t" << frame.blob[0][i] << "\t" << frame.blob[1][i] << "\t" << frame.blob[2][i] << "\t" << frame.blob[3][i] << "\t" << frame.blob[4][i] << "}\t";
+        }
+    // write BLOB line (as circles)
+    } else {
+        ofs << frame.framenum << "\tBLOB\t" << (int) frame.color.size() << "\t";
+        for (i = 0; i < frame.color.size(); i++) {
+            ofs << "{" << frame.color[i] << "\t" << frame.blob[0][i] << "\t"
+                    << frame.blob[1][i] << "\t" << frame.blob[2][i] << "}\t";
+        }
+    }
+    ofs << "\n";
+    return ofs.good();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int ReadBlobFrameText(std::istream& ifs, cBlobFrame& frame) {
+    std::string line;
+    std::vector<double>* columns;
+    char *p, *end;
+    int i, j, k, framenum, count, ncolumns;
+    bool bStarted = false;
+
+    frame.Reset();
+    while (getline(ifs, line)) {
+        if (!line.length() || line[0] == '#')
+            continue;
+        // group brackets are separators only
+        std::replace(line.begin(), line.end(), '{', ' ');
+        std::replace(line.begin(), line.end(), '}', ' ');
+        p = &line[0];
+        // get frame number
+        framenum = (int)strtol(p, &end, 10);
+        if (end == p) {
+            LOG_ERROR("Invalid frame number in text blob file.");
+            return -1;
+        }
+        if (bStarted && framenum != frame.framenum) {
+            LOG_ERROR("Missing BLOB line in text blob file at frame %d.", frame.framenum);
+            return -1;
+        }
+        frame.framenum = framenum;
+        bStarted = true;
+        // get line type
+        p = end;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        end = p;
+        while (*end && *end != ' ' && *end != '\t')
+            end++;
+        std::string linetype(p, end - p);
+        if (linetype == "MD") {
+            frame.flags |= BLOBFILE_MD;
+            columns = frame.md;
+            ncolumns = BLOBFILE_MD_COLUMNS;
+        } else if (linetype == "RAT") {
+            columns = frame.rat;
+            ncolumns = BLOBFILE_RAT_COLUMNS;
+        } else if (linetype == "BLOBE") {
+            frame.flags |= BLOBFILE_BLOBE;
+            columns = frame.blob;
+            ncolumns = BLOBFILE_BLOBE_COLUMNS;
+        } else if (linetype == "BLOB") {
+            columns = frame.blob;
+            ncolumns = BLOBFILE_BLOB_COLUMNS;
+        } else {
+            LOG_ERROR("Unknown line type in text blob file at frame %d.", framenum);
+            return -1;
+        }
+        // get blob count
+        p = end;
+        count = (int)strtol(p, &end, 10);
+        if (end == p || count < 0) {
+            LOG_ERROR("Invalid blob count in text blob file at frame %d.", framenum);
+            return -1;
+        }
+        // get blobs
+        for (j = 0; j < count; j++) {
+            if (columns == frame.blob) {
+                p = end;
+                k = (int)strtol(p, &end, 10);
+                if (end == p)
+                    break;
+                frame.color.push_back(k);
+            }
+            for (i = 0; i < ncolumns; i++) {
+                p = end;
+                columns[i].push_back(strtod(p, &end));
+                if (end == p)
+                    break;
+            }
+            if (i < ncolumns)
+                break;
+        }
+        if (j < count) {
+            LOG_ERROR("Invalid input format in text blob file at frame %d.", framenum);
+            return -1;
+        }
+        // BLOB line is the last one of each frame
+        if (columns == frame.blob)
+            return 1;
+    }
+    if (bStarted) {
+        LOG_ERROR("Missing BLOB line in text blob file at frame %d.", frame.framenum);
+        return -1;
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReadNextBlobsFromBinaryFile(cBinaryBlobReader& reader,
+        cBlobFrame& blobframe, tBlob& mBlobParticles, tBlob& mMDParticles,
+        tBlob& mRatParticles, cCS* cs, int currentframe) {
+    int i;
+    // we expect MD lines if motion detection is turned on
+    if (cs->bMotionDetection && !(reader.flags & BLOBFILE_MD)) {
+        LOG_ERROR("Input blob file does not contain motion detection data.");
+        return false;
+    }
+    // jump directly to the current frame if it is not the next one
+    if (reader.lastframe + 1 != currentframe)
+        reader.Seek(currentframe);
+    // read until current frame
+    while (1) {
+        i = reader.Read(blobframe);
+        if (i < 0) {
+            return false;
+        } else if (i == 0) {
+            LOG_ERROR("No frame left to read from input blob file for current frame.");
+            return false;
+        }
+        if (blobframe.framenum < currentframe)
+            continue;
+        else if (blobframe.framenum > currentframe) {
+            LOG_ERROR("Input blob file frame No. mismatch: read number is too large (i=%d, currentframe=%d)", blobframe.framenum, currentframe);
+            return false;
+        }
+        break;
+    }
+    BlobFrameToParticles(cs, blobframe, mBlobParticles, mMDParticles,
+            mRatParticles);
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ConvertBlobFile(const char* infile, const char* outfile) {
+    cBlobFrame blobframe;
+    char magic[8];
+    int i, n = 0;
+    bool bBinary;
+    // check input file format
+    std::ifstream ifs(infile, std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) {
+        LOG_ERROR("Could not open input blob file '%s'.", infile);
+        return false;
+    }
+    bBinary = ifs.read(magic, 8) && !memcmp(magic, BINARYBLOBMAGIC, 8);
+    ifs.close();
+
+    // binary to text
+    if (bBinary) {
+        cBinaryBlobReader reader;
+        cCS tempcs;
+        cTextWriter ofs;
+        if (!reader.Open(infile))
+            return false;
+        tempcs.bMotionDetection = (reader.flags & BLOBFILE_MD) != 0;
+        tempcs.bBlobE = (reader.flags & BLOBFILE_BLOBE) != 0;
+        strncpy(tempcs.outputdatfile, outfile, MAXPATH);
+        if (!WriteBlobFileHeader(&tempcs, ofs))
+            return false;
+        while ((i = reader.Read(blobframe)) > 0) {
+            if (!WriteBlobFrameText(ofs, blobframe))
+                return false;
+            n++;
+        }
+        if (!ofs.Close() || i < 0) {
+            return false;
+        }
+    // text to binary
+    } else {
+        cBinaryBlobWriter writer;
+        ifs.open(infile, std::ios::in);
+        // flags are known from the first frame only
+        i = ReadBlobFrameText(ifs, blobframe);
+        if (i < 0 || !writer.Open(outfile, blobframe.flags))
+            return false;
+        while (i > 0) {
+            if (blobframe.flags != writer.flags) {
+                LOG_ERROR("Inconsistent line types in text blob file at frame %d.", blobframe.framenum);
+                return false;
+            }
+            if (!writer.Write(blobframe))
+                return false;
+            n++;
+            i = ReadBlobFrameText(ifs, blobframe);
+        }
+        if (i < 0 || !writer.Close()) {
+            return false;
+        }
+    }
+    std::cout << "Converted " << n << " frames from " <<
+            (bBinary ? "binary" : "text") << " blob file '" << infile <<
+            "' to " << (bBinary ? "text" : "binary") << " blob file '" <<
+            outfile << "'" << std::endl;
+
+    return true;
+}
@@ -0,0 +1,190 @@
+#ifndef HEADER_BLOBFILE
+#define HEADER_BLOBFILE
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include "blob.h"
+#include "ini.h"
+#include "textwriter.h"
+
+// file name tag of binary blob files (appended to .blobs)
+#define BINARYBLOBTAG ".bin"
+
+// magic strings and version of binary blob files
+#define BINARYBLOBMAGIC "RATBLOBS"
+#define BINARYBLOBINDEXMAGIC "RATBLIDX"
+#define BINARYBLOBVERSION 1
+
+// number of decimals of blob values, binary files store them rounded the same way
+#define BLOBFILEDECIMALS 1
+
+// flags of blob files, telling which lines are present in each frame
+#define BLOBFILE_MD 1           // MD lines are present
+#define BLOBFILE_BLOBE 2        // BLOBE lines instead of BLOB lines
+
+// number of columns of the different line types (without color)
+#define BLOBFILE_MD_COLUMNS 5   // centerx centery axisA axisB orientation
+#define BLOBFILE_RAT_COLUMNS 5  // centerx centery axisA axisB orientation
+#define BLOBFILE_BLOB_COLUMNS 3 // centerx centery radius
+#define BLOBFILE_BLOBE_COLUMNS 5 // centerx centery axisA axisB orientation
+
+// All blobs of one frame as they are stored in blob files: in full image
+// coordinates (not ROI) and with orientation in degrees, in columns.
+class cBlobFrame {
+  public:
+    int framenum;               // frame number
+    int flags;                  // BLOBFILE_MD | BLOBFILE_BLOBE
+    std::vector<double> md[BLOBFILE_MD_COLUMNS];      // MD columns
+    std::vector<double> rat[BLOBFILE_RAT_COLUMNS];    // RAT columns
+    std::vector<int> color;                           // BLOB/BLOBE color index
+    std::vector<double> blob[BLOBFILE_BLOBE_COLUMNS]; // BLOB/BLOBE columns
+    //! Constructor.
+    cBlobFrame() {
+        Reset();
+    }
+    //! Destructor.
+    ~cBlobFrame() {
+    }
+    // reset (without releasing memory)
+    void Reset() {
+        int i;
+        framenum = 0;
+        flags = 0;
+        for (i = 0; i < BLOBFILE_MD_COLUMNS; i++)
+            md[i].clear();
+        for (i = 0; i < BLOBFILE_RAT_COLUMNS; i++)
+            rat[i].clear();
+        color.clear();
+        for (i = 0; i < BLOBFILE_BLOBE_COLUMNS; i++)
+            blob[i].clear();
+    }
+    // number of columns of BLOB/BLOBE lines
+    int BlobColumns() const {
+        return (flags & BLOBFILE_BLOBE) ? BLOBFILE_BLOBE_COLUMNS :
+                BLOBFILE_BLOB_COLUMNS;
+    }
+};
+
+// Writer of binary blob files.
+//
+// File layout (native little endian):
+//   header:  "RATBLOBS", int32 version, int32 flags
+//   frames:  int32 framenum, then for MD (if flag is set), RAT and BLOB/BLOBE:
+//            int32 count, [int32 color[count] for BLOB/BLOBE],
+//            double column[count] for all columns of the line type
+//   index:   {int32 framenum, int32 reserved, int64 offset} for all frames
+//   trailer: int64 index offset, int64 number of frames, "RATBLIDX"
+class cBinaryBlobWriter {
+  public:
+    std::ofstream ofs;
+    int flags;
+    std::vector<std::pair<int, long long> > index; // framenum, offset
+    //! Constructor.
+    cBinaryBlobWriter() : flags(0) {
+    }
+    //! Destructor.
+    ~cBinaryBlobWriter() {
+    }
+    bool Open(const char* filename, int flags);
+    bool Write(cBlobFrame& frame);
+    bool Close();                // writes index, must be called at the end
+};
+
+// Reader of binary blob files.
+class cBinaryBlobReader {
+  public:
+    std::ifstream ifs;
+    int flags;
+    long long dataend;          // end of frame data (start of index)
+    int lastframe;              // frame number of last read frame (-1 if none)
+    std::vector<std::pair<int, long long> > index; // empty if file was not closed properly
+    //! Constructor.
+    cBinaryBlobReader() : flags(0), dataend(0), lastframe(-1) {
+    }
+    //! Destructor.
+    ~cBinaryBlobReader() {
+    }
+    bool Open(const char* filename);
+    int Read(cBlobFrame& frame);          // reads next frame, 1 - OK, 0 - end, <0 - error
+    bool Seek(int framenum);              // seeks to first frame >= framenum
+    void Close();
+};
+
+/**
+ * Collect all blobs of a frame into columns, as they are written to file.
+ * Values are rounded to BLOBFILEDECIMALS, so text and binary files hold the
+ * same numbers.
+ *
+ * \param cs              control states structure
+ * \param frame           the destination columns
+ * \param mBlobParticles  the colored blobs
+ * \param mMDParticles    the motion blobs
+ * \param mRatParticles   the rat blobs
+ * \param currentframe    the current frame
+ */
+void FillBlobFrame(cCS* cs, cBlobFrame& frame, tBlob& mBlobParticles,
+        tBlob& mMDParticles, tBlob& mRatParticles, int currentframe);
+
+/**
+ * Convert the columns of a frame back to blobs (with ROI coordinates).
+ *
+ * \param cs              control states structure
+ * \param frame           the source columns
+ * \param mBlobParticles  the colored blobs (appended)
+ * \param mMDParticles    the motion blobs (appended)
+ * \param mRatParticles   the rat blobs (appended)
+ */
+void BlobFrameToParticles(cCS* cs, cBlobFrame& frame, tBlob& mBlobParticles,
+        tBlob& mMDParticles, tBlob& mRatParticles);
+
+/**
+ * Write all lines of a frame in text format.
+ *
+ * \param ofs    the output text writer (precision set by WriteBlobFileHeader())
+ * \param frame  the frame to write
+ *
+ * \return false if writing to the file failed so far, true otherwise
+ */
+bool WriteBlobFrameText(cTextWriter& ofs, cBlobFrame& frame);
+
+/**
+ * Read the next frame from a text blob file.
+ *
+ * \param ifs    the input text stream
+ * \param frame  the frame read (flags are set from the line types found)
+ *
+ * \return 1 on success, 0 at the end of file, negative on error
+ */
+int ReadBlobFrameText(std::istream& ifs, cBlobFrame& frame);
+
+/**
+ * Read blobs of the current frame from a binary blob file.
+ *
+ * \param reader          the binary blob file reader
+ * \param blobframe       temporary columns of the frame read
+ * \param mBlobParticles  the blob structure to store colored blobs
+ * \param mMDParticles    the blob structure to store motion blobs
+ * \param mRatParticles   the blob structure to store rat blobs
+ * \param cs              control states structure
+ * \param currentframe    the current frame
+ *
+ * \return true on success, false otherwise
+ */
+bool ReadNextBlobsFromBinaryFile(cBinaryBlobReader& reader,
+        cBlobFrame& blobframe, tBlob& mBlobParticles, tBlob& mMDParticles, tBlob& mRatParticles,
+        cCS* cs, int currentframe);
+
+/**
+ * Convert a blob file from text to binary format or vice versa,
+ * depending on the format of the input file. Conversion is lossless.
+ *
+ * \param infile   the input blob file
+ * \param outfile  the output blob file
+ *
+ * \return true on success, false otherwise
+ */
+bool ConvertBlobFile(const char* infile, const char* outfile);
+
+#endif
@@ -10,18 +10,24 @@
 #include "light.h"
 
 ////////////////////////////////////////////////////////////////////////////////
+cv::Rect GetLEDRect(cCS* cs) {
+    const int imsize = 200;     // 200 is OK to fit all cage movements without problems
+
+    return cv::Rect(
+			std::max(cs->mLEDPos.x - imsize / 2, 0),
+            std::max(cs->mLEDPos.y - imsize / 2, 0),
+            imsize, imsize);
+}
+
 // should be called (before ROI is defined) to detect RED LED state
 // avg intensity sets day/night light, but red LED detection can change it to EXTRA/STRANGE
-// param: HSV image converted from smoothinputimage
-bool ReadDayNightLED(cv::Mat &hsv, cv::Mat &inputimage, std::ofstream& ofslog,
+// param: smoothinputimage, only the LED area is converted to HSV
+bool ReadDayNightLED(cv::Mat &smoothimage, cv::Mat &inputimage, cTextWriter& ofslog,
 		cCS* cs, std::list<cColorSet>* mColorDataBase,  cColor* mColor,
-		tColor* mBGColor, lighttype_t* mLight,
-		timed_t inputvideostarttime, int currentframe) {
+		tColor* mBGColor, tHSVLookup* mHSVLookup, cWorkspace* ws,
+		lighttype_t* mLight, timed_t inputvideostarttime, int currentframe) {
     static const int minLEDblobsize = 50; // it used to be 100 but 50 is better according to sample_trial_run measurements
-    static lighttype_t lastLight = UNINITIALIZEDLIGHT;
-    const int imsize = 200;     // 200 is OK to fit all cage movements without problems
     int isdaylight = 0;         // quorum response counter for RGB channels
-	cv::Mat hsvroi;
 
     // calculate average intensity of image. This hopefully clearly separates DAY and NIGHT light conditions.
     // threshold values are determined from avg intensity histograms of 70 random videos:
@@ -43,17 +49,13 @@ bool ReadDayNightLED(cv::Mat &hsv, cv::Mat &inputimage, std::ofstream& ofslog,
         isdaylight++;
 
     // set smaller image ROI to speed up calculation
-    cv::Rect rect(
-			std::max(cs->mLEDPos.x - imsize / 2, 0),
-            std::max(cs->mLEDPos.y - imsize / 2, 0),
-            imsize, imsize);
-    hsvroi = hsv(rect);
-    //cv::imshow("debug", hsv);
-    static cv::Mat filterimage;
-    filterimage = cvCreateImageOnce(filterimage, hsvroi.size(), 8, 1, false);  // no need to zero it
+    cv::Rect rect = GetLEDRect(cs);
+    cv::cvtColor(smoothimage(rect), ws->LEDhsvimage, cv::COLOR_BGR2HSV);
+    //cv::imshow("debug", ws->LEDhsvimage);
+    cv::Mat &filterimage = ws->LEDfilterimage;
     // find hsv blob
-    cvFilterHSV(filterimage, hsvroi, cs->mLEDColor.mColorHSV,
-            cs->mLEDColor.mRangeHSV);
+    cvFilterHSV(filterimage, ws->LEDhsvimage, cs->mLEDColor.mColorHSV,
+            cs->mLEDColor.mRangeHSV, ws->LEDtmpimage);
     cv::dilate(filterimage, filterimage, cv::Mat(), cv::Point(-1, -1), 2);
     cv::erode(filterimage, filterimage, cv::Mat(), cv::Point(-1, -1), 2);
     if (cs->bShowDebugVideo)
@@ -75,6 +77,7 @@ bool ReadDayNightLED(cv::Mat &hsv, cv::Mat &inputimage, std::ofstream& ofslog,
         moments = cv::moments(contours[j]);
         if (moments.m00 > maxmomentsize)
             maxmomentsize = moments.m00;
+        j++;
     }
 
     // if no LED is used, default is NIGHTLIGHT
@@ -101,19 +104,19 @@ bool ReadDayNightLED(cv::Mat &hsv, cv::Mat &inputimage, std::ofstream& ofslog,
     }
 
     // change settings and write change to log file
-    if (*mLight != lastLight) {
+    if (*mLight != ws->lastLight) {
         if (!SetHSVDetectionParams(*mLight, cs->colorselectionmethod,
 				cs->dayssincelastpaint, inputvideostarttime,
-				mColorDataBase, mColor, mBGColor)) {
+				mColorDataBase, mColor, mBGColor, mHSVLookup)) {
             return false;
         }
-        ofslog << currentframe << "\tLED\t" << lighttypename[*mLight] << std::endl;
-        lastLight = *mLight;
+        ofslog << currentframe << "\tLED\t" << lighttypename[*mLight] << "\n";
+        ws->lastLight = *mLight;
     }
     // write average intensity (RGB), number of votes to daylight and max LEDblob size found
     ofslog << currentframe << "\tAVG\t" << avgBGR.val[2] << "\t" << avgBGR.
             val[1] << "\t" << avgBGR.
-            val[0] << "\t" << isdaylight << "\t" << maxmomentsize << std::endl;
+            val[0] << "\t" << isdaylight << "\t" << maxmomentsize << "\n";
 
     // return without error
     return true;
@@ -2,18 +2,31 @@
 #define HEADER_CAGE
 
 #include "ini.h"
+#include "textwriter.h"
+#include "workspace.h"
+
+/**
+ * Get the image area used by ReadDayNightLED().
+ *
+ * \param cs  control settings structure
+ *
+ * \return the LED area on the (ROI) image around cs->mLEDPos
+ */
+cv::Rect GetLEDRect(cCS* cs);
 
 /**
  * Automated LED detection designed specifically for the ELTE 2011 experiment, where
  * a red led indicated the light setting (DAYLIGHT or NIGHTLIGHT).
  *
- * \param hsvimage        the input image in hsv color space
+ * \param smoothimage     the smoothed input image (BGR, ROI)
  * \param inputimage      the original image that is modified to show the LED
  * \param ofslog          the log file where the LED params will be stored
  * \param cs              control settings structure
  * \param mColorDataBase  the color database that stores all color defs
  * \param mColor          the list of colors used currently
  * \param mBGColor        the background color used currently
+ * \param mHSVLookup      the color lookup table updated on light change
+ * \param ws              workspace holding LED images and the last light setting
  * \param mLight          the output light setting based on the LED detection
  * \param inputvideostarttime  the starting time of the input video
  * \param currentframe    the current video frame used
@@ -21,10 +34,10 @@
  * Function writes into the log file and sets mLight param with the
  * detected light setting.
  */
-bool ReadDayNightLED(cv::Mat &hsv, cv::Mat &inputimage, std::ofstream& ofslog,
+bool ReadDayNightLED(cv::Mat &smoothimage, cv::Mat &inputimage, cTextWriter& ofslog,
 		cCS* cs, std::list<cColorSet>* mColorDataBase,  cColor* mColor,
-		tColor* mBGColor, lighttype_t* mLight,
-		timed_t inputvideostarttime, int currentframe);
+		tColor* mBGColor, tHSVLookup* mHSVLookup, cWorkspace* ws,
+		lighttype_t* mLight, timed_t inputvideostarttime, int currentframe);
 
 
 #endif
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef ON_LINUX
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "blobfile.h"
+#include "chunks.h"
+#include "log.h"
+#include "mappedfile.h"
+#include "textwriter.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// divide frame range equally, the last chunk goes until the original end
+static bool SplitChunks(cCS* cs, int framecount, std::vector<cChunk>& chunks) {
+    int i, n = cs->chunks;
+    int first = cs->firstframe;
+    int last = (cs->lastframe >= 1) ? cs->lastframe : framecount - 1;
+    int size = (last - first + 1) / n;
+
+    if (size < CHUNKMINFRAMES)
+        return false;
+    chunks.resize(n);
+    for (i = 0; i < n; i++) {
+        chunks[i].firstframe = first + i * size;
+        chunks[i].lastframe = (i < n - 1) ? first + (i + 1) * size - 1 : cs->lastframe;
+        chunks[i].warmupframe = std::max(first, chunks[i].firstframe - cs->chunkwarmup);
+        snprintf(chunks[i].outputdatfile, MAXPATH, "%s" CHUNKTAG "%d", cs->outputdatfile, i);
+        snprintf(chunks[i].outputlogfile, MAXPATH, "%s" CHUNKTAG "%d", cs->outputlogfile, i);
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// check whether a line of a chunk should go to the merged output
+static bool IsChunkLineNeeded(const char* line, const char* lineend,
+        std::vector<cChunk>& chunks, int k) {
+    const char *token, *tokenend;
+    int framenum;
+
+    // header and comments are taken from the first chunk only
+    if (line == lineend || *line < '0' || *line > '9')
+        return k == 0;
+    cLineTokens lineTokens(line, lineend);
+    lineTokens.Next(&token, &tokenend);
+    framenum = ParseInt(token, tokenend);
+    // frames of warm-up (that belong to the previous chunk)
+    if (framenum < chunks[k].firstframe ||
+            (chunks[k].lastframe >= 1 && framenum > chunks[k].lastframe))
+        return false;
+    // the first and last frame is logged by the first and last chunk only
+    lineTokens.Next(&token, &tokenend);
+    if (TokenEquals(token, tokenend, "FIRSTFRAME"))
+        return k == 0;
+    if (TokenEquals(token, tokenend, "LASTFRAME"))
+        return k == (int)chunks.size() - 1;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// merge .blobs or .log text files of chunks
+static bool MergeTextFiles(const char* outfile, std::vector<cChunk>& chunks,
+        bool bLog) {
+    cTextWriter ofs;
+    cMappedFile ifs;
+    const char *line, *lineend;
+    size_t k;
+
+    if (!ofs.Open(outfile)) {
+        LOG_ERROR("Could not open output file '%s'.", outfile);
+        return false;
+    }
+    for (k = 0; k < chunks.size(); k++) {
+        const char* infile = bLog ? chunks[k].outputlogfile : chunks[k].outputdatfile;
+        if (!ifs.Open(infile)) {
+            LOG_ERROR("Could not open chunk output file '%s'.", infile);
+            return false;
+        }
+        while (ifs.NextLine(&line, &lineend)) {
+            if (IsChunkLineNeeded(line, lineend, chunks, (int)k)) {
+                ofs.Append(line, lineend) << "\n";
+            }
+        }
+        ifs.Close();
+    }
+
+    return ofs.Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// merge binary .blobs files of chunks
+static bool MergeBinaryBlobFiles(const char* outfile, std::vector<cChunk>& chunks) {
+    cBinaryBlobWriter writer;
+    cBinaryBlobReader reader;
+    cBlobFrame blobframe;
+    size_t k;
+    int i;
+
+    for (k = 0; k < chunks.size(); k++) {
+        if (!reader.Open(chunks[k].outputdatfile))
+            return false;
+        if (k == 0 && !writer.Open(outfile, reader.flags))
+            return false;
+        // without frame index read from the start, warmup frames are skipped below
+        if (!reader.Seek(chunks[k].firstframe))
+            std::cout << "  Warning: could not seek in " << chunks[k].outputdatfile <<
+                    ", reading it from the start." << std::endl;
+        while ((i = reader.Read(blobframe)) > 0 && (chunks[k].lastframe < 1 ||
+                blobframe.framenum <= chunks[k].lastframe)) {
+            if (blobframe.framenum < chunks[k].firstframe)
+                continue;
+            writer.Write(blobframe);
+        }
+        reader.Close();
+        if (i < 0)
+            return false;
+    }
+
+    return writer.Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int RunChunks(cCS* cs, int framecount) {
+#ifdef ON_LINUX
+    std::vector<cChunk> chunks;
+    std::vector<pid_t> pids;
+    bool bError = false;
+    int i, status;
+
+    if (cs->lastframe < 1 && framecount <= 0) {
+        std::cout << "  Warning: frame count of the video is unknown, cannot split it into " <<
+                cs->chunks << " chunks, using a single process." << std::endl;
+        return CHUNK_NONE;
+    }
+    if (!SplitChunks(cs, framecount, chunks)) {
+        std::cout << "  Warning: frame range is too short to split into " <<
+                cs->chunks << " chunks, using a single process." << std::endl;
+        return CHUNK_NONE;
+    }
+    // do not duplicate buffered output in the workers
+    std::cout.flush();
+    fflush(stdout);
+    for (i = 0; i < (int)chunks.size(); i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            LOG_ERROR("Could not create worker process for chunk %d.", i);
+            bError = true;
+            break;
+        }
+        // worker: process own chunk only
+        if (pid == 0) {
+            cs->firstframe = chunks[i].warmupframe;
+            cs->lastframe = chunks[i].lastframe;
+            strncpy(cs->outputdatfile, chunks[i].outputdatfile, MAXPATH);
+            strncpy(cs->outputlogfile, chunks[i].outputlogfile, MAXPATH);
+            cs->chunks = 0;
+            return i;
+        }
+        std::cout << "  Chunk " << i << ": frames " << chunks[i].firstframe <<
+                ".." << (chunks[i].lastframe >= 1 ? std::to_string(chunks[i].lastframe) : "end") <<
+                " (warm-up from " << chunks[i].warmupframe << "), pid: " << pid << std::endl;
+        pids.push_back(pid);
+    }
+    // parent: wait for all workers
+    for (i = 0; i < (int)pids.size(); i++) {
+        if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) ||
+                WEXITSTATUS(status) != 0) {
+            LOG_ERROR("Worker process of chunk %d failed.", i);
+            bError = true;
+        }
+    }
+    if (bError)
+        return CHUNK_ERROR;
+    // merge output of all chunks
+    std::cout << "Merging output of " << chunks.size() << " chunks..." << std::endl;
+    if (!(cs->blobfileformat == BLOBFILE_BINARY ?
+            MergeBinaryBlobFiles(cs->outputdatfile, chunks) :
+            MergeTextFiles(cs->outputdatfile, chunks, false)) ||
+            !MergeTextFiles(cs->outputlogfile, chunks, true)) {
+        return CHUNK_ERROR;
+    }
+    for (i = 0; i < (int)chunks.size(); i++) {
+        remove(chunks[i].outputdatfile);
+        remove(chunks[i].outputlogfile);
+    }
+    std::cout << "  OK - output written to " << cs->outputdatfile << " and " <<
+            cs->outputlogfile << std::endl;
+
+    return CHUNK_PARENT;
+#else
+    std::cout << "  Warning: chunk mode is only available on Linux, using a single process." << std::endl;
+    return CHUNK_NONE;
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef HEADER_CHUNKS
+#define HEADER_CHUNKS
+
+#include <vector>
+
+#include "ini.h"
+
+// file name tag of the output files of a chunk (followed by the chunk index)
+#define CHUNKTAG ".chunk"
+// chunks shorter than this are not worth a separate process
+#define CHUNKMINFRAMES 100
+
+// return values of RunChunks() that are not chunk indices
+#define CHUNK_NONE -1           // not in chunk mode
+#define CHUNK_PARENT -2         // all chunks have been processed and merged
+#define CHUNK_ERROR -3          // some chunks could not be processed
+
+// Frame range of one chunk, processed by a separate worker process.
+class cChunk {
+  public:
+    int warmupframe;            // first frame processed
+    int firstframe;             // first frame written to the output
+    int lastframe;              // last frame written to the output (0 - until the end of the video)
+    char outputdatfile[MAXPATH];        // .blobs output of the worker
+    char outputlogfile[MAXPATH];        // .log output of the worker
+    //! Constructor.
+    cChunk() : warmupframe(0), firstframe(0), lastframe(0) {
+        outputdatfile[0] = 0;
+        outputlogfile[0] = 0;
+    }
+};
+
+/**
+ * Split the frame range into chunks and process them in worker processes.
+ *
+ * The frame range (firstframe..lastframe or the whole video) is split into
+ * cs->chunks parts and a worker process is forked for each. Workers return
+ * immediately with their chunk settings applied to cs (frame range and
+ * output file names), and should do the usual processing afterwards.
+ * The parent waits for all workers and merges their output into the
+ * original .blobs and .log files.
+ *
+ * \param cs          control states structure
+ * \param framecount  the number of frames in the video, 0 if unknown
+ *
+ * \return the chunk index in the workers, CHUNK_PARENT in the parent after
+ *         all output is merged, CHUNK_NONE if the range is too short to
+ *         split, its end is unknown or forking is not available,
+ *         CHUNK_ERROR on error
+ */
+int RunChunks(cCS* cs, int framecount);
+
+#endif
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <list>
 
@@ -40,7 +42,41 @@ void InterpolateColors(tColor* result, tColor* first, tColor* second, double wpr
             wprev * first->mRangeHSV.val[2]);
 }
 
-bool SetHSVDetectionParams(lighttype_t light, color_interpolation_t method,
+// set all label bits of a color on the value range [lower, upper] of a channel
+static void SetLookupRange(unsigned char* table, int lower, int upper,
+        unsigned char bit) {
+    for (int j = std::max(lower, 0); j <= std::min(upper, 255); j++)
+        table[j] |= bit;
+}
+
+// add a color to the lookup table with the same bounds as cvFilterHSV()
+static void AddColorToLookup(tHSVLookup* mHSVLookup, tColor* color,
+        unsigned char bit) {
+    int lower[3], upper[3];
+
+    cvGetHSVBounds(color->mColorHSV, color->mRangeHSV, lower, upper);
+    // hue range might be wrapped around 180
+    if (upper[0] >= lower[0]) {
+        SetLookupRange(mHSVLookup->mH, lower[0], upper[0], bit);
+    } else {
+        SetLookupRange(mHSVLookup->mH, lower[0], 255, bit);
+        SetLookupRange(mHSVLookup->mH, 0, upper[0], bit);
+    }
+    SetLookupRange(mHSVLookup->mS, lower[1], upper[1], bit);
+    SetLookupRange(mHSVLookup->mV, lower[2], upper[2], bit);
+}
+
+void BuildHSVLookup(tHSVLookup* mHSVLookup, cColor* mColor, tColor* mBGColor) {
+    memset(mHSVLookup, 0, sizeof(tHSVLookup));
+    for (int i = 0; i < MAXMBASE; i++) {
+        if (mColor[i].mUse)
+            AddColorToLookup(mHSVLookup, &mColor[i].mColor, 1 << i);
+    }
+    AddColorToLookup(mHSVLookup, mBGColor, 1 << BGLABELBIT);
+}
+
+// set color definitions, called by SetHSVDetectionParams()
+static bool SetHSVColors(lighttype_t light, color_interpolation_t method,
         int dslp, double inputvideostarttime, std::list<cColorSet>* mColorDataBase,
 		cColor* mColor, tColor* mBGColor) {
 	// TODO: set extra code for EXTRALIGHT, STRANGELIGHT.
@@ -272,3 +308,18 @@ bool SetHSVDetectionParams(lighttype_t light, color_interpolation_t method,
     // return without errror
     return true;
 }
+
+bool SetHSVDetectionParams(lighttype_t light, color_interpolation_t method,
+        int dslp, double inputvideostarttime, std::list<cColorSet>* mColorDataBase,
+		cColor* mColor, tColor* mBGColor, tHSVLookup* mHSVLookup) {
+    if (!SetHSVColors(light, method, dslp, inputvideostarttime,
+            mColorDataBase, mColor, mBGColor)) {
+        return false;
+    }
+    // update lookup table with the new colors
+    if (mHSVLookup) {
+        BuildHSVLookup(mHSVLookup, mColor, mBGColor);
+    }
+
+    return true;
+}
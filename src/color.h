@@ -81,6 +81,16 @@ class cColor {
     }
 };
 
+// Lookup table classifying HSV pixels with all colors at once.
+// All color definitions are boxes in HSV space, so the label of a pixel
+// is mH[h] & mS[s] & mV[v], where bit i stands for color i and bit
+// BGLABELBIT for the background color.
+typedef struct {
+    unsigned char mH[256];      // labels of all hue values
+    unsigned char mS[256];      // labels of all saturation values
+    unsigned char mV[256];      // labels of all value values
+} tHSVLookup;
+
 // callback function for sorting by date instead of daysincelastpaint
 bool compareCColorSetsByDate(const cColorSet & a, const cColorSet & b);
 
@@ -97,12 +107,24 @@ bool compareCColorSetsByDate(const cColorSet & a, const cColorSet & b);
  *                        by the two (DAY and NIGHT) light definitions
  * \param mColor   the destination list where the defined colors will be stored
  * \param mBGColor the destination where the background color will be stored
+ * \param mHSVLookup  if not NULL, the lookup table to be rebuilt with the
+ *                    new color definitions
  *
  *
  * \return true on success, false otherwise
  */
 bool SetHSVDetectionParams(lighttype_t light, color_interpolation_t method,
         int dslp, double inputvideostarttime,
-        std::list<cColorSet>* mColorDataBase, cColor* mColor, tColor* mBGColor);
+        std::list<cColorSet>* mColorDataBase, cColor* mColor, tColor* mBGColor,
+        tHSVLookup* mHSVLookup = NULL);
+
+/**
+ * Build the HSV lookup table of the current color definitions.
+ *
+ * \param mHSVLookup  the destination lookup table
+ * \param mColor      the list of colors (only used colors are included)
+ * \param mBGColor    the background color
+ */
+void BuildHSVLookup(tHSVLookup* mHSVLookup, cColor* mColor, tColor* mBGColor);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "compare.h"
+#include "log.h"
+
+// Source of blob frames, reading a text stream or a binary blob file.
+class cBlobFrameSource {
+  public:
+    std::istream* ifs;          // text input (if not binary)
+    cBinaryBlobReader reader;   // binary input
+    bool bBinary;
+    //! Constructor.
+    cBlobFrameSource() : ifs(NULL), bBinary(false) {
+    }
+    //! Destructor.
+    ~cBlobFrameSource() {
+    }
+    // read next frame, 1 - OK, 0 - end, <0 - error
+    int Read(cBlobFrame& frame) {
+        return bBinary ? reader.Read(frame) : ReadBlobFrameText(*ifs, frame);
+    }
+};
+
+// a difference found, printed while not too many
+#define REPORT_DIFFERENCE(name, framenum, text) \
+    do { \
+        if (nreports++ < COMPAREMAXREPORTS) \
+            std::cout << "  " << name << " frame " << framenum << ": " << text << std::endl; \
+    } while (0)
+
+////////////////////////////////////////////////////////////////////////////////
+// difference of two values of a column (orientation is periodic)
+static inline double ColumnDifference(double a, double b, bool bOrientation) {
+    double d = fabs(a - b);
+    if (bOrientation) {
+        d = fmod(d, 180);
+        d = std::min(d, 180 - d);
+    }
+    return d;
+}
+
+// match all blobs of a type regardless of their order, returns number of
+// golden blobs without a matching pair
+static int MatchBlobs(std::vector<double>* columns, std::vector<double>* golden,
+        int ncolumns, int orientationcolumn, const std::vector<int>* color,
+        const std::vector<int>* goldencolor, double tolerance,
+        double angletolerance) {
+    size_t i, j, n = golden[0].size();
+    std::vector<bool> bUsed(n, false);
+    int k, nmissing = 0;
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < n; j++) {
+            if (bUsed[j] || (color && (*color)[j] != (*goldencolor)[i]))
+                continue;
+            for (k = 0; k < ncolumns; k++) {
+                if (ColumnDifference(columns[k][j], golden[k][i],
+                        k == orientationcolumn) > (k == orientationcolumn ?
+                        angletolerance : tolerance))
+                    break;
+            }
+            if (k == ncolumns)
+                break;
+        }
+        if (j < n)
+            bUsed[j] = true;
+        else
+            nmissing++;
+    }
+
+    return nmissing;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// compare frames of two blob sources
+static int CompareBlobSources(cBlobFrameSource& source, cBlobFrameSource& golden,
+        double tolerance, double angletolerance) {
+    cBlobFrame frame, goldenframe;
+    int i, j, n, ndiff = 0, nreports = 0, nframes = 0;
+    bool bDiff;
+
+    while (1) {
+        i = source.Read(frame);
+        j = golden.Read(goldenframe);
+        if (i < 0 || j < 0)
+            return -1;
+        if (!i || !j) {
+            if (i != j) {
+                REPORT_DIFFERENCE("blobs", (i ? frame : goldenframe).framenum,
+                        "number of frames differ (" << (i ? "golden" : "output") << " ended)");
+                ndiff++;
+            }
+            break;
+        }
+        nframes++;
+        bDiff = false;
+        if (frame.framenum != goldenframe.framenum) {
+            REPORT_DIFFERENCE("blobs", goldenframe.framenum, "frame number " <<
+                    frame.framenum << " instead");
+            bDiff = true;
+        } else if (frame.flags != goldenframe.flags) {
+            REPORT_DIFFERENCE("blobs", goldenframe.framenum, "line types differ");
+            bDiff = true;
+        } else {
+            // MD
+            if (frame.md[0].size() != goldenframe.md[0].size()) {
+                REPORT_DIFFERENCE("blobs", goldenframe.framenum, "MD count " <<
+                        (int)frame.md[0].size() << " != " << (int)goldenframe.md[0].size());
+                bDiff = true;
+            } else if ((n = MatchBlobs(frame.md, goldenframe.md, BLOBFILE_MD_COLUMNS,
+                    4, NULL, NULL, tolerance, angletolerance)) > 0) {
+                REPORT_DIFFERENCE("blobs", goldenframe.framenum, n << " MD blobs differ");
+                bDiff = true;
+            }
+            // RAT
+            if (frame.rat[0].size() != goldenframe.rat[0].size()) {
+                REPORT_DIFFERENCE("blobs", goldenframe.framenum, "RAT count " <<
+                        (int)frame.rat[0].size() << " != " << (int)goldenframe.rat[0].size());
+                bDiff = true;
+            } else if ((n = MatchBlobs(frame.rat, goldenframe.rat, BLOBFILE_RAT_COLUMNS,
+                    4, NULL, NULL, tolerance, angletolerance)) > 0) {
+                REPORT_DIFFERENCE("blobs", goldenframe.framenum, n << " RAT blobs differ");
+                bDiff = true;
+            }
+            // BLOB / BLOBE
+            if (frame.color.size() != goldenframe.color.size()) {
+                REPORT_DIFFERENCE("blobs", goldenframe.framenum, "BLOB count " <<
+                        (int)frame.color.size() << " != " << (int)goldenframe.color.size());
+                bDiff = true;
+            } else if ((n = MatchBlobs(frame.blob, goldenframe.blob, frame.BlobColumns(),
+                    (frame.flags & BLOBFILE_BLOBE) ? 4 : -1, &frame.color,
+                    &goldenframe.color, tolerance, angletolerance)) > 0) {
+                REPORT_DIFFERENCE("blobs", goldenframe.framenum, n << " BLOBs differ");
+                bDiff = true;
+            }
+        }
+        if (bDiff)
+            ndiff++;
+    }
+    if (nreports > COMPAREMAXREPORTS)
+        std::cout << "  ... (" << nreports - COMPAREMAXREPORTS <<
+                " more differences)" << std::endl;
+    std::cout << "Blobs: " << nframes << " frames compared, " << ndiff <<
+            " differ." << std::endl;
+
+    return ndiff;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CompareBlobStreams(std::istream& ifs, std::istream& goldenifs,
+        double tolerance, double angletolerance) {
+    cBlobFrameSource source, golden;
+    source.ifs = &ifs;
+    golden.ifs = &goldenifs;
+
+    return CompareBlobSources(source, golden, tolerance, angletolerance);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// next log record (not comment or empty line), false at the end
+static bool NextLogRecord(std::istream& ifs, std::string& line) {
+    while (getline(ifs, line)) {
+        if (line.length() && line[0] != '#')
+            return true;
+    }
+    return false;
+}
+
+// compare two log records field by field
+static bool CompareLogRecords(const std::string& line, const std::string& golden,
+        double tolerance) {
+    std::istringstream a(line), b(golden);
+    std::string s, t;
+    char *end, *goldenend;
+    double x, y;
+
+    while (1) {
+        bool bA = (bool)(a >> s), bB = (bool)(b >> t);
+        if (bA != bB)
+            return false;
+        if (!bA)
+            return true;
+        if (s == t)
+            continue;
+        // numeric fields
+        x = strtod(s.c_str(), &end);
+        y = strtod(t.c_str(), &goldenend);
+        if (*end || *goldenend || end == s.c_str() || goldenend == t.c_str() ||
+                fabs(x - y) > tolerance)
+            return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CompareLogStreams(std::istream& ifs, std::istream& goldenifs,
+        double tolerance) {
+    std::string line, golden;
+    int ndiff = 0, nreports = 0, nlines = 0;
+
+    while (1) {
+        bool bLine = NextLogRecord(ifs, line);
+        bool bGolden = NextLogRecord(goldenifs, golden);
+        if (!bLine || !bGolden) {
+            if (bLine != bGolden) {
+                REPORT_DIFFERENCE("log", atoi((bLine ? line : golden).c_str()),
+                        "number of records differ (" << (bLine ? "golden" : "output") << " ended)");
+                ndiff++;
+            }
+            break;
+        }
+        nlines++;
+        if (!CompareLogRecords(line, golden, tolerance)) {
+            REPORT_DIFFERENCE("log", atoi(golden.c_str()), "'" << line <<
+                    "' != '" << golden << "'");
+            ndiff++;
+        }
+    }
+    if (nreports > COMPAREMAXREPORTS)
+        std::cout << "  ... (" << nreports - COMPAREMAXREPORTS <<
+                " more differences)" << std::endl;
+    std::cout << "Log: " << nlines << " records compared, " << ndiff <<
+            " differ." << std::endl;
+
+    return ndiff;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// open a text or binary blob file
+static bool OpenBlobFrameSource(const char* filename, cBlobFrameSource& source,
+        std::ifstream& ifs) {
+    char magic[8];
+
+    ifs.open(filename, std::ios::in | std::ios::binary);
+    if (!ifs.is_open()) {
+        LOG_ERROR("Could not open blob file '%s'.", filename);
+        return false;
+    }
+    source.bBinary = ifs.read(magic, 8) && !memcmp(magic, BINARYBLOBMAGIC, 8);
+    ifs.close();
+    if (source.bBinary)
+        return source.reader.Open(filename);
+    ifs.open(filename, std::ios::in);
+    source.ifs = &ifs;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CompareBlobFiles(const char* file, const char* goldenfile,
+        double tolerance, double angletolerance) {
+    cBlobFrameSource source, golden;
+    std::ifstream ifs, goldenifs;
+
+    if (!OpenBlobFrameSource(file, source, ifs) ||
+            !OpenBlobFrameSource(goldenfile, golden, goldenifs))
+        return false;
+
+    return CompareBlobSources(source, golden, tolerance, angletolerance) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CompareLogFiles(const char* file, const char* goldenfile,
+        double tolerance) {
+    std::ifstream ifs(file), goldenifs(goldenfile);
+
+    if (!ifs.is_open()) {
+        LOG_ERROR("Could not open log file '%s'.", file);
+        return false;
+    }
+    if (!goldenifs.is_open()) {
+        LOG_ERROR("Could not open log file '%s'.", goldenfile);
+        return false;
+    }
+
+    return CompareLogStreams(ifs, goldenifs, tolerance) == 0;
+}
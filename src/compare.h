@@ -0,0 +1,75 @@
+#ifndef HEADER_COMPARE
+#define HEADER_COMPARE
+
+#include <iostream>
+
+#include "blobfile.h"
+
+// default tolerance of centers and axes/radii when comparing blob files [pixel]
+#define COMPARETOLERANCE 0.5
+// default tolerance of orientations when comparing blob files [deg]
+#define COMPAREANGLETOLERANCE 2.0
+// maximum number of differences printed by the compare functions
+#define COMPAREMAXREPORTS 20
+
+/**
+ * Compare text blob output with a golden (reference) text blob output.
+ *
+ * Frames must be the same with the same number of blobs of each type.
+ * Blobs of a frame are matched regardless of their order, each blob must
+ * have a pair of the same color with all coordinates within tolerance.
+ * Orientations are compared modulo 180 degrees.
+ *
+ * \param ifs              the text blob output to check
+ * \param goldenifs        the golden text blob output
+ * \param tolerance        tolerance of centers and axes [pixel]
+ * \param angletolerance   tolerance of orientations [deg]
+ *
+ * \return the number of frames that differ, negative on read error
+ */
+int CompareBlobStreams(std::istream& ifs, std::istream& goldenifs,
+        double tolerance, double angletolerance);
+
+/**
+ * Compare log records with golden (reference) log records.
+ *
+ * Comment and empty lines are skipped, other lines are compared field by
+ * field in order: numeric fields within tolerance, others exactly.
+ *
+ * \param ifs        the log output to check
+ * \param goldenifs  the golden log output
+ * \param tolerance  absolute tolerance of numeric fields
+ *
+ * \return the number of lines that differ
+ */
+int CompareLogStreams(std::istream& ifs, std::istream& goldenifs,
+        double tolerance);
+
+/**
+ * Compare a blob file with a golden blob file (text or binary format,
+ * they need not be the same). See CompareBlobStreams() for details.
+ *
+ * \param file        the blob file to check
+ * \param goldenfile  the golden blob file
+ * \param tolerance        tolerance of centers and axes [pixel]
+ * \param angletolerance   tolerance of orientations [deg]
+ *
+ * \return true if files match, false otherwise
+ */
+bool CompareBlobFiles(const char* file, const char* goldenfile,
+        double tolerance, double angletolerance);
+
+/**
+ * Compare a log file with a golden log file.
+ * See CompareLogStreams() for details.
+ *
+ * \param file        the log file to check
+ * \param goldenfile  the golden log file
+ * \param tolerance   absolute tolerance of numeric fields
+ *
+ * \return true if files match, false otherwise
+ */
+bool CompareLogFiles(const char* file, const char* goldenfile,
+        double tolerance);
+
+#endif
@@ -4,6 +4,9 @@
 // Maximum number of color definitions we allow
 #define MAXMBASE 6
 
+// Bit of the background color in color label images
+#define BGLABELBIT 7
+
 // Maximum number of blobs in a barcode
 #define MAXMCHIPS 4
 
@@ -0,0 +1,220 @@
+#include <algorithm>
+
+#include "cvutils.h"
+#include "simd.h"
+
+// fixed point shift of OpenCV's 8-bit BGR to HSV conversion
+#define HSV_SHIFT 12
+
+// Division tables of OpenCV's 8-bit BGR to HSV conversion (RGB2HSV_b).
+// They must be calculated exactly the same way to get the same rounding.
+class cHSVDivTables {
+  public:
+    int sdiv[256];              // (255 << HSV_SHIFT) / v
+    int hdiv[256];              // (180 << HSV_SHIFT) / (6 * diff)
+    //! Constructor.
+    cHSVDivTables() {
+        sdiv[0] = hdiv[0] = 0;
+        for (int i = 1; i < 256; i++) {
+            sdiv[i] = cvRound((255 << HSV_SHIFT) / (1. * i));
+            hdiv[i] = cvRound((180 << HSV_SHIFT) / (6. * i));
+        }
+    }
+};
+
+static const cHSVDivTables& GetHSVDivTables() {
+    static const cHSVDivTables tables;
+    return tables;
+}
+
+// scalar version, classifies pixels from x to n-1 of a row
+static void ClassifyBGRRow(const unsigned char* src, unsigned char* dst,
+        int x, int n, const cHSVDivTables& t, const unsigned char* lutH,
+        const unsigned char* lutS, const unsigned char* lutV) {
+    int b, g, r, h, s, v, vmin, diff, vr, vg;
+
+    for (src += 3 * x; x < n; x++, src += 3) {
+        b = src[0];
+        g = src[1];
+        r = src[2];
+        v = std::max(std::max(b, g), r);
+        vmin = std::min(std::min(b, g), r);
+        diff = v - vmin;
+        vr = v == r ? -1 : 0;
+        vg = v == g ? -1 : 0;
+        s = (diff * t.sdiv[v] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+        h = (vr & (g - b)) +
+                (~vr & ((vg & (b - r + 2 * diff)) + (~vg & (r - g + 4 * diff))));
+        h = (h * t.hdiv[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+        h += h < 0 ? 180 : 0;
+        dst[x] = lutH[h] & lutS[s] & lutV[v];
+    }
+}
+
+#ifdef SIMD_X86
+
+// split 8 BGR pixels (24 bytes) into 8 blue, green and red bytes
+TARGET_SSE41 static inline void Load8BGR(const unsigned char* src,
+        __m128i& b, __m128i& g, __m128i& r) {
+    const __m128i lo = _mm_loadu_si128((const __m128i*) src);
+    const __m128i hi = _mm_loadl_epi64((const __m128i*) (src + 16));
+    b = _mm_or_si128(
+            _mm_shuffle_epi8(lo, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5,
+                    -1, -1, -1, -1, -1, -1, -1, -1)));
+    g = _mm_or_si128(
+            _mm_shuffle_epi8(lo, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6,
+                    -1, -1, -1, -1, -1, -1, -1, -1)));
+    r = _mm_or_si128(
+            _mm_shuffle_epi8(lo, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7,
+                    -1, -1, -1, -1, -1, -1, -1, -1)));
+}
+
+// hue and saturation of 4 pixels (as in ClassifyBGRRow())
+TARGET_SSE41 static inline void HueSat4(const __m128i b, const __m128i g,
+        const __m128i r, const int* vv, const int* dd, const int* sdiv,
+        const int* hdiv, int* hh, int* ss) {
+    const __m128i round = _mm_set1_epi32(1 << (HSV_SHIFT - 1));
+    const __m128i v = _mm_load_si128((const __m128i*) vv);
+    const __m128i diff = _mm_load_si128((const __m128i*) dd);
+    const __m128i vr = _mm_cmpeq_epi32(v, r);
+    const __m128i vg = _mm_cmpeq_epi32(v, g);
+    __m128i s, h;
+
+    s = _mm_mullo_epi32(diff, _mm_load_si128((const __m128i*) sdiv));
+    s = _mm_srai_epi32(_mm_add_epi32(s, round), HSV_SHIFT);
+    h = _mm_add_epi32(_mm_and_si128(vr, _mm_sub_epi32(g, b)),
+            _mm_andnot_si128(vr, _mm_add_epi32(
+            _mm_and_si128(vg, _mm_add_epi32(_mm_sub_epi32(b, r),
+                    _mm_slli_epi32(diff, 1))),
+            _mm_andnot_si128(vg, _mm_add_epi32(_mm_sub_epi32(r, g),
+                    _mm_slli_epi32(diff, 2))))));
+    h = _mm_mullo_epi32(h, _mm_load_si128((const __m128i*) hdiv));
+    h = _mm_srai_epi32(_mm_add_epi32(h, round), HSV_SHIFT);
+    h = _mm_add_epi32(h, _mm_and_si128(_mm_cmpgt_epi32(_mm_setzero_si128(), h),
+            _mm_set1_epi32(180)));
+    _mm_store_si128((__m128i*) hh, h);
+    _mm_store_si128((__m128i*) ss, s);
+}
+
+// SSE4.1 version, returns the number of pixels classified
+TARGET_SSE41 static int ClassifyBGRRowSSE41(const unsigned char* src,
+        unsigned char* dst, int n, const cHSVDivTables& t,
+        const unsigned char* lutH, const unsigned char* lutS,
+        const unsigned char* lutV) {
+    alignas(16) int vv[8], dd[8], hh[8], ss[8], sdiv[8], hdiv[8];
+    __m128i b8, g8, r8, v8, d8;
+    int x, k;
+
+    for (x = 0; x + 8 <= n; x += 8, src += 24) {
+        Load8BGR(src, b8, g8, r8);
+        v8 = _mm_max_epu8(_mm_max_epu8(b8, g8), r8);
+        d8 = _mm_sub_epi8(v8, _mm_min_epu8(_mm_min_epu8(b8, g8), r8));
+        _mm_store_si128((__m128i*) vv, _mm_cvtepu8_epi32(v8));
+        _mm_store_si128((__m128i*) (vv + 4), _mm_cvtepu8_epi32(_mm_srli_si128(v8, 4)));
+        _mm_store_si128((__m128i*) dd, _mm_cvtepu8_epi32(d8));
+        _mm_store_si128((__m128i*) (dd + 4), _mm_cvtepu8_epi32(_mm_srli_si128(d8, 4)));
+        // no gather instruction in SSE
+        for (k = 0; k < 8; k++) {
+            sdiv[k] = t.sdiv[vv[k]];
+            hdiv[k] = t.hdiv[dd[k]];
+        }
+        HueSat4(_mm_cvtepu8_epi32(b8), _mm_cvtepu8_epi32(g8),
+                _mm_cvtepu8_epi32(r8), vv, dd, sdiv, hdiv, hh, ss);
+        HueSat4(_mm_cvtepu8_epi32(_mm_srli_si128(b8, 4)),
+                _mm_cvtepu8_epi32(_mm_srli_si128(g8, 4)),
+                _mm_cvtepu8_epi32(_mm_srli_si128(r8, 4)),
+                vv + 4, dd + 4, sdiv + 4, hdiv + 4, hh + 4, ss + 4);
+        for (k = 0; k < 8; k++)
+            dst[x + k] = lutH[hh[k]] & lutS[ss[k]] & lutV[vv[k]];
+    }
+    return x;
+}
+
+// AVX2 version, returns the number of pixels classified
+TARGET_AVX2 static int ClassifyBGRRowAVX2(const unsigned char* src,
+        unsigned char* dst, int n, const cHSVDivTables& t,
+        const int* lutH, const int* lutS, const int* lutV) {
+    const __m256i round = _mm256_set1_epi32(1 << (HSV_SHIFT - 1));
+    const __m256i hrange = _mm256_set1_epi32(180);
+    const __m256i zero = _mm256_setzero_si256();
+    __m128i b8, g8, r8, lo, hi;
+    __m256i b, g, r, v, diff, vr, vg, s, h, label;
+    int x;
+
+    for (x = 0; x + 8 <= n; x += 8, src += 24) {
+        Load8BGR(src, b8, g8, r8);
+        b = _mm256_cvtepu8_epi32(b8);
+        g = _mm256_cvtepu8_epi32(g8);
+        r = _mm256_cvtepu8_epi32(r8);
+        v = _mm256_max_epi32(_mm256_max_epi32(b, g), r);
+        diff = _mm256_sub_epi32(v, _mm256_min_epi32(_mm256_min_epi32(b, g), r));
+        vr = _mm256_cmpeq_epi32(v, r);
+        vg = _mm256_cmpeq_epi32(v, g);
+        s = _mm256_mullo_epi32(diff, _mm256_i32gather_epi32(t.sdiv, v, 4));
+        s = _mm256_srai_epi32(_mm256_add_epi32(s, round), HSV_SHIFT);
+        h = _mm256_add_epi32(_mm256_and_si256(vr, _mm256_sub_epi32(g, b)),
+                _mm256_andnot_si256(vr, _mm256_add_epi32(
+                _mm256_and_si256(vg, _mm256_add_epi32(_mm256_sub_epi32(b, r),
+                        _mm256_slli_epi32(diff, 1))),
+                _mm256_andnot_si256(vg, _mm256_add_epi32(_mm256_sub_epi32(r, g),
+                        _mm256_slli_epi32(diff, 2))))));
+        h = _mm256_mullo_epi32(h, _mm256_i32gather_epi32(t.hdiv, diff, 4));
+        h = _mm256_srai_epi32(_mm256_add_epi32(h, round), HSV_SHIFT);
+        h = _mm256_add_epi32(h, _mm256_and_si256(_mm256_cmpgt_epi32(zero, h), hrange));
+        label = _mm256_and_si256(_mm256_and_si256(
+                _mm256_i32gather_epi32(lutH, h, 4),
+                _mm256_i32gather_epi32(lutS, s, 4)),
+                _mm256_i32gather_epi32(lutV, v, 4));
+        // pack 8 labels into 8 bytes
+        lo = _mm256_castsi256_si128(label);
+        hi = _mm256_extracti128_si256(label, 1);
+        lo = _mm_packus_epi32(lo, hi);
+        _mm_storel_epi64((__m128i*) (dst + x), _mm_packus_epi16(lo, lo));
+    }
+    return x;
+}
+
+#endif // SIMD_X86
+
+void cvClassifyBGR(cv::Mat &dstLabel, cv::Mat &srcBGR, const unsigned char* lutH,
+        const unsigned char* lutS, const unsigned char* lutV) {
+    const cHSVDivTables& t = GetHSVDivTables();
+    int x, y;
+#ifdef SIMD_X86
+    static const bool bAVX2 = cv::checkHardwareSupport(CV_CPU_AVX2);
+    static const bool bSSE41 = cv::checkHardwareSupport(CV_CPU_SSE4_1);
+    // AVX2 gathers need 32-bit tables
+    int lut32H[256], lut32S[256], lut32V[256];
+    if (bAVX2) {
+        for (x = 0; x < 256; x++) {
+            lut32H[x] = lutH[x];
+            lut32S[x] = lutS[x];
+            lut32V[x] = lutV[x];
+        }
+    }
+#endif
+
+    dstLabel.create(srcBGR.size(), CV_8UC1);
+    for (y = 0; y < srcBGR.rows; y++) {
+        const unsigned char* src = srcBGR.ptr<unsigned char>(y);
+        unsigned char* dst = dstLabel.ptr<unsigned char>(y);
+        x = 0;
+#ifdef SIMD_X86
+        if (bAVX2) {
+            x = ClassifyBGRRowAVX2(src, dst, srcBGR.cols, t,
+                    lut32H, lut32S, lut32V);
+        } else if (bSSE41) {
+            x = ClassifyBGRRowSSE41(src, dst, srcBGR.cols, t,
+                    lutH, lutS, lutV);
+        }
+#endif
+        // remaining pixels (or all on other architectures)
+        ClassifyBGRRow(src, dst, x, srcBGR.cols, t, lutH, lutS, lutV);
+    }
+}
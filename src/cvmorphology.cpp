@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "cvutils.h"
+
+// Binary morphology on bit-packed masks (cBitMask). A (2r+1) x (2r+1)
+// square dilation is separable: rows are dilated by shifting words
+// (log(r) steps for 64 pixels at once), columns by the van Herk/Gil-Werman
+// algorithm (3 ORs per word for any r).
+
+typedef uint64_t tWord;
+
+// t[i] |= t[i + s] for all bits i of a row of n words (zeros beyond the end)
+static inline void OrShiftedDown(tWord* t, int n, int s) {
+    int q = s >> 6, b = s & 63, w;
+
+    for (w = 0; w + q < n; w++) {
+        tWord x = t[w + q] >> b;
+        if (b && w + q + 1 < n)
+            x |= t[w + q + 1] << (64 - b);
+        t[w] |= x;
+    }
+}
+
+// t[i] |= t[i - s] for all bits i of a row of n words (zeros before the start)
+static inline void OrShiftedUp(tWord* t, int n, int s) {
+    int q = s >> 6, b = s & 63, w;
+
+    for (w = n - 1; w - q >= 0; w--) {
+        tWord x = t[w - q] << b;
+        if (b && w - q - 1 >= 0)
+            x |= t[w - q - 1] >> (64 - b);
+        t[w] |= x;
+    }
+}
+
+// t[i] = OR of t[i - r .. i] and then of t[i .. i + r], i.e. OR of the
+// 2r+1 pixels centered on i, in log(r) steps
+static void DilateRow(tWord* t, int n, int r) {
+    int len;
+
+    for (len = 1; 2 * len <= r + 1; len *= 2)
+        OrShiftedUp(t, n, len);
+    if (len < r + 1)
+        OrShiftedUp(t, n, r + 1 - len);
+    for (len = 1; 2 * len <= r + 1; len *= 2)
+        OrShiftedDown(t, n, len);
+    if (len < r + 1)
+        OrShiftedDown(t, n, r + 1 - len);
+}
+
+// dilate a mask with a (2r+1)^2 square in place
+static void DilateMask(cBitMask &mask, int r, cMorphBuffers &buffers) {
+    // van Herk prefix and suffix ORs of blocks of L rows
+    std::vector<tWord>& prefix = buffers.prefix;
+    std::vector<tWord>& suffix = buffers.suffix;
+    std::vector<tWord>& zeros = buffers.zeros;
+    const int n = mask.stride;
+    const tWord last = mask.LastWordMask();
+    const int L = 2 * r + 1;            // window size
+    const int P = mask.height + 2 * r;  // rows with r zero rows above and below
+    int y, w;
+
+    prefix.resize((size_t)P * n);
+    suffix.resize((size_t)P * n);
+    zeros.assign(n, 0);
+
+    // rows first
+    for (y = 0; y < mask.height; y++) {
+        DilateRow(mask.Row(y), n, r);
+        mask.Row(y)[n - 1] &= last;
+    }
+
+    // then columns, row p of the padded mask is row p - r of the mask
+    for (y = 0; y < P; y++) {
+        const tWord* s = (y < r || y >= mask.height + r) ? &zeros[0] : mask.Row(y - r);
+        tWord* g = &prefix[(size_t)y * n];
+        if (y % L) {
+            const tWord* g0 = g - n;
+            for (w = 0; w < n; w++)
+                g[w] = g0[w] | s[w];
+        } else {
+            std::copy(s, s + n, g);
+        }
+    }
+    for (y = P - 1; y >= 0; y--) {
+        const tWord* s = (y < r || y >= mask.height + r) ? &zeros[0] : mask.Row(y - r);
+        tWord* h = &suffix[(size_t)y * n];
+        if ((y + 1) % L && y + 1 < P) {
+            const tWord* h0 = h + n;
+            for (w = 0; w < n; w++)
+                h[w] = h0[w] | s[w];
+        } else {
+            std::copy(s, s + n, h);
+        }
+    }
+
+    // OR of padded rows y..y+L-1
+    for (y = 0; y < mask.height; y++) {
+        const tWord* h = &suffix[(size_t)y * n];
+        const tWord* g = &prefix[(size_t)(y + L - 1) * n];
+        tWord* dst = mask.Row(y);
+        for (w = 0; w < n; w++)
+            dst[w] = h[w] | g[w];
+    }
+}
+
+void cvDilateBinary(cBitMask &mask, int iterations, cMorphBuffers &buffers) {
+    if (iterations > 0 && mask.stride)
+        DilateMask(mask, iterations, buffers);
+}
+
+void cvErodeBinary(cBitMask &mask, int iterations, cMorphBuffers &buffers) {
+    // erosion is the dilation of the background, pixels outside the
+    // image are foreground for cv::erode(), i.e. background of the inverse
+    if (iterations > 0 && mask.stride) {
+        mask.Not();
+        DilateMask(mask, iterations, buffers);
+        mask.Not();
+    }
+}
@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "cvutils.h"
+#include "simd.h"
 
 cv::Mat cvCreateImageOnce(cv::Mat &dst, cv::Size size, int depth,
         int channels, bool bZero) {
@@ -17,53 +20,123 @@ cv::Mat cvCreateImageOnce(cv::Mat &dst, cv::Size size, int depth,
     return dst;
 }
 
-void cvFilterHSV(cv::Mat &dstBin, cv::Mat &srcHSV, cv::Scalar colorHSV,
-        cv::Scalar rangeHSV) {
-    int Hmin, Hmax, Smin, Smax, Vmin, Vmax, x;
+void cvGetHSVBounds(cv::Scalar colorHSV, cv::Scalar rangeHSV, int* lower,
+        int* upper) {
+    int x;
 
     // Hue: 0-180, circular continuous
-    Hmin = Hmax = (int) colorHSV.val[0];
+    lower[0] = upper[0] = (int) colorHSV.val[0];
     x = (int) rangeHSV.val[0];
     if (x > 89)
         x = 89;
-    Hmax = (Hmax + x) % 180;
-    Hmin = (Hmin + 180 - x) % 180;
+    upper[0] = (upper[0] + x) % 180;
+    lower[0] = (lower[0] + 180 - x) % 180;
 
     // Saturation: 0-255
-    Smin = Smax = (int) colorHSV.val[1];
+    lower[1] = upper[1] = (int) colorHSV.val[1];
     x = (int) rangeHSV.val[1];
-    Smax += x;
-    if (Smax > 255)
-        Smax = 255;
-    Smin -= x;
-    if (Smin < 0)
-        Smin = 0;
+    upper[1] += x;
+    if (upper[1] > 255)
+        upper[1] = 255;
+    lower[1] -= x;
+    if (lower[1] < 0)
+        lower[1] = 0;
 
     // Value: 0-255
-    Vmin = Vmax = (int) colorHSV.val[2];
+    lower[2] = upper[2] = (int) colorHSV.val[2];
     x = (int) rangeHSV.val[2];
-    Vmax += x;
-    if (Vmax > 255)
-        Vmax = 255;
-    Vmin -= x;
-    if (Vmin < 0)
-        Vmin = 0;
+    upper[2] += x;
+    if (upper[2] > 255)
+        upper[2] = 255;
+    lower[2] -= x;
+    if (lower[2] < 0)
+        lower[2] = 0;
+}
+
+void cvFilterHSV(cv::Mat &dstBin, cv::Mat &srcHSV, cv::Scalar colorHSV,
+        cv::Scalar rangeHSV, cv::Mat &tmpBin) {
+    int lower[3], upper[3];
+
+    cvGetHSVBounds(colorHSV, rangeHSV, lower, upper);
 
     // threshold H plane
-    if (Hmax >= Hmin) {
-        cv::inRange(srcHSV, cv::Scalar(Hmin, Smin, Vmin),
-                cv::Scalar(Hmax, Smax, Vmax), dstBin);
+    if (upper[0] >= lower[0]) {
+        cv::inRange(srcHSV, cv::Scalar(lower[0], lower[1], lower[2]),
+                cv::Scalar(upper[0], upper[1], upper[2]), dstBin);
     } else {
-        static cv::Mat tmp;
-        tmp = cvCreateImageOnce(tmp, dstBin.size(), 8, 1, false);
-        cv::inRange(srcHSV, cv::Scalar(Hmin, Smin, Vmin),
-                cv::Scalar(255, Smax, Vmax), dstBin);
-        cv::inRange(srcHSV, cv::Scalar(0, Smin, Vmin),
-                cv::Scalar(Hmax, Smax, Vmax), tmp);
-        cv::bitwise_or(tmp, dstBin, dstBin);
+        cv::inRange(srcHSV, cv::Scalar(lower[0], lower[1], lower[2]),
+                cv::Scalar(255, upper[1], upper[2]), dstBin);
+        cv::inRange(srcHSV, cv::Scalar(0, lower[1], lower[2]),
+                cv::Scalar(upper[0], upper[1], upper[2]), tmpBin);
+        cv::bitwise_or(tmpBin, dstBin, dstBin);
     }
 }
 
+void cvLabelToBinary(cv::Mat &dstBin, cv::Mat &srcLabel, unsigned char bits) {
+    int x, y;
+    const unsigned char* src;
+    unsigned char* dst;
+
+    dstBin.create(srcLabel.size(), CV_8UC1);
+    for (y = 0; y < srcLabel.rows; y++) {
+        src = srcLabel.ptr<unsigned char>(y);
+        dst = dstBin.ptr<unsigned char>(y);
+        for (x = 0; x < srcLabel.cols; x++)
+            dst[x] = (src[x] & bits) ? 255 : 0;
+    }
+}
+
+void cvMaskLabel(cv::Mat &label, cv::Mat &mask, unsigned char outside) {
+    int x, y;
+    const unsigned char* src;
+    unsigned char* dst;
+
+    for (y = 0; y < label.rows; y++) {
+        src = mask.ptr<unsigned char>(y);
+        dst = label.ptr<unsigned char>(y);
+        for (x = 0; x < label.cols; x++)
+            if (!src[x])
+                dst[x] = outside;
+    }
+}
+
+void cvMaskLabel(cv::Mat &label, cBitMask &mask, unsigned char outside) {
+    int x, y;
+    uint64_t word = 0;
+    unsigned char* dst;
+
+    for (y = 0; y < label.rows; y++) {
+        const uint64_t* src = mask.Row(y);
+        dst = label.ptr<unsigned char>(y);
+        for (x = 0; x < label.cols; x++) {
+            // whole words inside the mask are skipped
+            if (!(x & 63)) {
+                word = src[x >> 6];
+                if (x + 64 <= label.cols && word == ~(uint64_t)0) {
+                    x += 63;
+                    continue;
+                }
+            }
+            if (!((word >> (x & 63)) & 1))
+                dst[x] = outside;
+        }
+    }
+}
+
+void cvDownscale(cv::Mat &dst, cv::Mat &src, int downscale) {
+    cv::Rect rect(0, 0, src.cols - src.cols % downscale,
+            src.rows - src.rows % downscale);
+
+    cv::resize(src(rect), dst, cv::Size(rect.width / downscale,
+            rect.height / downscale), 0, 0, cv::INTER_AREA);
+}
+
+int ScaleIterations(int iterations, int downscale) {
+    if (!iterations)
+        return 0;
+    return std::max(1, (iterations + downscale / 2) / downscale);
+}
+
 void cvSkeleton(cv::Mat &src, cv::Mat &dst) {
     cv::Mat element = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
     cv::Mat temp(src.size(), CV_8UC1);
@@ -83,45 +156,160 @@ void cvSkeleton(cv::Mat &src, cv::Mat &dst) {
     skel.copyTo(dst);
 }
 
-void FilterMotion(cv::Mat &srcColor, cv::Mat &movingAverage,
-        cv::Mat &dstGrey, double mdAlpha, int mdThreshold) {
-    std::vector<cv::Mat> channels;
-    cv::Mat difference(srcColor.size(), CV_8UC3);
+void InitMotionAverage(cv::Mat &srcColor, cv::Mat &movingAverage) {
+    srcColor.convertTo(movingAverage, CV_16UC3, 1 << MOTIONAVERAGEBITS);
+}
 
-    //Convert high-res moving average and store in difference.
-    movingAverage.convertTo(difference, CV_8UC3);
+#ifdef SIMD_X86
 
-    //Substract the current frame from the moving average.
-    cv::absdiff(srcColor, difference, difference);
+// avg + ((d * alpha + (1 << 15)) >> 16) with d = (src << MOTIONAVERAGEBITS) - avg
+// on 4 pixel channels in 32 bits: with alpha = 256 * ah + al and q = d * ah,
+// d * alpha = 65536 * (q >> 8) + 256 * (q & 255) + d * al
+TARGET_SSE41 static inline __m128i UpdateAverage4(const __m128i src,
+        const __m128i avg, const __m128i ah, const __m128i al) {
+    const __m128i d = _mm_sub_epi32(_mm_slli_epi32(src, MOTIONAVERAGEBITS), avg);
+    const __m128i q = _mm_mullo_epi32(d, ah);
+    __m128i r = _mm_add_epi32(_mm_mullo_epi32(d, al), _mm_set1_epi32(1 << 15));
+    r = _mm_add_epi32(r, _mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(255)), 8));
+    return _mm_add_epi32(avg, _mm_add_epi32(_mm_srai_epi32(q, 8),
+            _mm_srai_epi32(r, 16)));
+}
+
+// UpdateAverage4() on 8 pixel channels (src and avg as 16-bit values)
+TARGET_SSE41 static inline __m128i UpdateAverage8(const __m128i src,
+        const __m128i avg, const __m128i ah, const __m128i al) {
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_packus_epi32(
+            UpdateAverage4(_mm_unpacklo_epi16(src, zero),
+                    _mm_unpacklo_epi16(avg, zero), ah, al),
+            UpdateAverage4(_mm_unpackhi_epi16(src, zero),
+                    _mm_unpackhi_epi16(avg, zero), ah, al));
+}
 
-    // update running average with current frame
-    cv::accumulateWeighted(srcColor, movingAverage, mdAlpha);
+// saturated sum of the 3 channels of 16 pixels (48 interleaved bytes)
+TARGET_SSE41 static inline __m128i SumChannels16(const __m128i* m) {
+    const __m128i c0 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(m[0], _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m[1], _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5,
+                    8, 11, 14, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(m[2], _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+                    -1, -1, -1, 1, 4, 7, 10, 13)));
+    const __m128i c1 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(m[0], _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m[1], _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6,
+                    9, 12, 15, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(m[2], _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+                    -1, -1, -1, 2, 5, 8, 11, 14)));
+    const __m128i c2 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(m[0], _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1)),
+            _mm_shuffle_epi8(m[1], _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7,
+                    10, 13, -1, -1, -1, -1, -1, -1))),
+            _mm_shuffle_epi8(m[2], _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+                    -1, -1, 0, 3, 6, 9, 12, 15)));
+    return _mm_adds_epu8(_mm_adds_epu8(c0, c1), c2);
+}
 
-    // split difference image into channels
-    cv::split(difference, channels);
+// SSE4.1 version of a row of FilterMotion(), one mask word (64 pixels) at a
+// time, returns the number of pixels processed (threshold must be 0..254)
+TARGET_SSE41 static int FilterMotionRowSSE41(const unsigned char* src,
+        unsigned short* avg, uint64_t* dst, int n, int alpha, int threshold) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(1 << (MOTIONAVERAGEBITS - 1));
+    const __m128i ah = _mm_set1_epi32(alpha >> 8);
+    const __m128i al = _mm_set1_epi32(alpha & 255);
+    const __m128i limit = _mm_set1_epi8((char) (threshold + 1));
+    __m128i s, lo, hi, a, sum, m[3];
+    uint64_t word;
+    int x, k, i;
 
-	// add individual channel differences
-	cv::add(channels[0], channels[1], dstGrey); // b + g
-	cv::add(channels[2], dstGrey, dstGrey); // + r
-	// or choose max deviation
-	// (this should be used for PROJECT_MAZE)
-	// cv::Max(channels[0], channels[1], dstGrey); // b + g
-    // cv::Max(channels[2], dstGrey, dstGrey); // + r
+    for (x = 0; x + 64 <= n; x += 64) {
+        word = 0;
+        for (k = 0; k < 64; k += 16, src += 48, avg += 48) {
+            for (i = 0; i < 3; i++) {
+                s = _mm_loadu_si128((const __m128i*) (src + 16 * i));
+                lo = _mm_loadu_si128((const __m128i*) (avg + 16 * i));
+                hi = _mm_loadu_si128((const __m128i*) (avg + 16 * i + 8));
+                // difference from the moving average rounded to 8 bits
+                a = _mm_packus_epi16(
+                        _mm_srli_epi16(_mm_add_epi16(lo, half), MOTIONAVERAGEBITS),
+                        _mm_srli_epi16(_mm_add_epi16(hi, half), MOTIONAVERAGEBITS));
+                m[i] = _mm_or_si128(_mm_subs_epu8(s, a), _mm_subs_epu8(a, s));
+                // update running average with current frame
+                _mm_storeu_si128((__m128i*) (avg + 16 * i), UpdateAverage8(
+                        _mm_unpacklo_epi8(s, zero), lo, ah, al));
+                _mm_storeu_si128((__m128i*) (avg + 16 * i + 8), UpdateAverage8(
+                        _mm_unpackhi_epi8(s, zero), hi, ah, al));
+            }
+            // sum > threshold, as sum >= threshold + 1
+            sum = SumChannels16(m);
+            word |= (uint64_t) (unsigned) _mm_movemask_epi8(
+                    _mm_cmpeq_epi8(_mm_max_epu8(sum, limit), sum)) << k;
+        }
+        dst[x >> 6] = word;
+    }
+    return x;
+}
 
-    // debug output: average difference on new image
-    //cv::Scalar avgdiff = cv::Avg(dstGrey);
-    //ofslog << currentframe << "\tAVGDIFF\t" << avgdiff.val[0] << endl;
+#endif // SIMD_X86
 
-    //Convert the image to grayscale.
-    //cv::cvtColor(difference,dstGrey,CV_RGB2GRAY);
+void FilterMotion(cv::Mat &srcColor, cv::Mat &movingAverage,
+        cBitMask &dstMask, double mdAlpha, int mdThreshold,
+        cMorphBuffers &buffers, int downscale) {
+    // alpha with 16 fractional bits
+    const long long alpha = cvRound(std::min(std::max(mdAlpha, 0.0), 1.0) * (1 << 16));
+    const int half = 1 << (MOTIONAVERAGEBITS - 1);
+    int x, y, c, d, sum;
+    uint64_t word;
+#ifdef SIMD_X86
+    static const bool bSSE41 = cv::checkHardwareSupport(CV_CPU_SSE4_1);
+    const bool bVector = bSSE41 && mdThreshold >= 0 && mdThreshold < 255;
+#endif
 
-    //Convert the image to black and white.
-    cv::threshold(dstGrey, dstGrey, mdThreshold, 255, cv::THRESH_BINARY);
+    dstMask.Create(srcColor.size());
+    for (y = 0; y < srcColor.rows; y++) {
+        const unsigned char* src = srcColor.ptr<unsigned char>(y);
+        unsigned short* avg = movingAverage.ptr<unsigned short>(y);
+        uint64_t* dst = dstMask.Row(y);
+        x = 0;
+#ifdef SIMD_X86
+        if (bVector) {
+            x = FilterMotionRowSSE41(src, avg, dst, srcColor.cols, (int) alpha,
+                    mdThreshold);
+            src += 3 * x;
+            avg += 3 * x;
+        }
+#endif
+        // remaining pixels (or all on other architectures)
+        word = 0;
+        for (; x < srcColor.cols; x++, src += 3, avg += 3) {
+            sum = 0;
+            for (c = 0; c < 3; c++) {
+                // difference from the moving average rounded to 8 bits
+                d = src[c] - ((avg[c] + half) >> MOTIONAVERAGEBITS);
+                sum += d < 0 ? -d : d;
+                // update running average with current frame
+                d = (src[c] << MOTIONAVERAGEBITS) - avg[c];
+                avg[c] = (unsigned short)(avg[c] + ((d * alpha + (1 << 15)) >> 16));
+            }
+            // add individual channel differences (saturated) and threshold
+            // (for PROJECT_MAZE the max deviation should be used instead)
+            word |= (uint64_t)(std::min(sum, 255) > mdThreshold) << (x & 63);
+            if ((x & 63) == 63) {
+                dst[x >> 6] = word;
+                word = 0;
+            }
+        }
+        if (x & 63)
+            dst[x >> 6] = word;
+    }
 
     //Dilate and erode to get moving blobs
     //TODO: these parameters can be optimized, too/
-    cv::dilate(dstGrey, dstGrey, cv::Mat(), cv::Point(-1,-1), 6);
-    cv::erode(dstGrey, dstGrey, cv::Mat(), cv::Point(-1,-1), 4);
+    cvDilateBinary(dstMask, ScaleIterations(6, downscale), buffers);
+    cvErodeBinary(dstMask, ScaleIterations(4, downscale), buffers);
 }
 
 void FitLine(cv::Point *points, int count, float *line) {
@@ -2,6 +2,21 @@
 #define HEADER_CVUTILS
 
 #include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "bitmask.h"
+
+// number of fractional bits of the fixed-point moving average of FilterMotion()
+#define MOTIONAVERAGEBITS 8
+
+// row buffers of cvDilateBinary() and cvErodeBinary(), reused between calls
+class cMorphBuffers {
+  public:
+    std::vector<uint64_t> prefix;   // van Herk prefix ORs of the padded rows
+    std::vector<uint64_t> suffix;   // van Herk suffix ORs of the padded rows
+    std::vector<uint64_t> zeros;    // an empty row
+};
 
 /**
  * Allocates memory for an opencv image if it has not been allocated yet.
@@ -17,6 +32,19 @@
 cv::Mat cvCreateImageOnce(cv::Mat &dst, cv::Size size, int depth,
         int channels, bool bZero=true);
 
+/**
+ * Get the inclusive lower and upper bounds of a HSV color filter.
+ *
+ * \param  colorHSV  the color definition of the filter
+ * \param  rangeHSV  the range definition of the filter
+ * \param  lower     the three lower H, S, V bounds returned
+ * \param  upper     the three upper H, S, V bounds returned
+ *
+ * Note that if lower[0] > upper[0], the hue range is wrapped around 180.
+ */
+void cvGetHSVBounds(cv::Scalar colorHSV, cv::Scalar rangeHSV, int* lower,
+        int* upper);
+
 /**
  * Filter image with a given HSV color and range.
  *
@@ -26,9 +54,101 @@ cv::Mat cvCreateImageOnce(cv::Mat &dst, cv::Size size, int depth,
  * \param  srcHSV    the input HSV image (8-bit)
  * \param  colorHSV  the color definition of the filter
  * \param  rangeHSV  the range definition of the filter
+ * \param  tmpBin    temporary binary image used if hue range is wrapped
  */
 void cvFilterHSV(cv::Mat &dstBin, cv::Mat &srcHSV, cv::Scalar colorHSV,
-        cv::Scalar rangeHSV);
+        cv::Scalar rangeHSV, cv::Mat &tmpBin);
+
+/**
+ * Classify all pixels of a BGR image with several HSV filters in one pass,
+ * without creating the HSV image.
+ *
+ * Pixels are converted to HSV exactly as with cv::cvtColor(COLOR_BGR2HSV)
+ * and their label is lutH[h] & lutS[s] & lutV[v]. If bit i of the tables
+ * is set on the ranges of filter i (see cvGetHSVBounds()), bit i of the
+ * label is the same as the output of cvFilterHSV() with filter i.
+ *
+ * AVX2 or SSE4.1 is used when available (see cv::checkHardwareSupport()).
+ *
+ * \param  dstLabel  the destination 8-bit label image
+ * \param  srcBGR    the input BGR image (8-bit)
+ * \param  lutH      label lookup table of the 256 possible hue values
+ * \param  lutS      label lookup table of the 256 possible saturation values
+ * \param  lutV      label lookup table of the 256 possible value values
+ */
+void cvClassifyBGR(cv::Mat &dstLabel, cv::Mat &srcBGR, const unsigned char* lutH,
+        const unsigned char* lutS, const unsigned char* lutV);
+
+/**
+ * Create a binary image from the given bits of a label image.
+ *
+ * \param  dstBin    the destination binary image (255 where any bit is set)
+ * \param  srcLabel  the input label image (8-bit)
+ * \param  bits      the label bits to check
+ */
+void cvLabelToBinary(cv::Mat &dstBin, cv::Mat &srcLabel, unsigned char bits);
+
+/**
+ * Overwrite the label of all pixels outside of a mask.
+ *
+ * \param  label    the label image to be masked (8-bit)
+ * \param  mask     the binary mask image
+ * \param  outside  the label to be set where the mask is zero
+ */
+void cvMaskLabel(cv::Mat &label, cv::Mat &mask, unsigned char outside);
+
+/**
+ * cvMaskLabel() with a bit-packed mask.
+ *
+ * \param  label    the label image to be masked (8-bit)
+ * \param  mask     the mask of the same size
+ * \param  outside  the label to be set where the mask is not set
+ */
+void cvMaskLabel(cv::Mat &label, cBitMask &mask, unsigned char outside);
+
+/**
+ * Downscale an image by an integer factor, averaging the pixels of each
+ * downscale x downscale block. The last rows/columns are skipped if the
+ * image size is not a multiple of the factor.
+ *
+ * \param  dst        the destination image (size / downscale)
+ * \param  src        the input image
+ * \param  downscale  the downscaling factor
+ */
+void cvDownscale(cv::Mat &dst, cv::Mat &src, int downscale);
+
+/**
+ * Get the number of erode/dilate iterations on a downscaled image that
+ * corresponds to the given number of iterations on the original image.
+ *
+ * \param  iterations  number of iterations on the original image
+ * \param  downscale   the downscaling factor
+ *
+ * \return the number of iterations, at least 1 if iterations is not 0
+ */
+int ScaleIterations(int iterations, int downscale);
+
+/**
+ * Dilate a bit-packed binary mask in place as cv::dilate() with the
+ * default 3x3 kernel and the given number of iterations, but in constant
+ * time per pixel for any number of iterations (rows are dilated by word
+ * shifts, columns with the van Herk/Gil-Werman algorithm).
+ *
+ * \param  mask        the mask to dilate
+ * \param  iterations  number of 3x3 iterations
+ * \param  buffers     row buffers (not shared between threads)
+ */
+void cvDilateBinary(cBitMask &mask, int iterations, cMorphBuffers &buffers);
+
+/**
+ * Erode a bit-packed binary mask in place as cv::erode() with the default
+ * 3x3 kernel and the given number of iterations, in constant time per pixel.
+ *
+ * \param  mask        the mask to erode
+ * \param  iterations  number of 3x3 iterations
+ * \param  buffers     row buffers (not shared between threads)
+ */
+void cvErodeBinary(cBitMask &mask, int iterations, cMorphBuffers &buffers);
 
 /**
  * Find the skeleton of an image.
@@ -38,19 +158,39 @@ void cvFilterHSV(cv::Mat &dstBin, cv::Mat &srcHSV, cv::Scalar colorHSV,
  */
 void cvSkeleton(cv::Mat &src, cv::Mat &dst);
 
+/**
+ * Initialize the moving average of FilterMotion() with an image.
+ *
+ * \param  srcColor       the first input image (BGR)
+ * \param  movingAverage  the output moving average (fixed-point, CV_16UC3
+ *                        with MOTIONAVERAGEBITS fractional bits)
+ */
+void InitMotionAverage(cv::Mat &srcColor, cv::Mat &movingAverage);
+
 /**
  * Filter for finding the dynamic part of an image.
  *
  * Source: http://sundararajana.blogspot.com/2007/05/motion-detection-using-opencv.html
  *
+ * The difference from the moving average, the sum of its channels, the
+ * threshold and the update of the moving average are done in a single
+ * pass, the moving average is kept in 16-bit fixed-point. The output is
+ * written directly as a bit-packed mask. SSE4.1 is used when available
+ * (with the same results).
+ *
  * \param  srcColor       the newest input image
  * \param  movingAverage  the moving average of recent input images
- * \param  dstGrey        output image after the motion filter
+ *                        (see InitMotionAverage())
+ * \param  dstMask        output mask after the motion filter
  * \param  mdAlpha        the alpha parameter of the running average
  * \param  mdThreshold    the gray level threshold of the output
+ * \param  buffers        row buffers of the dilate/erode operations
+ * \param  downscale      srcColor is downscaled by this factor (the
+ *                        dilate/erode sizes are scaled accordingly)
  */
 void FilterMotion(cv::Mat &srcColor, cv::Mat &movingAverage,
-        cv::Mat &dstGrey, double mdAlpha, int mdThreshold);
+        cBitMask &dstMask, double mdAlpha, int mdThreshold,
+        cMorphBuffers &buffers, int downscale = 1);
 
 /**
  * Simple linear regression of y = a + b * x
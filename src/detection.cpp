@@ -0,0 +1,173 @@
+#include <vector>
+
+#include "blob.h"
+#include "cage.h"
+#include "cvutils.h"
+#include "detection.h"
+#include "profiler.h"
+#include "tiles.h"
+#include "tracking.h"
+
+////////////////////////////////////////////////////////////////////////////////
+void SmoothFrame(cFrame* f, cv::Mat &inputimageROI, cCS* cs) {
+    if (cs->gausssmoothing) {
+        cv::GaussianBlur(inputimageROI, f->smoothinputimage,
+                cv::Size(cs->gausssmoothing, cs->gausssmoothing), 0);
+    } else {
+        inputimageROI.copyTo(f->smoothinputimage);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void InitMotionDetection(cFrame* f, cv::Mat &inputimageROI, cCS* cs,
+        cWorkspace* ws) {
+    // tiled detection smoothes band by band, so the full image is smoothed here
+    if (cs->tilerows > 0 && !cs->bShowDebugVideo) {
+        f->smoothinputimage.create(inputimageROI.size(), CV_8UC3);
+        SmoothRect(f->smoothinputimage, inputimageROI, cs->gausssmoothing,
+                cv::Rect(0, 0, inputimageROI.cols, inputimageROI.rows));
+    } else {
+        SmoothFrame(f, inputimageROI, cs);
+    }
+    if (cs->ratdownscale > 1) {
+        cvDownscale(ws->smallimage, f->smoothinputimage, cs->ratdownscale);
+        InitMotionAverage(ws->smallimage, ws->movingAverage);
+    } else {
+        InitMotionAverage(f->smoothinputimage, ws->movingAverage);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool DetectFrame(cFrame* f, cv::Mat &inputimageROI, cTextWriter& framelog,
+        cCS* cs, std::list<cColorSet>* mColorDataBase, cColor* mColor,
+        tColor* mBGColor, tHSVLookup* mHSVLookup, cWorkspace* ws,
+        lighttype_t* mLight, timed_t inputvideostarttime) {
+    int i;
+    bool bTiledDetection = cs->tilerows > 0 && !cs->bShowDebugVideo;
+
+    if (bTiledDetection) {
+        // the image is smoothed band by band, only the LED area is needed in advance
+        f->smoothinputimage.create(inputimageROI.size(), CV_8UC3);
+    }
+
+    // detect day/night light from RED LED
+    // LED detection is always on on first 50 frames, frame skipping starts only after that
+    if (cs->bLED && (f->currentframe < 50 ||
+            (f->currentframe % cs->LEDdetectionskipfactor) == 0)) {
+        // LED detection is on the ORIGINAL frame, not using ROI
+        cStageTimer stagetimer(STAGE_LED);
+        if (bTiledDetection) {
+            SmoothRect(f->smoothinputimage, inputimageROI, cs->gausssmoothing,
+                    GetLEDRect(cs) & cv::Rect(0, 0, inputimageROI.cols,
+                    inputimageROI.rows));
+        }
+        if (!ReadDayNightLED(f->smoothinputimage, f->inputimage, framelog,
+                cs, mColorDataBase, mColor, mBGColor, mHSVLookup, ws,
+                mLight, inputvideostarttime, f->currentframe)) {
+            return false;
+        }
+    }
+
+    if (bTiledDetection) {
+        // classification, rat and blob detection on bands of the image
+        DetectTiled(inputimageROI, f->smoothinputimage, cs, mColor,
+                mHSVLookup, ws, f->mRatParticles, f->mBlobParticles,
+                f->currentframe, framelog);
+    } else {
+        // classify all pixels with all colors and the background in one pass
+        // (HSV conversion is done on the fly)
+        MEASURE_DURATION(STAGE_CLASSIFY, ClassifyColors(f->smoothinputimage, ws->labelimage,
+                mHSVLookup));
+
+        // try to detect rats as a whole (and store in ratmask + as blobs)
+        if (cs->ratdownscale > 1) {
+            MEASURE_DURATION(STAGE_DETECTRATS, DetectRatsDownscaled(ws->labelimage, ws->ratmask,
+                    ws->ratimage, ws->smallratimage, ws->smallratmask, cs,
+                    &ws->blobws, f->mRatParticles, f->currentframe, framelog));
+        } else {
+            MEASURE_DURATION(STAGE_DETECTRATS, DetectRats(ws->labelimage, ws->ratmask, cs,
+                    &ws->blobws, f->mRatParticles, f->currentframe, framelog));
+        }
+
+        //for (int iii=0;iii<5;iii++) {
+        //      std::cout << mColor[iii].name << " ";
+        //      for (int jjj=0;jjj<3;jjj++)
+        //              std::cout << mColor[iii].mColor.mColorHSV.val[jjj] << " ";
+        //      for (int jjj=0;jjj<3;jjj++)
+        //              std::cout << mColor[iii].mColor.mRangeHSV.val[jjj] << " ";
+        //      std::cout << std::endl;
+        //}
+
+        // mask color labels with ratmask for main blob detection
+        MaskColorLabels(ws->labelimage, ws->ratmask, mHSVLookup);
+        // colored blobs are searched only around rats and tracked blobs if needed
+        std::vector<cv::Rect>* regions[MAXMBASE];
+        for (i = 0; i < MAXMBASE; i++)
+            regions[i] = NULL;
+        if (cs->bRatRegions && !cs->bShowDebugVideo) {
+            MEASURE_DURATION(STAGE_RATREGIONS, FindRatRegions(ws->ratmask, cs,
+                    mColor, mHSVLookup, ws->regionlabeler, ws->ratregions));
+            for (i = 0; i < MAXMBASE; i++)
+                regions[i] = &ws->ratregions;
+        }
+        std::vector<cv::Rect>* windows[MAXMBASE];
+        for (i = 0; i < MAXMBASE; i++)
+            windows[i] = NULL;
+        if (cs->trackingwindow && !cs->bShowDebugVideo) {
+            MEASURE_DURATION(STAGE_TRACKING, GetTrackingWindows(cs, mColor,
+                    &ws->tracking, f->mRatParticles, ws->labelimage.size(),
+                    f->currentframe, windows));
+        }
+        // Detect the blobs of all the used colors
+        if (cs->colorthreads > 1 && !cs->bShowDebugVideo) {
+            MEASURE_DURATION(STAGE_FINDHSVBLOBS, FindHSVBlobsParallel(ws->labelimage,
+                    &ws->colorworkers, ws->colorws, ws->colorparticles,
+                    ws->colorlog, mColor, cs, f->mBlobParticles,
+                    f->currentframe, framelog, regions, windows,
+                    ws->tracking.bFullScan));
+        } else {
+            cStageTimer stagetimer(STAGE_FINDHSVBLOBS);
+            for (i = 0; i < cs->mBase; i++)
+                if (mColor[i].mUse) {
+                    mColor[i].mNumBlobsFound = 0;
+                    MEASURE_DURATION(STAGE_FINDHSVBLOBS_COLOR + i, FindHSVBlobs(
+                            ws->labelimage, i, mColor, cs, &ws->blobws,
+                            f->mBlobParticles, f->currentframe, framelog, regions[i],
+                            windows[i], &ws->tracking.bFullScan[i]));
+                }
+        }
+        if (cs->trackingwindow && !cs->bShowDebugVideo) {
+            UpdateTracking(&ws->tracking, f->mBlobParticles, f->currentframe);
+        }
+    }
+
+    // motion detection filter and MD blobfinder
+    if (cs->bMotionDetection && cs->ratdownscale > 1) {
+        // on the downscaled image
+        MEASURE_DURATION(STAGE_FILTERMOTION, cvDownscale(ws->smallimage,
+                f->smoothinputimage, cs->ratdownscale);
+                FilterMotion(ws->smallimage, ws->movingAverage,
+                ws->motionmask, cs->mdAlpha, cs->mdThreshold, ws->blobws.morph,
+                cs->ratdownscale));
+        if (cs->bShowDebugVideo) {
+            cv::Mat debugimage;
+            ws->motionmask.ToBinary(debugimage);
+            cv::imshow("MD", debugimage);
+        }
+        MEASURE_DURATION(STAGE_FINDMDBLOBS, FindMDorRatBlobs(ws->motionmask, cs,
+                &ws->blobws, f->mMDParticles, f->currentframe, framelog,
+                cs->ratdownscale));
+    } else if (cs->bMotionDetection) {
+        MEASURE_DURATION(STAGE_FILTERMOTION, FilterMotion(f->smoothinputimage, ws->movingAverage,
+                ws->motionmask, cs->mdAlpha, cs->mdThreshold, ws->blobws.morph));
+        if (cs->bShowDebugVideo) {
+            cv::Mat debugimage;
+            ws->motionmask.ToBinary(debugimage);
+            cv::imshow("MD", debugimage);
+        }
+        MEASURE_DURATION(STAGE_FINDMDBLOBS, FindMDorRatBlobs(ws->motionmask, cs,
+                &ws->blobws, f->mMDParticles, f->currentframe, framelog));
+    }
+
+    return true;
+}
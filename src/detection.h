@@ -0,0 +1,64 @@
+#ifndef HEADER_DETECTION
+#define HEADER_DETECTION
+
+#include <list>
+
+#include <opencv2/opencv.hpp>
+
+#include "color.h"
+#include "datetime.h"
+#include "frame.h"
+#include "ini.h"
+#include "light.h"
+#include "textwriter.h"
+#include "workspace.h"
+
+/**
+ * Smooth the input image ROI of a frame into its smooth input image with
+ * the Gauss kernel of the settings (or copy it if there is no smoothing).
+ *
+ * \param f              the frame, f->smoothinputimage is written
+ * \param inputimageROI  the ROI of the input image of the frame
+ * \param cs             control state structure
+ */
+void SmoothFrame(cFrame* f, cv::Mat &inputimageROI, cCS* cs);
+
+/**
+ * Initialize the moving average of motion detection from the first frame,
+ * smoothed (and downscaled) exactly as DetectFrame() gets later frames.
+ * Used by ratognize and ratognize_bench alike.
+ *
+ * \param f              the first frame, f->smoothinputimage is written
+ * \param inputimageROI  the ROI of the input image of the frame
+ * \param cs             control state structure
+ * \param ws             workspace holding the moving average
+ */
+void InitMotionDetection(cFrame* f, cv::Mat &inputimageROI, cCS* cs,
+        cWorkspace* ws);
+
+/**
+ * All image processing of the detection stage on a single frame: LED
+ * detection, color classification, rat detection, colored blob detection
+ * (tiled, in regions, in tracking windows or in parallel, as set in cs)
+ * and motion detection. Used by ratognize and ratognize_bench alike.
+ *
+ * \param f                    the frame with the input image, blobs are appended
+ * \param inputimageROI        the ROI of the input image of the frame
+ * \param framelog             the log of the frame
+ * \param cs                   control state structure
+ * \param mColorDataBase       the full color database list [day/night]
+ * \param mColor               the actual colors to detect
+ * \param mBGColor             the actual background color definition
+ * \param mHSVLookup           the lookup table of the actual color definitions
+ * \param ws                   workspace holding all scratch images
+ * \param mLight               the current light setting (updated by LED detection)
+ * \param inputvideostarttime  start time of the input video
+ *
+ * \return true on success, false on error
+ */
+bool DetectFrame(cFrame* f, cv::Mat &inputimageROI, cTextWriter& framelog,
+        cCS* cs, std::list<cColorSet>* mColorDataBase, cColor* mColor,
+        tColor* mBGColor, tHSVLookup* mHSVLookup, cWorkspace* ws,
+        lighttype_t* mLight, timed_t inputvideostarttime);
+
+#endif
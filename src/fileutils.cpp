@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef ON_LINUX
+#include <dirent.h>
+#else
+#include <direct.h>
+#include <io.h>
+#endif
+
+#include "fileutils.h"
+
+////////////////////////////////////////////////////////////////////////////////
+static inline bool IsSeparator(char c) {
+#ifdef ON_LINUX
+    return c == '/';
+#else
+    return c == '/' || c == '\\';
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool IsDirectory(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool MakeDirectory(const char* path) {
+    std::string dir(path);
+    size_t i;
+
+    // create all parents first, then the directory itself
+    for (i = 1; i <= dir.size(); i++) {
+        if (i < dir.size() && !IsSeparator(dir[i]))
+            continue;
+        std::string parent = dir.substr(0, i);
+        if (IsSeparator(parent[parent.size() - 1]) ||
+                parent[parent.size() - 1] == ':' || IsDirectory(parent.c_str()))
+            continue;
+#ifdef ON_LINUX
+        if (mkdir(parent.c_str(), 0777) != 0 && errno != EEXIST)
+#else
+        if (_mkdir(parent.c_str()) != 0 && errno != EEXIST)
+#endif
+            return false;
+    }
+
+    return IsDirectory(path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CopyFileContents(const char* srcfile, const char* dstfile) {
+    std::ifstream ifs(srcfile, std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+    std::ofstream ofs(dstfile, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open())
+        return false;
+    // an empty file has nothing to copy (and operator<< would fail on it)
+    if (ifs.peek() != std::ifstream::traits_type::eof())
+        ofs << ifs.rdbuf();
+    ofs.close();
+
+    return !ofs.fail();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// check extension of a file name (case insensitive)
+static bool HasExtension(const std::string& name,
+        const std::vector<std::string>& extensions) {
+    size_t i, dot = name.find_last_of('.');
+    if (extensions.empty())
+        return true;
+    if (dot == std::string::npos)
+        return false;
+    std::string ext = name.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    for (i = 0; i < extensions.size(); i++) {
+        if (ext == extensions[i])
+            return true;
+    }
+
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ListDirectory(const char* path, const std::vector<std::string>& extensions,
+        std::vector<std::string>& files) {
+    std::vector<std::string> names;
+    std::string dir(path);
+    size_t i;
+
+    if (!dir.empty() && !IsSeparator(dir[dir.size() - 1]))
+#ifdef ON_LINUX
+        dir += '/';
+#else
+        dir += '\\';
+#endif
+#ifdef ON_LINUX
+    DIR* d = opendir(path);
+    struct dirent* entry;
+    if (!d)
+        return false;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    }
+    closedir(d);
+#else
+    struct _finddata_t entry;
+    intptr_t h = _findfirst((dir + "*").c_str(), &entry);
+    if (h == -1)
+        return false;
+    do {
+        if (entry.name[0] != '.' && !(entry.attrib & _A_SUBDIR))
+            names.push_back(entry.name);
+    } while (_findnext(h, &entry) == 0);
+    _findclose(h);
+#endif
+    std::sort(names.begin(), names.end());
+    for (i = 0; i < names.size(); i++) {
+        if (HasExtension(names[i], extensions) && !IsDirectory((dir + names[i]).c_str()))
+            files.push_back(dir + names[i]);
+    }
+
+    return true;
+}
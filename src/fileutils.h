@@ -0,0 +1,46 @@
+#ifndef HEADER_FILEUTILS
+#define HEADER_FILEUTILS
+
+#include <string>
+#include <vector>
+
+/**
+ * Create a directory with all missing parent directories (like mkdir -p).
+ *
+ * \param path  the directory to create (with or without trailing separator)
+ *
+ * \return true if the directory exists after the call
+ */
+bool MakeDirectory(const char* path);
+
+/**
+ * Copy a file (overwrite destination if it exists).
+ *
+ * \param srcfile  the file to copy
+ * \param dstfile  the new file
+ *
+ * \return true on success
+ */
+bool CopyFileContents(const char* srcfile, const char* dstfile);
+
+/**
+ * Check whether a path is an existing directory.
+ *
+ * \param path  the path to check
+ */
+bool IsDirectory(const char* path);
+
+/**
+ * List the regular files of a directory in alphabetical order.
+ *
+ * \param path        the directory to list
+ * \param extensions  only files with these extensions are listed (all if empty),
+ *                    with leading dot, compared case insensitively
+ * \param files       the full path of the files found (appended)
+ *
+ * \return false if the directory could not be read
+ */
+bool ListDirectory(const char* path, const std::vector<std::string>& extensions,
+        std::vector<std::string>& files);
+
+#endif
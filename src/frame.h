@@ -0,0 +1,58 @@
+#ifndef HEADER_FRAME
+#define HEADER_FRAME
+
+#include <opencv2/opencv.hpp>
+
+#include "barcode.h"
+#include "blob.h"
+#include "blobfile.h"
+#include "color.h"
+#include "constants.h"
+#include "light.h"
+#include "textwriter.h"
+
+// all data belonging to a single video frame, as it is passed
+// between the decode, detection and output stages of processing
+class cFrame {
+  public:
+    int currentframe;           // frame number of the image (starting from zero)
+    cv::Mat inputimage;         // BGR original image read from the video
+    cv::Mat smoothinputimage;   // BGR ROI image smoothed, to work on with all image processing tools
+    tBarcode mBarcodes;         // barcodes loaded from trajognize output
+    tBlob mBlobParticles;       //!< The list of detected colored-particles.
+    tBlob mMDParticles;         // list of motion-detected blobs
+    tBlob mRatParticles;        // list of rat blobs
+    lighttype_t mLight;         // light setting used on this frame
+    cColor mColor[MAXMBASE];    // copy of the color state used on this frame (names, blobs found)
+    cTextWriter log;            // log lines of the frame (used in pipeline mode)
+    cBlobFrame blobframe;       // blob file columns of the frame (output stage)
+    //! Constructor.
+    cFrame() {
+        Reset();
+    }
+    //! Destructor.
+    ~cFrame() {
+    }
+    // reserve blob memory for the whole run, given the maximum number of
+    // colored blobs and of motion/rat blobs of a frame
+    void ReserveBlobs(size_t colorblobs, size_t ratblobs) {
+        mBlobParticles.reserve(colorblobs);
+        mMDParticles.reserve(ratblobs);
+        mRatParticles.reserve(ratblobs);
+    }
+    // reset (images are kept to be reused on the next frame)
+    void Reset() {
+        currentframe = 0;
+        mBarcodes.clear();
+        mBlobParticles.clear();
+        mMDParticles.clear();
+        mRatParticles.clear();
+        mLight = UNINITIALIZEDLIGHT;
+        for (int i = 0; i < MAXMBASE; i++)
+            mColor[i].Reset();
+        log.clear();
+        blobframe.Reset();
+    }
+};
+
+#endif
@@ -99,6 +99,8 @@ bool ReadIniFile(bool tempDSLP, cCS* cs,
             tempcs.bCout = (i == 1);
         } else if (sscanf(str.data(), "bCin=%d", &i) == 1) {
             tempcs.bCin = (i == 1);
+        } else if (sscanf(str.data(), "bProfile=%d", &i) == 1) {
+            tempcs.bProfile = (i == 1);
         } else if (sscanf(str.data(), "bApplyROIToVideoOutput=%d", &i) == 1) {
             tempcs.bApplyROIToVideoOutput = (i == 1);
 
@@ -146,6 +148,16 @@ bool ReadIniFile(bool tempDSLP, cCS* cs,
             parseStringToNumberList(&str[i], NULL, tempcs.mElongationMax, MAXMBASE);
         } else if (sscanf(str.data(), "bBlobE=%d", &i) == 1) {
             tempcs.bBlobE = (i == 1);
+        } else if (sscanf(str.data(), "blobextraction=%d", &i) == 1) {
+            tempcs.blobextraction = (blobextraction_t)i;
+        } else if (sscanf(str.data(), "blobfileformat=%d", &i) == 1) {
+            tempcs.blobfileformat = (blobfileformat_t)i;
+        } else if (sscanf(str.data(), "bRatRegions=%d", &i) == 1) {
+            tempcs.bRatRegions = (i == 1);
+        } else if (sscanf(str.data(), "trackingwindow=%d", &i) == 1) {
+            tempcs.trackingwindow = std::max(i, 0);
+        } else if (sscanf(str.data(), "trackingfullscan=%d", &i) == 1) {
+            tempcs.trackingfullscan = std::max(i, 1);
 		// dilate/erode
 		} else if (sscanf(str.data(), "mErodeBlob=%d", &i) == 1) {
 			tempcs.mErodeBlob = i;
@@ -155,6 +167,24 @@ bool ReadIniFile(bool tempDSLP, cCS* cs,
 			tempcs.mErodeRat = i;
 		} else if (sscanf(str.data(), "mDilateRat=%d", &i) == 1) {
 			tempcs.mDilateRat = i;
+		} else if (sscanf(str.data(), "ratdownscale=%d", &i) == 1) {
+			tempcs.ratdownscale = std::max(i, 1);
+		// parallel processing
+		} else if (sscanf(str.data(), "colorthreads=%d", &i) == 1) {
+			tempcs.colorthreads = std::max(i, 0);
+		} else if (sscanf(str.data(), "pipelinequeue=%d", &i) == 1) {
+			tempcs.pipelinequeue = std::max(i, 0);
+		} else if (sscanf(str.data(), "tilerows=%d", &i) == 1) {
+			tempcs.tilerows = std::max(i, 0);
+		} else if (sscanf(str.data(), "textflushinterval=%g", &f) == 1) {
+			tempcs.textflushinterval = std::max((double)f, 0.0);
+		} else if (sscanf(str.data(), "chunks=%d", &i) == 1) {
+			tempcs.chunks = std::max(i, 0);
+		} else if (sscanf(str.data(), "chunkwarmup=%d", &i) == 1) {
+			tempcs.chunkwarmup = std::max(i, 0);
+		} else if (sscanf(str.data(), "batchjobs=%d", &i) == 1) {
+			if (!cs->batchjobs)
+				tempcs.batchjobs = std::max(i, 1);
 		// skip factors
 		} else if (sscanf(str.data(), "outputvideoskipfactor=%d", &i) == 1) {
             tempcs.outputvideoskipfactor = std::max(i, 1);
@@ -174,6 +204,8 @@ bool ReadIniFile(bool tempDSLP, cCS* cs,
             tempcs.firstframe = i;
         } else if (sscanf(str.data(), "lastframe=%d", &i) == 1) {
             tempcs.lastframe = i;
+        } else if (sscanf(str.data(), "bVideoIndex=%d", &i) == 1) {
+            tempcs.bVideoIndex = (i == 1);
         } else if (sscanf(str.data(), "displaywidth=%d", &i) == 1) {
             tempcs.displaywidth = i;
         } else if (sscanf(str.data(), "gausssmoothing=%d", &i) == 1) {
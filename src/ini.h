@@ -24,6 +24,18 @@ typedef enum {
     OUTPUT_VIDEO_BLOBCOUNT = 256,
 } outputvideotype_t;
 
+// blob extraction methods
+typedef enum {
+    BLOB_EXTRACT_CONTOURS = 0,   // contour polygon moments (cv::findContours)
+    BLOB_EXTRACT_COMPONENTS = 1, // pixel moments of connected components
+} blobextraction_t;
+
+// blob file formats
+typedef enum {
+    BLOBFILE_TEXT = 0,          // tab separated text with {} groups
+    BLOBFILE_BINARY = 1,        // binary columns with frame index
+} blobfileformat_t;
+
 //! A structure for storing control states (that are read from the .ini file)
 class cCS {
   public:
@@ -36,6 +48,7 @@ class cCS {
     bool bWriteText;
     bool bCout;
     bool bCin;
+    bool bProfile;              // write stage duration report (.profile.json)?
     bool bApplyROIToVideoOutput;
     // motion detection filter
     bool bMotionDetection;
@@ -53,11 +66,25 @@ class cCS {
 	double mAreaMax[MAXMBASE];  // min area calculated from min diameter (watch for sync) for each color
 	double mElongationMax[MAXMBASE]; // maximum elongation of blob ellipse (A/B) for each color
     bool bBlobE;                // blobs are treated as ellipses (1) or circles(0)?
+    blobextraction_t blobextraction; // contours (0) or connected components (1)
+    blobfileformat_t blobfileformat; // .blobs file is text (0) or binary (1)
+    bool bRatRegions;           // colored blobs are searched around rats (1) or on the whole image (0)
+    int trackingwindow;         // margin of search windows around the blobs of the previous frame [pixel] (0 - no tracking)
+    int trackingfullscan;       // frames between full searches in tracking mode
     // dilate and erode operation params
 	int mErodeBlob;
 	int mDilateBlob;
 	int mErodeRat;
 	int mDilateRat;
+	int ratdownscale;           // rats and motion are detected on an image downscaled by this factor (1 - full resolution)
+	// parallel processing
+	int colorthreads;           // number of threads used for color blob detection (0, 1 - serial)
+	int pipelinequeue;          // size of queues between decode, detection and output threads (0 - serial)
+	int tilerows;               // height of bands in tiled detection [pixel] (0 - whole image at once)
+	double textflushinterval;   // max time between writes of .blobs and .log output [s] (0 - only when buffer is full)
+	int chunks;                 // number of worker processes the frame range is split to (0, 1 - single process)
+	int chunkwarmup;            // number of frames processed before the output of a chunk starts
+	int batchjobs;              // number of videos processed at the same time in batch mode
 	// day/night switch
     bool bLED;                  // do we use it at all or Day settings by default?
     cv::Point mLEDPos;            // X,Y coordinate of the red LED switch
@@ -66,6 +93,7 @@ class cCS {
     char inifile[MAXPATH];      // this is not read from .ini file but defines it (can be overwritten from command line arg.)
     char paintdatefile[MAXPATH];
     char inputvideofile[MAXPATH];
+    char filelist[MAXPATH];     // list of input videos in batch mode (only from command line)
     char inputbarcodefile[MAXPATH];     // trajognize style
     char inputdatfile[MAXPATH]; // output of previous ratognize run
     char inputlogfile[MAXPATH]; // output of previous ratognize run
@@ -83,6 +111,7 @@ class cCS {
     outputvideotype_t outputvideotype;  // what goes on the output video?
     int firstframe;
     int lastframe;
+    bool bVideoIndex;           // seek to firstframe using a (cached) keyframe index of the video
     int displaywidth;
     cv::Rect imageROI;
     int dayssincelastpaint;     // colors are stored in an external list, here only day is specified since last paint
@@ -92,19 +121,25 @@ class cCS {
     //! Constructor.
     cCS(): bProcessText(false), bProcessImage(false), bShowVideo(false),
             bShowDebugVideo(false), bWriteVideo(0), bWriteText(false),
-            bCout(false), bCin(false), bApplyROIToVideoOutput(false),
+            bCout(false), bCin(false), bProfile(false),
+            bApplyROIToVideoOutput(false),
             bMotionDetection(false), mdAlpha(0.1), mdThreshold(15),
             mdAreaMin(5000), mdAreaMax(10000),
             mRats(28), mChips(3), mBase(5),
-            bBlobE(false),
+            bBlobE(false), blobextraction(BLOB_EXTRACT_CONTOURS),
+            blobfileformat(BLOBFILE_TEXT), bRatRegions(false),
+            trackingwindow(0), trackingfullscan(25),
             mErodeBlob(2), mDilateBlob(2), mErodeRat(4), mDilateRat(6),
+            ratdownscale(1),
+            colorthreads(0), pipelinequeue(0), tilerows(0), textflushinterval(0),
+            chunks(0), chunkwarmup(100), batchjobs(0),
             bLED(false),
             //mLEDPos(?), mLEDColor(?)
             outputvideoskipfactor(1), outputscreenshotskipfactor(1),
             LEDdetectionskipfactor(1),
             hipervideostart(0), hipervideoend(0), hipervideoduration(0),
             outputvideotype(OUTPUT_VIDEO_BASIC),
-            firstframe(0), lastframe(0), displaywidth(0),
+            firstframe(0), lastframe(0), bVideoIndex(false), displaywidth(0),
 			//imageROI(?),
             dayssincelastpaint(0), colorselectionmethod(COLOR_FIT_LINEAR),
             gausssmoothing(0),  bInputVideoIsInterlaced(false) {
@@ -112,6 +147,7 @@ class cCS {
         strncpy(inifile, "etc/configs/ratognize.ini", MAXPATH);
         paintdatefile[0]=0;
         inputvideofile[0]=0;
+        filelist[0]=0;
         inputbarcodefile[0]=0;
         inputdatfile[0]=0;
         inputlogfile[0]=0;
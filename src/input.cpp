@@ -1,6 +1,8 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <fstream>
@@ -13,32 +15,23 @@
 #include "input.h"
 #include "light.h"
 #include "log.h"
+#include "mappedfile.h"
 
-bool OpenInputFileStream(std::ifstream& ifs, char *filename) {
-    ifs.open(filename);
-    if (!ifs.is_open()) {
-        return false;
-    }
-    return true;
-}
-
-bool ReadNextBarcodesFromFile(std::ifstream& ifs, tBarcode& mBarcodes, cCS* cs, int currentframe) {
+bool ReadNextBarcodesFromFile(cMappedFile& ifs, tBarcode& mBarcodes, cCS* cs, int currentframe) {
     // init variables
-    std::string line;
+    const char *line, *lineend, *token, *tokenend;
     cBarcode barcode;
-    int i;
+    int i, j;
     // read file line by line
-    while (!ifs.eof()) {
+    while (ifs.NextLine(&line, &lineend)) {
         // get next line
-        getline(ifs, line);
-        if (!line.length() || line[0] == '#')
+        if (line == lineend || line[0] == '#')
             continue;
-        // parse line
-        std::stringstream lineStream(line);
-        std::string token;
+        // parse line (in place)
+        cLineTokens lineTokens(line, lineend);
         // get frame number
-        lineStream >> token;
-        i = atoi(token.c_str());
+        lineTokens.Next(&token, &tokenend);
+        i = ParseInt(token, tokenend);
 		if (i < currentframe) {
 			continue;
 		} else if (i > currentframe) {
@@ -46,8 +39,8 @@ bool ReadNextBarcodesFromFile(std::ifstream& ifs, tBarcode& mBarcodes, cCS* cs,
             return false;
         }
         // get blob count
-        lineStream >> token;
-        i = atoi(token.c_str());
+        lineTokens.Next(&token, &tokenend);
+        i = ParseInt(token, tokenend);
         if (i < 0) {
             LOG_ERROR("Could not read number of barcodes from barcode file (column 2).");
             return false;
@@ -57,19 +50,22 @@ bool ReadNextBarcodesFromFile(std::ifstream& ifs, tBarcode& mBarcodes, cCS* cs,
             return true;
         // split rest of line into pieces: {ID  centerx centery xWorld  yWorld  orientation     mFix}   {...
         i = 0;
-        while (lineStream >> token) {
+        while (lineTokens.Next(&token, &tokenend)) {
             switch (i) {
                 // ID
             case 0:
-                strncpy(barcode.strid, token.c_str(), sizeof(cBarcode::strid));
+                // same as strncpy() of the whole token
+                j = std::min((int)(tokenend - token), (int)sizeof(cBarcode::strid));
+                memcpy(barcode.strid, token, j);
+                memset(barcode.strid + j, 0, sizeof(cBarcode::strid) - j);
                 break;
                 // centerx
             case 1:
-                barcode.mCenter.x = atof(token.c_str()) - cs->imageROI.x;
+                barcode.mCenter.x = ParseDouble(token, tokenend) - cs->imageROI.x;
                 break;
                 // centery
             case 2:
-                barcode.mCenter.y = atof(token.c_str()) - cs->imageROI.y;
+                barcode.mCenter.y = ParseDouble(token, tokenend) - cs->imageROI.y;
                 break;
                 // world coordinates not needed
             case 3:
@@ -78,11 +74,11 @@ bool ReadNextBarcodesFromFile(std::ifstream& ifs, tBarcode& mBarcodes, cCS* cs,
                 // orientation
             case 5:
                 // convert back from [deg] to [rad]
-                barcode.mOrientation = atof(token.c_str()) * M_PI / 180.0;
+                barcode.mOrientation = ParseDouble(token, tokenend) * M_PI / 180.0;
                 break;
                 // mFix
             case 6:
-                barcode.mFix = atoi(token.c_str());
+                barcode.mFix = ParseInt(token, tokenend);
                 break;
             }
             // check for full barcode structure
@@ -109,28 +105,29 @@ bool ReadNextBarcodesFromFile(std::ifstream& ifs, tBarcode& mBarcodes, cCS* cs,
     return false;
 }
 
-bool ReadNextBlobsFromFile(std::ifstream& ifs, tBlob& mBlobParticles,
+bool ReadNextBlobsFromFile(cMappedFile& ifs, tBlob& mBlobParticles,
         tBlob& mMDParticles, tBlob& mRatParticles, cCS* cs, int currentframe) {
     // init variables
-    std::string line;
-    cBlob particle;
+    const char *line, *lineend, *token, *tokenend, *linetype, *linetypeend;
+    // fields of the current particle, stored directly in the blob columns
+    int index = 0;
+    double x = 0, y = 0, a = 0, b = 0, o = 0, r = 0;
     int i, j;
+    bool bMD;
     int linesread = 0;          // 1 - BLOB, 2 - MD, 4 - RAT
     if (!cs->bMotionDetection) {
         linesread = 2;          // we do not expect MD lines if motion detection is turned off
     }
     // read file line by line
-    while (!ifs.eof()) {
+    while (ifs.NextLine(&line, &lineend)) {
         // get next line
-        getline(ifs, line);
-        if (!line.length() || line[0] == '#')
+        if (line == lineend || line[0] == '#')
             continue;
-        // parse line
-        std::stringstream lineStream(line);
-        std::string token, linetype;
+        // parse line (in place)
+        cLineTokens lineTokens(line, lineend);
         // get frame number
-        lineStream >> token;
-        i = atoi(token.c_str());
+        lineTokens.Next(&token, &tokenend);
+        i = ParseInt(token, tokenend);
         if (i < currentframe)
             continue;
         else if (i > currentframe) {
@@ -138,58 +135,56 @@ bool ReadNextBlobsFromFile(std::ifstream& ifs, tBlob& mBlobParticles,
             return false;
         }
         // get blob type
-        lineStream >> linetype;
+        lineTokens.Next(&linetype, &linetypeend);
         // get blob number (NOP)
-        lineStream >> token;
-        if (linetype == "BLOB" || linetype == "BLOBE") {
+        lineTokens.Next(&token, &tokenend);
+        if (TokenEquals(linetype, linetypeend, "BLOB") ||
+                TokenEquals(linetype, linetypeend, "BLOBE")) {
             // BLOB line format has two variants:
             // (assuming circle): framenum  BLOB    BlobCount       {color centerx centery radius} {...
             // (assuming ellipse): framenum BLOB    BlobCount       {color centerx centery axisA axisB orientation} {...
             i = 0;
             j = 4;              // radius format (BLOB)
-            while (lineStream >> token) {
+            while (lineTokens.Next(&token, &tokenend)) {
                 switch (i) {
                     // ID
                 case 0:
-                    particle.index = atoi(token.c_str() + 1);   // remove leading {
+                    index = ParseInt(token + 1, tokenend);   // remove leading {
                     break;
                     // centerx
                 case 1:
-                    particle.mCenter.x = atof(token.c_str()) - cs->imageROI.x;
+                    x = ParseDouble(token, tokenend) - cs->imageROI.x;
                     break;
                     // centery
                 case 2:
-                    particle.mCenter.y = atof(token.c_str()) - cs->imageROI.y;
+                    y = ParseDouble(token, tokenend) - cs->imageROI.y;
                     break;
                     // radius / axisA
                 case 3:
-                    if (token.back() == '}') {
-                        particle.mRadius = atof(token.c_str());
+                    if (tokenend[-1] == '}') {
+                        r = ParseDouble(token, tokenend);
                     } else {
-                        particle.mAxisA = atof(token.c_str());
+                        a = ParseDouble(token, tokenend);
                         j = 6;
                     }
                     break;
                     // axisB
                 case 4:
-                    particle.mAxisB = atof(token.c_str());
+                    b = ParseDouble(token, tokenend);
                     break;
                     // orientation
                 case 5:
                     // convert back from [deg] to [rad]
-                    particle.mOrientation = atof(token.c_str()) * M_PI / 180.0;
+                    o = ParseDouble(token, tokenend) * M_PI / 180.0;
                     break;
                 }
                 // check for full particle structure
                 if (++i == j) {
                     if (j == 4) {
-                        particle.mAxisA = particle.mAxisB = particle.mRadius;
+                        mBlobParticles.Add(index, x, y, r, r, 0, 0, r);
                     } else {
-                        particle.mRadius =
-                                sqrt(particle.mAxisA * particle.mAxisB);
+                        mBlobParticles.Add(index, x, y, a, b, o, 0, sqrt(a * b));
                     }
-                    mBlobParticles.push_back(particle);
-                    particle.Reset();
                     i = 0;
                 }
             }
@@ -199,41 +194,41 @@ bool ReadNextBlobsFromFile(std::ifstream& ifs, tBlob& mBlobParticles,
                 return false;
             }
             linesread |= 1;
-        } else if (linetype == "MD" || linetype == "RAT") {
+        } else if ((bMD = TokenEquals(linetype, linetypeend, "MD")) ||
+                TokenEquals(linetype, linetypeend, "RAT")) {
             // MD line format (assuming ellipse): framenum  MD      MDBlobCount     {centerx        centery axisA   axisB   orientation}    {...
             // RAT line format (assuming ellipse): framenum RAT     RATBlobCount    {centerx        centery axisA   axisB   orientation}    {...
             i = 0;
-            while (lineStream >> token) {
+            while (lineTokens.Next(&token, &tokenend)) {
                 switch (i) {
                     // centerx
                 case 0:
-                    particle.mCenter.x = atof(token.c_str() + 1) - cs->imageROI.x;       // remove leading {
+                    x = ParseDouble(token + 1, tokenend) - cs->imageROI.x;       // remove leading {
                     break;
                     // centery
                 case 1:
-                    particle.mCenter.y = atof(token.c_str()) - cs->imageROI.y;
+                    y = ParseDouble(token, tokenend) - cs->imageROI.y;
                     break;
                     // axisA
                 case 2:
-                    particle.mAxisA = atof(token.c_str());
+                    a = ParseDouble(token, tokenend);
                     break;
                     // axisB
                 case 3:
-                    particle.mAxisB = atof(token.c_str());
+                    b = ParseDouble(token, tokenend);
                     break;
                     // orientation
                 case 4:
                     // convert back from [deg] to [rad]
-                    particle.mOrientation = atof(token.c_str()) * M_PI / 180.0;
+                    o = ParseDouble(token, tokenend) * M_PI / 180.0;
                     break;
                 }
                 // check for full particle structure
                 if (++i == 5) {
-                    if (linetype == "MD")
-                        mMDParticles.push_back(particle);
+                    if (bMD)
+                        mMDParticles.Add(0, x, y, a, b, o, 0, 0);
                     else
-                        mRatParticles.push_back(particle);
-                    particle.Reset();
+                        mRatParticles.Add(0, x, y, a, b, o, 0, 0);
                     i = 0;
                 }
             }
@@ -242,7 +237,7 @@ bool ReadNextBlobsFromFile(std::ifstream& ifs, tBlob& mBlobParticles,
                 LOG_ERROR("Invalid input format in input blob file.");
                 return false;
             }
-            if (linetype == "MD")
+            if (bMD)
                 linesread |= 2;
             else
                 linesread |= 4;
@@ -260,51 +255,41 @@ bool ReadNextBlobsFromFile(std::ifstream& ifs, tBlob& mBlobParticles,
     return false;
 }
 
-int ReadNextLightFromLogFile(std::ifstream& ifs, lighttype_t* mLight, int currentframe) {
+int ReadNextLightFromLogFile(cMappedFile& ifs, lighttype_t* mLight, int currentframe) {
     // init variables
-    static std::string prevline = "";
-	std::string line;
-	std::streampos lastpos;
+    const char *line, *lineend, *token, *tokenend;
     int i;
     // read file line by line
-    while (!ifs.eof()) {
-        // get next line (or continue with previous)
-        if (prevline == "")
-            getline(ifs, line);
-        else
-            line = prevline;
+    while (ifs.NextLine(&line, &lineend)) {
         // check for comment and empty lines
-        if (!line.length() || line[0] == '#')
+        if (line == lineend || line[0] == '#')
             continue;
-        // parse line
-		std::stringstream lineStream(line);
-        std::string token, linetype;
+        // parse line (in place)
+        cLineTokens lineTokens(line, lineend);
         // get frame number
-        lineStream >> token;
-        i = atoi(token.c_str());
+        lineTokens.Next(&token, &tokenend);
+        i = ParseInt(token, tokenend);
         if (i < currentframe)
             continue;
         else if (i > currentframe) {
             // use this line again next time for the next frame
-            prevline = line;
+            ifs.Unread(line);
             return 0;
         }
-        // do not use previous line in the next call
-        prevline = "";
         // get blob type
-        lineStream >> linetype;
+        lineTokens.Next(&token, &tokenend);
         // skip not LED lines
-        if (linetype != "LED")
+        if (!TokenEquals(token, tokenend, "LED"))
             continue;
         // get light type
-        lineStream >> token;
+        lineTokens.Next(&token, &tokenend);
         for (i = 0; i < 4; i++) {
-            if (token == lighttypename[i]) {
+            if (TokenEquals(token, tokenend, lighttypename[i])) {
                 *mLight = (lighttype_t) i;
                 return 1;
             }
         }
-        LOG_ERROR("Unknown light mode read from log file: %s", token.c_str());
+        LOG_ERROR("Unknown light mode read from log file: %.*s", (int)(tokenend - token), token);
         return -1;
     }
 
@@ -0,0 +1,193 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef ON_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.h"
+
+// exact powers of ten used by ParseDouble()
+static const double pow10table[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+static inline bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cMappedFile::Open(const char* filename) {
+    Close();
+#ifdef ON_LINUX
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    size = (size_t)st.st_size;
+    if (size) {
+        void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            // files are read from beginning to end
+            madvise(p, size, MADV_SEQUENTIAL);
+            data = (const char*)p;
+            bMapped = true;
+        }
+    }
+    close(fd);
+    if (size && !bMapped)
+#endif
+    {
+        // read the whole file into memory if it could not be mapped
+        std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+        if (!ifs.is_open())
+            return false;
+        ifs.seekg(0, std::ios::end);
+        size = (size_t)ifs.tellg();
+        ifs.seekg(0, std::ios::beg);
+        buffer.resize(size + 1);
+        if (size && !ifs.read(&buffer[0], size)) {
+            buffer.clear();
+            size = 0;
+            return false;
+        }
+        data = &buffer[0];
+    }
+    if (!data) {
+        // empty file
+        buffer.resize(1);
+        data = &buffer[0];
+    }
+    pos = data;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cMappedFile::Close() {
+#ifdef ON_LINUX
+    if (bMapped)
+        munmap((void*)data, size);
+#endif
+    bMapped = false;
+    buffer.clear();
+    data = NULL;
+    pos = NULL;
+    size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cMappedFile::NextLine(const char** begin, const char** end) {
+    const char* fileend = data + size;
+    const char* p;
+    if (!pos || pos >= fileend)
+        return false;
+    p = (const char*)memchr(pos, '\n', fileend - pos);
+    *begin = pos;
+    if (p) {
+        *end = p;
+        pos = p + 1;
+    } else {
+        *end = fileend;
+        pos = fileend;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cLineTokens::Next(const char** tokenbegin, const char** tokenend) {
+    while (pos < end && IsSpace(*pos))
+        pos++;
+    *tokenbegin = pos;
+    *tokenend = pos;
+    if (pos == end)
+        return false;
+    while (pos < end && !IsSpace(*pos))
+        pos++;
+    *tokenend = pos;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool TokenEquals(const char* begin, const char* end, const char* str) {
+    size_t len = strlen(str);
+    return (size_t)(end - begin) == len && !memcmp(begin, str, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int ParseInt(const char* begin, const char* end) {
+    const char* p = begin;
+    bool bNegative = false;
+    long long value = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        bNegative = (*p++ == '-');
+    while (p < end && IsDigit(*p) && value < 10000000000LL)
+        value = value * 10 + (*p++ - '0');
+
+    return (int)(bNegative ? -value : value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+long long ParseLongLong(const char* begin, const char* end) {
+    const char* p = begin;
+    bool bNegative = false;
+    long long value = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        bNegative = (*p++ == '-');
+    while (p < end && IsDigit(*p) && value < 100000000000000000LL)
+        value = value * 10 + (*p++ - '0');
+
+    return bNegative ? -value : value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double ParseDouble(const char* begin, const char* end) {
+    const char* p = begin;
+    bool bNegative = false;
+    unsigned long long mantissa = 0;
+    int digits = 0, decimals = 0;
+    double value;
+    // sign
+    if (p < end && (*p == '-' || *p == '+'))
+        bNegative = (*p++ == '-');
+    // integer part
+    while (p < end && IsDigit(*p)) {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        digits++;
+    }
+    // fractional part
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && IsDigit(*p)) {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            digits++;
+            decimals++;
+        }
+    }
+    // exact conversion if mantissa and power of ten are exact doubles
+    if (digits && digits <= 18 && decimals <= 22 &&
+            mantissa < (1ULL << 53) &&
+            (p == end || (*p != 'e' && *p != 'E'))) {
+        value = (double)mantissa / pow10table[decimals];
+        return bNegative ? -value : value;
+    }
+    // everything else (exponent, long mantissa, nan, inf) goes to strtod
+    std::string token(begin, end);
+    return strtod(token.c_str(), NULL);
+}
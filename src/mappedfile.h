@@ -0,0 +1,95 @@
+#ifndef HEADER_MAPPEDFILE
+#define HEADER_MAPPEDFILE
+
+#include <cstddef>
+#include <vector>
+
+// Read-only text file mapped into memory (read into memory if mmap is not
+// available) with a cursor, so that consecutive calls can continue reading
+// lines where the previous one stopped, without copying or rescanning them.
+class cMappedFile {
+  public:
+    const char* data;           // file contents (not zero terminated)
+    size_t size;                // file size [bytes]
+    const char* pos;            // cursor: start of the next line to read
+    //! Constructor.
+    cMappedFile() : data(NULL), size(0), pos(NULL), bMapped(false) {
+    }
+    //! Destructor.
+    ~cMappedFile() {
+        Close();
+    }
+    bool Open(const char* filename);
+    void Close();
+    bool is_open() const {
+        return pos != NULL;
+    }
+    // get next line [begin, end) without line end, false at end of file
+    bool NextLine(const char** begin, const char** end);
+    // step back to the beginning of a line read, to read it again next time
+    void Unread(const char* begin) {
+        pos = begin;
+    }
+
+  private:
+    bool bMapped;               // mmap is used (or buffer otherwise)
+    std::vector<char> buffer;   // file contents if mmap is not used
+};
+
+// Whitespace separated tokens of a single line, parsed in place.
+class cLineTokens {
+  public:
+    //! Constructor.
+    cLineTokens(const char* begin, const char* end) : pos(begin), end(end) {
+    }
+    // get next token [begin, end), false (and empty token) at end of line
+    bool Next(const char** tokenbegin, const char** tokenend);
+
+  private:
+    const char* pos;
+    const char* end;
+};
+
+/**
+ * Check whether a token equals a zero terminated string.
+ *
+ * \param begin  the first char of the token
+ * \param end    the char after the last char of the token
+ * \param str    the string to compare with
+ */
+bool TokenEquals(const char* begin, const char* end, const char* str);
+
+/**
+ * Parse an integer from the beginning of a token, like atoi().
+ *
+ * \param begin  the first char of the token
+ * \param end    the char after the last char of the token
+ *
+ * \return the parsed value, 0 if the token does not start with a number
+ */
+int ParseInt(const char* begin, const char* end);
+
+/**
+ * Parse a 64-bit integer from the beginning of a token, like atoll().
+ *
+ * \param begin  the first char of the token
+ * \param end    the char after the last char of the token
+ *
+ * \return the parsed value, 0 if the token does not start with a number
+ */
+long long ParseLongLong(const char* begin, const char* end);
+
+/**
+ * Parse a double from the beginning of a token, like atof().
+ *
+ * Plain decimal numbers of up to 18 digits are converted exactly (with
+ * a single correctly rounded division), strtod() is used for the rest.
+ *
+ * \param begin  the first char of the token
+ * \param end    the char after the last char of the token
+ *
+ * \return the parsed value, 0 if the token does not start with a number
+ */
+double ParseDouble(const char* begin, const char* end);
+
+#endif
@@ -4,14 +4,19 @@
 
 #include "barcode.h"
 #include "blob.h"
+#include "blobfile.h"
+#include "fileutils.h"
+#include "log.h"
 #include "output_text.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// TODO: no error check yet
-void WriteLogFileHeader(cCS* cs, std::string args, std::ofstream& ofslog) {
+bool WriteLogFileHeader(cCS* cs, std::string args, cTextWriter& ofslog) {
 	// open and truncate log output file
-	ofslog.open(cs->outputlogfile, std::ios::out | std::ios::trunc);
+	if (!ofslog.Open(cs->outputlogfile, cs->textflushinterval)) {
+		LOG_ERROR("Could not open output log file '%s'.", cs->outputlogfile);
+		return false;
+	}
 	// get time
 	time_t rawtime;
 	struct tm *timeinfo;
@@ -19,105 +24,83 @@ void WriteLogFileHeader(cCS* cs, std::string args, std::ofstream& ofslog) {
 	timeinfo = localtime(&rawtime);
 
 	// store ini file
-	char cc[3 * MAXPATH];
+	char cc[2 * MAXPATH];
 	snprintf(cc, sizeof(cc),
-#ifdef ON_LINUX
-		cs->bProcessText ? "cp %s %s%s" BARCODETAG ".ini" : "cp %s %s%s.ini",
-#else
-		cs->bProcessText ? "copy %s %s%s" BARCODETAG ".ini" : "copy %s %s%s.ini",
-#endif
-		cs->inifile, cs->outputdirectory, cs->outputfilecommon);
-	system(cc); // TODO: does it work on linux??? \,/ characters, etc.
+		cs->bProcessText ? "%s%s" BARCODETAG ".ini" : "%s%s.ini",
+		cs->outputdirectory, cs->outputfilecommon);
+	if (!CopyFileContents(cs->inifile, cc)) {
+		std::cout << "  Warning: could not copy ini file to " << cc << std::endl;
+	}
 
 	// write dat header
-	ofslog << "# ratognize log file created on: " << asctime(timeinfo) << std::endl
-		<< "# file was called like this: " << args << std::endl
+	ofslog << "# ratognize log file created on: " << asctime(timeinfo) << "\n"
+		<< "# file was called like this: " << args << "\n"
 		<< "# used ini file with settings is stored in: " << cs->
-		outputfilecommon << ".ini" << std::endl << std::endl <<
-		"# Log file format: frame warningtype params" << std::endl <<
-		"# Log file entry types:" << std::endl <<
+		outputfilecommon << ".ini" << "\n\n" <<
+		"# Log file format: frame warningtype params" << "\n" <<
+		"# Log file entry types:" << "\n" <<
 		"#   FIRSTFRAME/LASTFRAME -- frame number of first and last frame read from file"
-		<< std::endl <<
+		<< "\n" <<
 		"#   LED newstate -- led state has changed (possible values: DAYLIGHT, NIGHTLIGHT, EXTRALIGHT, STRANGELIGHT)."
-		<< std::endl <<
+		<< "\n" <<
 		"#   AVG avgR avgG avgB votes_for_daylight maxLEDblobsize -- average intensity of image channels + other params"
-		<< std::endl <<
+		<< "\n" <<
 		"#   BLOBOVERSIZE color/MD/RAT num maxsize -- There are blobs greater than the maximum size allowed."
-		<< std::endl <<
+		<< "\n" <<
 		"#   BLOBUNDERSIZE color/MD/RAT num -- There are blobs too small but larger than 80% of the minimum size allowed."
-		<< std::endl << std::endl;
+		<< "\n\n";
+
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// TODO: no error check yet
-void WriteBlobFileHeader(cCS* cs, std::ofstream& ofsdat) {
+bool WriteBlobFileHeader(cCS* cs, cTextWriter& ofsdat) {
     // open and truncate dat output file
-    ofsdat.open(cs->outputdatfile, std::ios::out | std::ios::trunc);
+    if (!ofsdat.Open(cs->outputdatfile, cs->textflushinterval)) {
+        LOG_ERROR("Could not open output blob file '%s'.", cs->outputdatfile);
+        return false;
+    }
     // write dat header
     if (cs->bMotionDetection)
         ofsdat <<
                 "# MD line format (assuming ellipse): framenum\tMD\tMDBlobCount\t{centerx\tcentery\taxisA\taxisB\torientation}\t{..."
-                << std::endl;
+                << "\n";
     ofsdat <<
             "# RAT line format (assuming ellipse): framenum\tRAT\tRATBlobCount\t{centerx\tcentery\taxisA\taxisB\torientation}\t{..."
-            << std::endl;
+            << "\n";
     if (cs->bBlobE) {
         ofsdat <<
                 "# BLOBE line format (assuming ellipse): framenum\tBLOB\tBlobCount\t{color\tcenterx\tcentery\taxisA\taxisB\torientation}\t{..."
-                << std::endl;
+                << "\n";
     } else {
         ofsdat <<
                 "# BLOB line format (assuming circle): framenum\tBLOB\tBlobCount\t{color\tcenterx\tcentery\tradius}\t{..."
-                << std::endl;
+                << "\n";
     }
     // set output to 1 decimal digits. This is enough for everything if we convert orientation into degrees.
-    ofsdat.setf(std::ios::fixed, std::ios::floatfield);
-    ofsdat.precision(1);
+    ofsdat.SetFixed(BLOBFILEDECIMALS);
+
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// TODO: no error check yet
 // output coordinates are in total image coordinates, not ROI
-void WriteBlobFile(cCS* cs, std::ofstream& ofsdat, tBlob& mBlobParticles,
-        tBlob& mMDParticles, tBlob& mRatParticles, int currentframe) {
-    tBlob::iterator it;
-
-    /////////// dat ///////////
-
-    // write MDBlobParticles
-    if (cs->bMotionDetection) {
-        ofsdat << currentframe << "\tMD\t" << (int) mMDParticles.size() << "\t";
-        for (it = mMDParticles.begin(); it != mMDParticles.end(); ++it) {
-            ofsdat << "{" << (*it).mCenter.x + cs->imageROI.x << "\t" << (*it).mCenter.y + cs->imageROI.y << "\t" << (*it).mAxisA << "\t" << (*it).mAxisB << "\t" << (*it).mOrientation * 180 / M_PI << "}\t";      // [deg]
-        }
-        ofsdat << std::endl;
-    }
-    // write RatParticles
-    ofsdat << currentframe << "\tRAT\t" << (int) mRatParticles.size() << "\t";
-    for (it = mRatParticles.begin(); it != mRatParticles.end(); ++it) {
-        ofsdat << "{" << (*it).mCenter.x + cs->imageROI.x << "\t" << (*it).mCenter.y + cs->imageROI.y << "\t" << (*it).mAxisA << "\t" << (*it).mAxisB << "\t" << (*it).mOrientation * 180 / M_PI << "}\t";  // [deg]
-    }
-    ofsdat << std::endl;
+bool WriteBlobFile(cCS* cs, cTextWriter& ofsdat, cBlobFrame& blobframe,
+        tBlob& mBlobParticles, tBlob& mMDParticles, tBlob& mRatParticles,
+        int currentframe) {
+    FillBlobFrame(cs, blobframe, mBlobParticles, mMDParticles, mRatParticles,
+            currentframe);
+    return WriteBlobFrameText(ofsdat, blobframe);
+}
 
-    // write extended BlobParticles (as ellipse)
-    if (cs->bBlobE) {
-        ofsdat << currentframe << "\tBLOBE\t" << (int) mBlobParticles.
-                size() << "\t";
-        for (it = mBlobParticles.begin(); it != mBlobParticles.end(); ++it) {
-            ofsdat << "{" << (*it).index << "\t" << (*it).mCenter.x + cs->imageROI.x << "\t" << (*it).mCenter.y + cs->imageROI.y << "\t" << (*it).mAxisA << "\t" << (*it).mAxisB << "\t" << (*it).mOrientation * 180 / M_PI << "}\t";       // [deg]
-        }
-        // write BlobParticles (as circles)
-    } else {
-        ofsdat << currentframe << "\tBLOB\t" << (int) mBlobParticles.
-                size() << "\t";
-        for (it = mBlobParticles.begin(); it != mBlobParticles.end(); ++it) {
-            ofsdat << "{" << (*it).index << "\t"
-                    << (*it).mCenter.x + cs->imageROI.x << "\t"
-                    << (*it).mCenter.y + cs->imageROI.y << "\t"
-                    << (*it).mRadius << "}\t";
-        }
-    }
-    ofsdat << std::endl;
+////////////////////////////////////////////////////////////////////////////////
+// output coordinates are in total image coordinates, not ROI
+bool WriteBinaryBlobFile(cCS* cs, cBinaryBlobWriter& writer,
+        cBlobFrame& blobframe, tBlob& mBlobParticles, tBlob& mMDParticles,
+        tBlob& mRatParticles, int currentframe) {
+    FillBlobFrame(cs, blobframe, mBlobParticles, mMDParticles, mRatParticles,
+            currentframe);
+    return writer.Write(blobframe);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -5,37 +5,64 @@
 #include <fstream>
 #include <sstream>
 
+#include "blobfile.h"
 #include "ini.h"
+#include "textwriter.h"
 
 /**
  * Write log file header.
  *
  * \param cs      control states structure
  * \param args    arguments passed to main
- * \param ofslog  the output log file stream
+ * \param ofslog  the output log file writer
+ *
+ * \return true on success, false if the file could not be opened
  */
-void WriteLogFileHeader(cCS* cs, std::string args, std::ofstream& ofslog);
+bool WriteLogFileHeader(cCS* cs, std::string args, cTextWriter& ofslog);
 
 /**
  * Write blob file header.
  *
  * \param cs      control states structure
- * \param ofsdat  the output data file stream
+ * \param ofsdat  the output data file writer
+ *
+ * \return true on success, false if the file could not be opened
  */
-void WriteBlobFileHeader(cCS* cs, std::ofstream& ofsdat);
+bool WriteBlobFileHeader(cCS* cs, cTextWriter& ofsdat);
 
 /**
  * Write data accumulated at a given frame to blob file.
  *
  * \param cs      control states structure
- * \param ofsdat  the output data file stream
+ * \param ofsdat  the output data file writer
+ * \param blobframe       temporary columns of the frame to write
  * \param mBlobParticles  the blob structure to store colored blobs
  * \param mMDParticles    the blob structure to store motion blobs
  * \param mRatParticles   the blob structure to store rat blobs
  * \param currentframe    the current frame
+ *
+ * \return true on success, false otherwise
+ */
+bool WriteBlobFile(cCS* cs, cTextWriter& ofsdat, cBlobFrame& blobframe,
+        tBlob& mBlobParticles, tBlob& mMDParticles, tBlob& mRatParticles,
+        int currentframe);
+
+/**
+ * Write data accumulated at a given frame to binary blob file.
+ *
+ * \param cs      control states structure
+ * \param writer  the binary blob file writer
+ * \param blobframe       temporary columns of the frame to write
+ * \param mBlobParticles  the blob structure to store colored blobs
+ * \param mMDParticles    the blob structure to store motion blobs
+ * \param mRatParticles   the blob structure to store rat blobs
+ * \param currentframe    the current frame
+ *
+ * \return true on success, false otherwise
  */
-void WriteBlobFile(cCS* cs, std::ofstream& ofsdat, tBlob& mBlobParticles,
-        tBlob& mMDParticles, tBlob& mRatParticles, int currentframe);
+bool WriteBinaryBlobFile(cCS* cs, cBinaryBlobWriter& writer,
+        cBlobFrame& blobframe, tBlob& mBlobParticles, tBlob& mMDParticles,
+        tBlob& mRatParticles, int currentframe);
 
 /**
  * Write fading color interpolation data to file.
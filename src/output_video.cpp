@@ -114,7 +114,7 @@ void WriteVisualOutput(cv::Mat &inputimage, cCS* cs,
 		timed_t inputvideostarttime, int currentframe, cv::Size framesize,
 		cv::Size framesizeROI, double fps) {
 	cv::Mat inputimageROI;
-	tBlob::iterator it;
+	size_t j;
     cv::Point tmppoint;
     cv::Scalar color, color2;
     int dA, dB;
@@ -144,14 +144,14 @@ void WriteVisualOutput(cv::Mat &inputimage, cCS* cs,
     // OUTPUT_VIDEO_MD debug output:
     if (cs->outputvideotype & OUTPUT_VIDEO_MD) {
         // plot MDParticles to image with black ellipses
-        for (it = mMDParticles.begin(); it != mMDParticles.end(); ++it) {
-            tmppoint.x = (int) (*it).mCenter.x;
-            tmppoint.y = (int) (*it).mCenter.y;
+        for (j = 0; j < mMDParticles.size(); j++) {
+            tmppoint.x = (int) mMDParticles.cx[j];
+            tmppoint.y = (int) mMDParticles.cy[j];
             color = CV_RGB(50, 50, 50);     // DARK GREY
             cv::ellipse(inputimageROI, tmppoint, 
-                cv::Size((int) (*it).mAxisA,
-                (int) (*it).mAxisB),
-                (*it).mOrientation * 180 / M_PI, 0, 360,
+                cv::Size((int) mMDParticles.axisA[j],
+                (int) mMDParticles.axisB[j]),
+                mMDParticles.orientation[j] * 180 / M_PI, 0, 360,
                 color, 2
             );
         }
@@ -161,29 +161,29 @@ void WriteVisualOutput(cv::Mat &inputimage, cCS* cs,
         // plot RatParticles to image with gray ellipses
         dA = 0; // project fish might require 10
         dB = 0; // project fish might require 5
-        for (it = mRatParticles.begin(); it != mRatParticles.end(); ++it) {
-            tmppoint.x = (int) (*it).mCenter.x;
-            tmppoint.y = (int) (*it).mCenter.y;
+        for (j = 0; j < mRatParticles.size(); j++) {
+            tmppoint.x = (int) mRatParticles.cx[j];
+            tmppoint.y = (int) mRatParticles.cy[j];
             color = CV_RGB(150, 150, 150);  // GRAY
             cv::ellipse(inputimageROI, tmppoint,
-                    cv::Size((int)(*it).mAxisA + dA, (int)(*it).mAxisB + dB),
-                    (*it).mOrientation * 180 / M_PI, 0, 360,
+                    cv::Size((int)mRatParticles.axisA[j] + dA, (int)mRatParticles.axisB[j] + dB),
+                    mRatParticles.orientation[j] * 180 / M_PI, 0, 360,
                     color, 2);
             // draw orientation "arrow" as well
             color = CV_RGB(50, 50, 50); // DARKER GRAY
             cv::ellipse(inputimageROI, tmppoint,
-                    cv::Size((int)(*it).mAxisA + dA, (int)(*it).mAxisB + dB),
-                    (*it).mOrientation * 180 / M_PI, -30, 30,
+                    cv::Size((int)mRatParticles.axisA[j] + dA, (int)mRatParticles.axisB[j] + dB),
+                    mRatParticles.orientation[j] * 180 / M_PI, -30, 30,
                     color, 2);
         }
     }
     // OUTPUT_VIDEO_BLOB debug output:
     if (cs->outputvideotype & OUTPUT_VIDEO_BLOB) {
         // plot BlobParticles to image with GREYSCALE brush
-        for (it = mBlobParticles.begin(); it != mBlobParticles.end(); ++it) {
-            cc[0] = mColor[(*it).index].name[0];    // zero based index
-            tmppoint.x = (int) (*it).mCenter.x;
-            tmppoint.y = (int) (*it).mCenter.y;
+        for (j = 0; j < mBlobParticles.size(); j++) {
+            cc[0] = mColor[mBlobParticles.index[j]].name[0];    // zero based index
+            tmppoint.x = (int) mBlobParticles.cx[j];
+            tmppoint.y = (int) mBlobParticles.cy[j];
             color = CV_RGB(50, 50, 50);     // DARK GREY
             //cvCircle(inputimageROI,tmppoint,(int)(*it).mRadius,color,2);
             //cv::ellipse(inputimageROI,tmppoint,cv::Size((int)(*it).mAxisA,(int)(*it).mAxisB),
@@ -199,14 +199,14 @@ void WriteVisualOutput(cv::Mat &inputimage, cCS* cs,
     if (cs->outputvideotype & OUTPUT_VIDEO_BLOBCOUNT) {
         int i = 0;
         // plot BlobParticles to image with GREYSCALE brush
-        for (it = mBlobParticles.begin(); it != mBlobParticles.end(); ++it) {
+        for (j = 0; j < mBlobParticles.size(); j++) {
             i++;
-            tmppoint.x = (int)(*it).mCenter.x;
-            tmppoint.y = (int)(*it).mCenter.y;
+            tmppoint.x = (int)mBlobParticles.cx[j];
+            tmppoint.y = (int)mBlobParticles.cy[j];
             color = CV_RGB(255, 0, 0);     // RED
-            cv::circle(inputimageROI, tmppoint, (int)(*it).mRadius + 15, color, 2);
+            cv::circle(inputimageROI, tmppoint, (int)mBlobParticles.radius[j] + 15, color, 2);
             snprintf(cc, sizeof(cc), "%d", i);
-            tmppoint.x += (int)(*it).mRadius + 20;
+            tmppoint.x += (int)mBlobParticles.radius[j] + 20;
             cv::putText(inputimageROI, cc, tmppoint, cv::FONT_HERSHEY_SIMPLEX, 1, color, 2);
         }
     }
@@ -0,0 +1,140 @@
+#ifndef HEADER_PIPELINE
+#define HEADER_PIPELINE
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! A bounded blocking queue used to pass items between pipeline stages.
+// Push() blocks while the queue is full, Pop() blocks while it is empty.
+// After Close() no more items are accepted, Pop() returns the remaining
+// ones and then fails, so consumer threads can finish.
+template <class T> class cBoundedQueue {
+  public:
+    //! Constructor.
+    cBoundedQueue(size_t capacity) : mCapacity(capacity), bClosed(false) {
+    }
+    //! Destructor.
+    ~cBoundedQueue() {
+    }
+    // add item to the end of the queue, returns false if queue is closed
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!bClosed && mItems.size() >= mCapacity)
+            mNotFull.wait(lock);
+        if (bClosed)
+            return false;
+        mItems.push_back(item);
+        mNotEmpty.notify_one();
+        return true;
+    }
+    // get item from the front of the queue, returns false if
+    // queue is closed and there are no items left
+    bool Pop(T& item) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!bClosed && mItems.empty())
+            mNotEmpty.wait(lock);
+        if (mItems.empty())
+            return false;
+        item = mItems.front();
+        mItems.pop_front();
+        mNotFull.notify_one();
+        return true;
+    }
+    // do not accept more items and wake up all waiting threads
+    void Close() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        bClosed = true;
+        mNotFull.notify_all();
+        mNotEmpty.notify_all();
+    }
+  private:
+    size_t mCapacity;
+    bool bClosed;
+    std::deque<T> mItems;
+    std::mutex mMutex;
+    std::condition_variable mNotFull;
+    std::condition_variable mNotEmpty;
+};
+
+//! A set of worker threads that are started once and then run a job on
+// all of them as many times as needed (e.g. on each frame).
+// Run() calls job(arg, worker) on each worker, worker = 0..Size()-1,
+// and returns when all of them have finished.
+class cWorkerPool {
+  public:
+    typedef void (*tJob)(void* arg, int worker);
+    //! Constructor.
+    cWorkerPool() : mJob(NULL), mArg(NULL), mGeneration(0), mRunning(0),
+            bStop(false) {
+    }
+    //! Destructor.
+    ~cWorkerPool() {
+        Stop();
+    }
+    // number of worker threads
+    int Size() const {
+        return (int) mThreads.size();
+    }
+    // start n worker threads (the previous ones are stopped)
+    void Start(int n) {
+        Stop();
+        bStop = false;
+        for (int i = 0; i < n; i++)
+            mThreads.push_back(std::thread(&cWorkerPool::Work, this, i, mGeneration));
+    }
+    // run job on all workers and wait for them to finish
+    void Run(tJob job, void* arg) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJob = job;
+        mArg = arg;
+        mRunning = (int) mThreads.size();
+        mGeneration++;
+        mStart.notify_all();
+        while (mRunning)
+            mDone.wait(lock);
+    }
+    // stop and join all worker threads
+    void Stop() {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            bStop = true;
+            mStart.notify_all();
+        }
+        for (size_t i = 0; i < mThreads.size(); i++)
+            mThreads[i].join();
+        mThreads.clear();
+    }
+  private:
+    // thread function: wait for the next job (generation), run it, repeat
+    void Work(int worker, unsigned int generation) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (;;) {
+            while (!bStop && mGeneration == generation)
+                mStart.wait(lock);
+            if (bStop)
+                return;
+            generation = mGeneration;
+            tJob job = mJob;
+            void* arg = mArg;
+            lock.unlock();
+            job(arg, worker);
+            lock.lock();
+            if (--mRunning == 0)
+                mDone.notify_all();
+        }
+    }
+    std::vector<std::thread> mThreads;
+    tJob mJob;                  // job of the current run
+    void* mArg;                 // argument of the current job
+    unsigned int mGeneration;   // number of runs so far
+    int mRunning;               // workers not finished with the current run
+    bool bStop;
+    std::mutex mMutex;
+    std::condition_variable mStart;
+    std::condition_variable mDone;
+};
+
+#endif
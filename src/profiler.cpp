@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "profiler.h"
+#include "textwriter.h"
+
+cProfiler profiler;
+
+// names of the stages in the report
+static const char* stagenames[STAGE_COUNT] = {
+    "decode", "blur", "led", "classify", "tiles", "detectrats", "ratregions", "tracking", "findhsvblobs",
+    "findhsvblobs_c0", "findhsvblobs_c1", "findhsvblobs_c2",
+    "findhsvblobs_c3", "findhsvblobs_c4", "findhsvblobs_c5",
+    "filtermotion", "findmdblobs", "processframe",
+    "writeblobfile", "writevisualoutput", "generateoutput"
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// index of the histogram bucket of a duration
+static inline int BucketIndex(unsigned long long ns) {
+    int e = 0;
+    if (ns < (1 << PROFILERSUBBUCKETBITS))
+        return (int)ns;
+    // e = floor(log2(ns))
+    while ((ns >> e) > 1)
+        e++;
+    return ((e - PROFILERSUBBUCKETBITS + 1) << PROFILERSUBBUCKETBITS) +
+            (int)((ns >> (e - PROFILERSUBBUCKETBITS)) - (1 << PROFILERSUBBUCKETBITS));
+}
+
+// middle of the range of durations in a histogram bucket
+static inline double BucketValue(int index) {
+    int e, sub;
+    if (index < (1 << PROFILERSUBBUCKETBITS))
+        return index;
+    e = (index >> PROFILERSUBBUCKETBITS) + PROFILERSUBBUCKETBITS - 1;
+    sub = index & ((1 << PROFILERSUBBUCKETBITS) - 1);
+    return ldexp((1 << PROFILERSUBBUCKETBITS) + sub + 0.5, e - PROFILERSUBBUCKETBITS);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cStageStats::Add(unsigned long long ns) {
+    count++;
+    sum += ns;
+    if (ns > max)
+        max = ns;
+    histogram[BucketIndex(ns)]++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double cStageStats::Percentile(double p) const {
+    unsigned long long rank, n = 0;
+    size_t i;
+    if (!count)
+        return 0;
+    rank = (unsigned long long)ceil(p / 100 * count);
+    if (rank < 1)
+        rank = 1;
+    for (i = 0; i < histogram.size(); i++) {
+        n += histogram[i];
+        if (n >= rank)
+            break;
+    }
+
+    return std::min(BucketValue((int)i), (double)max);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+cProfiler::cProfiler() : start(std::chrono::steady_clock::now()) {
+    for (int i = 0; i < STAGE_COUNT; i++)
+        stages[i].name = stagenames[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cProfiler::Reset() {
+    for (int i = 0; i < STAGE_COUNT; i++)
+        stages[i].Reset();
+    info.clear();
+    start = std::chrono::steady_clock::now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cProfiler::AddInfo(const char* key, const std::string& value) {
+    std::string s("\"");
+    size_t i;
+    // escape as JSON string
+    for (i = 0; i < value.size(); i++) {
+        char c = value[i];
+        if (c == '"' || c == '\\') {
+            s += '\\';
+            s += c;
+        } else if ((unsigned char)c < 0x20) {
+            char cc[8];
+            snprintf(cc, sizeof(cc), "\\u%04x", (int)c);
+            s += cc;
+        } else {
+            s += c;
+        }
+    }
+    s += '"';
+    info.push_back(std::make_pair(std::string(key), s));
+}
+
+void cProfiler::AddInfo(const char* key, double value) {
+    cTextWriter s;
+    s << value;
+    info.push_back(std::make_pair(std::string(key), s.str()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cProfiler::Print() {
+    char cc[128];
+    std::cout << "Stage durations [ms]:" << std::endl;
+    snprintf(cc, sizeof(cc), "  %-20s %10s %9s %9s %9s %9s %9s",
+            "stage", "count", "mean", "p50", "p95", "p99", "max");
+    std::cout << cc << std::endl;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        cStageStats& s = stages[i];
+        if (!s.count)
+            continue;
+        snprintf(cc, sizeof(cc), "  %-20s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f",
+                s.name.c_str(), s.count, s.sum / 1e6 / s.count,
+                s.Percentile(50) / 1e6, s.Percentile(95) / 1e6,
+                s.Percentile(99) / 1e6, s.max / 1e6);
+        std::cout << cc << std::endl;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cProfiler::WriteReport(const char* filename) {
+    cTextWriter ofs;
+    size_t i;
+    bool bFirst = true;
+
+    if (!ofs.Open(filename))
+        return false;
+    ofs << "{\n";
+    for (i = 0; i < info.size(); i++) {
+        ofs << "  \"" << info[i].first << "\": " << info[i].second << ",\n";
+    }
+    ofs << "  \"walltime_s\": " << std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count() << ",\n";
+    ofs << "  \"stages\": {";
+    for (int j = 0; j < STAGE_COUNT; j++) {
+        cStageStats& s = stages[j];
+        if (!s.count)
+            continue;
+        ofs << (bFirst ? "\n" : ",\n") << "    \"" << s.name << "\": {" <<
+                "\"count\": " << (long long)s.count <<
+                ", \"total_ms\": " << s.sum / 1e6 <<
+                ", \"mean_us\": " << s.sum / 1e3 / s.count <<
+                ", \"p50_us\": " << s.Percentile(50) / 1e3 <<
+                ", \"p95_us\": " << s.Percentile(95) / 1e3 <<
+                ", \"p99_us\": " << s.Percentile(99) / 1e3 <<
+                ", \"max_us\": " << s.max / 1e3 << "}";
+        bFirst = false;
+    }
+    ofs << "\n  }\n}\n";
+
+    return ofs.Close();
+}
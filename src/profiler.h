@@ -0,0 +1,113 @@
+#ifndef HEADER_PROFILER
+#define HEADER_PROFILER
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "constants.h"
+
+// stages of frame processing measured by the profiler
+typedef enum {
+    STAGE_DECODE = 0,           // reading the next frame from the video
+    STAGE_BLUR,                 // Gauss smoothing of the input image
+    STAGE_LED,                  // day/night LED detection
+    STAGE_CLASSIFY,             // HSV conversion and color classification
+    STAGE_TILES,                // band by band steps of tiled detection
+    STAGE_DETECTRATS,           // rat detection
+    STAGE_RATREGIONS,           // regions around rats for blob detection
+    STAGE_TRACKING,             // search windows of tracking mode
+    STAGE_FINDHSVBLOBS,         // blob detection of all colors
+    STAGE_FINDHSVBLOBS_COLOR,   // blob detection of a single color (MAXMBASE stages)
+    STAGE_FILTERMOTION = STAGE_FINDHSVBLOBS_COLOR + MAXMBASE, // motion detection filter
+    STAGE_FINDMDBLOBS,          // motion blob detection
+    STAGE_PROCESSFRAME,         // all detection on a frame
+    STAGE_WRITEBLOBFILE,        // .blobs output
+    STAGE_WRITEVISUALOUTPUT,    // output video, screenshots
+    STAGE_GENERATEOUTPUT,       // all output of a frame
+    STAGE_COUNT
+} stage_t;
+
+// number of linear sub-buckets in each power of two of the histograms
+#define PROFILERSUBBUCKETBITS 4
+// number of histogram buckets (enough for any 64 bit nanosecond value)
+#define PROFILERBUCKETS ((64 - PROFILERSUBBUCKETBITS + 1) << PROFILERSUBBUCKETBITS)
+
+// Duration statistics of a single stage. Durations are collected in a
+// log-linear histogram (16 buckets in each power of two, so percentiles
+// are accurate within 1/32 relative error) besides exact count, sum and max.
+class cStageStats {
+  public:
+    std::string name;
+    unsigned long long count;
+    unsigned long long sum;     // [ns]
+    unsigned long long max;     // [ns]
+    std::vector<unsigned long long> histogram;
+    //! Constructor.
+    cStageStats() : count(0), sum(0), max(0), histogram(PROFILERBUCKETS, 0) {
+    }
+    // clear all durations (name is kept)
+    void Reset() {
+        count = sum = max = 0;
+        std::fill(histogram.begin(), histogram.end(), 0);
+    }
+    // add a duration [ns]
+    void Add(unsigned long long ns);
+    // approximate percentile (0..100) of durations [ns]
+    double Percentile(double p) const;
+};
+
+// Stage profiler using a monotonic clock. Each stage must be measured by
+// only one thread at a time (different stages can be measured in parallel).
+class cProfiler {
+  public:
+    cStageStats stages[STAGE_COUNT];
+    //! Constructor.
+    cProfiler();
+    //! Destructor.
+    ~cProfiler() {
+    }
+    void Add(int stage, std::chrono::steady_clock::duration d) {
+        stages[stage].Add((unsigned long long)
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+    // clear all stages and info, restart wall time
+    void Reset();
+    // add general info to the report, value is a string or a number
+    void AddInfo(const char* key, const std::string& value);
+    void AddInfo(const char* key, double value);
+    // print a summary table of all stages measured
+    void Print();
+    // write report of all stages measured in JSON format
+    bool WriteReport(const char* filename);
+
+  private:
+    std::chrono::steady_clock::time_point start;
+    std::vector<std::pair<std::string, std::string> > info; // key, JSON value
+};
+
+// the profiler of this process
+extern cProfiler profiler;
+
+// Measures the time from its construction to its destruction as a stage.
+class cStageTimer {
+  public:
+    //! Constructor.
+    cStageTimer(int stage) : stage(stage), start(std::chrono::steady_clock::now()) {
+    }
+    //! Destructor.
+    ~cStageTimer() {
+        profiler.Add(stage, std::chrono::steady_clock::now() - start);
+    }
+
+  private:
+    int stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+// measure duration of a statement as a stage of the profiler
+#define MEASURE_DURATION(STAGE, STATEMENT) \
+    { cStageTimer stagetimer(STAGE); STATEMENT; }
+
+#endif
@@ -6,12 +6,14 @@
 #include "barcode.h"
 #include "blob.h"
 #include "cage.h"
+#include "compare.h"
 #include "cvutils.h"
 #include "datetime.h"
 #include "input.h"
 #include "log.h"
 #include "output_text.h"
 #include "output_video.h"
+#include "pipeline.h"
 #include "ratognize.h"
 #include "version.h"
 
@@ -23,6 +25,20 @@
 int main(int argc, char *argv[]) {
     int i;
 
+    // convert blob file between text and binary format if requested
+    if (argc == 4 && strcmp(argv[1], "--convertblobs") == 0) {
+        return ConvertBlobFile(argv[2], argv[3]) ? 0 : -1;
+    }
+    // compare output with golden output if requested (e.g. after optimization)
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--compareblobs") == 0) {
+        return CompareBlobFiles(argv[2], argv[3], argc == 5 ? atof(argv[4]) :
+                COMPARETOLERANCE, COMPAREANGLETOLERANCE) ? 0 : -1;
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--comparelogs") == 0) {
+        return CompareLogFiles(argv[2], argv[3], argc == 5 ? atof(argv[4]) :
+                COMPARETOLERANCE) ? 0 : -1;
+    }
+
     // Do all the initialization here
     i = OnInit(argc, argv);
     if (i != 0) {
@@ -30,44 +46,76 @@ int main(int argc, char *argv[]) {
         return -1 * abs(i);
     }
 
-    // variables for time measurement
-    clock_t clock_start = clock(), clock_now;
-    double d = 0;
+    // process a list of videos with the same settings in batch mode
+    if (cs.filelist[0]) {
+        i = RunBatch(&cs, ProcessVideo);
+        OnExit(false);
+        return i ? -19 : 0;
+    }
+
+    // or process the single input video
+    return ProcessVideo(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// process cs.inputvideofile from start to end
+int ProcessVideo(int* nframes) {
+    int i, firstframe;
+
+    // initialize everything related to the actual video
+    i = OnInitVideo();
+    if (i != 0) {
+        OnExit(i > 0);
+        return -1 * abs(i);
+    }
+
+    // in chunk mode all frames are processed by the worker processes
+    if (chunkindex == CHUNK_PARENT) {
+        OnExit(false);
+        return 0;
+    }
 
     // log the first frame
+    firstframe = frame.currentframe;
     if (cs.bWriteText) {
-        ofslog << currentframe << "\tFIRSTFRAME" << std::endl;
+        ofslog << firstframe << "\tFIRSTFRAME\n";
     }
 
-    // loop through all frames
-    while (!inputimage.empty() && (cs.lastframe < 1 || (cs.lastframe >= 1
-                            && currentframe <= cs.lastframe))) {
-        // do blob detection and all stuff
-        if (!OnStep()) {
+    // process all frames on separate decode/detection/output threads
+    if (cs.pipelinequeue) {
+        if (!RunPipeline()) {
             OnExit();
             return -16;
         }
-        // calculate framerate, elapsed and remaining time
-        clock_now = clock();
-        if ((double) (clock_now - clock_start) / CLOCKS_PER_SEC - d >= 1) {
-            d = (double) (clock_now - clock_start) / CLOCKS_PER_SEC;
-            std::cout << "frame: " << currentframe
-                    << ", FPS: " << (double) (currentframe - cs.firstframe) / d
-                    << ", elapsed: " << (int) d
-                    << "s, remains: " << (int) ((double) d * ((cs.lastframe <
-                                    1 ? framecount : cs.lastframe) -
-                            currentframe) / (currentframe - cs.firstframe))
-                    << "s" << std::endl;
-        }
-        // read next frame from video
-        if (!ReadNextFrame()) {
-            break;
+    // or loop through all frames serially
+    } else {
+        while (!frame.inputimage.empty() && (cs.lastframe < 1 ||
+                (cs.lastframe >= 1 && frame.currentframe <= cs.lastframe))) {
+            // do blob detection and all stuff
+            if (!OnStep()) {
+                OnExit();
+                return -16;
+            }
+            // calculate framerate, elapsed and remaining time
+            PrintProgress(frame.currentframe);
+            // read next frame from video
+            if (!ReadNextFrame(&frame)) {
+                break;
+            }
         }
     }
 
     // log the last frame
     if (cs.bWriteText) {
-        ofslog << currentframe - 1 << "\tLASTFRAME" << std::endl;
+        ofslog << currentframe - 1 << "\tLASTFRAME\n";
+    }
+    if (nframes) {
+        // frames firstframe..currentframe-1 were processed
+        *nframes = currentframe - firstframe;
+    }
+    // report stage durations
+    if (cs.bProfile) {
+        WriteProfile();
     }
 
     if (cs.bCout)
@@ -75,15 +123,61 @@ int main(int argc, char *argv[]) {
 
     // release memory
     OnExit();
+
+    return 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-int OnInit(int argc, char *argv[]) {
-    // some variables
-    int i;
-    char cc[16];
-    bool tempDSLP = false;
+// write stage durations to a JSON report, to be compared between versions
+void WriteProfile() {
+    std::ostringstream reportfile;
+    reportfile << cs.outputdirectory << cs.outputfilecommon << ".profile";
+    if (chunkindex >= 0)
+        reportfile << CHUNKTAG << chunkindex;
+    reportfile << ".json";
+
+    profiler.AddInfo("version", RATOGNIZE_DETAILED_VERSION_STRING);
+    profiler.AddInfo("opencv", CV_VERSION);
+    profiler.AddInfo("video", cs.inputvideofile);
+    profiler.AddInfo("firstframe", cs.firstframe);
+    profiler.AddInfo("lastframe", currentframe - 1);
+    profiler.AddInfo("width", framesizeROI.width);
+    profiler.AddInfo("height", framesizeROI.height);
+    profiler.AddInfo("colorthreads", cs.colorthreads);
+    profiler.AddInfo("pipelinequeue", cs.pipelinequeue);
+    profiler.AddInfo("blobextraction", cs.blobextraction);
+    profiler.AddInfo("gausssmoothing", cs.gausssmoothing);
+    if (cs.bCout)
+        profiler.Print();
+    if (!profiler.WriteReport(reportfile.str().c_str())) {
+        std::cout << "  Warning: could not write profile report " <<
+                reportfile.str() << std::endl;
+    }
+}
 
+////////////////////////////////////////////////////////////////////////////////
+// calculate and print framerate, elapsed and remaining time once in a second
+void PrintProgress(int framenum) {
+    static const std::chrono::steady_clock::time_point clock_start =
+            std::chrono::steady_clock::now();
+    static double d = 0;
+    double elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - clock_start).count();
+
+    if (elapsed - d >= 1) {
+        d = elapsed;
+        std::cout << "frame: " << framenum
+                << ", FPS: " << (double) (framenum - cs.firstframe) / d
+                << ", elapsed: " << (int) d
+                << "s, remains: " << (int) ((double) d * ((cs.lastframe <
+                                1 ? framecount : cs.lastframe) -
+                        framenum) / (framenum - cs.firstframe))
+                << "s" << std::endl;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int OnInit(int argc, char *argv[]) {
 #ifdef ON_LINUX
     std::cout << "libavcodec version: " << LIBAVCODEC_IDENT << std::endl;
 #endif
@@ -108,10 +202,22 @@ int OnInit(int argc, char *argv[]) {
                     && i < argc - 1) {
                 cs.dayssincelastpaint = atoi(argv[++i]);
                 tempDSLP = true;
-            } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            } else if (strcmp(argv[i], "--filelist") == 0 && i < argc - 1)
+                strncpy(cs.filelist, argv[++i], MAXPATH);
+            else if (strcmp(argv[i], "--batchjobs") == 0 && i < argc - 1)
+                cs.batchjobs = std::max(atoi(argv[++i]), 1);
+            else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
                 std::cout << "Usage: ratognize --param1 [filename] --param2 [filename] ..., " << std::endl <<
                         "       where paramN can be 'inifile', 'inputvideofile', 'dayssincelastpaint'" << std::endl <<
-                        "       All settings override default and .ini file values." << std::endl;
+                        "       All settings override default and .ini file values." << std::endl <<
+                        "   or: ratognize --filelist [file or directory] --batchjobs [N] --param1 ..." << std::endl <<
+                        "       to process all videos listed in a file (one in each line) or found" << std::endl <<
+                        "       in a directory with the same settings, N videos at a time." << std::endl <<
+                        "   or: ratognize --convertblobs [infile] [outfile]" << std::endl <<
+                        "       to convert a .blobs file from text to binary format or back." << std::endl <<
+                        "   or: ratognize --compareblobs|--comparelogs [file] [goldenfile] [tolerance]" << std::endl <<
+                        "       to check output against reference output (numbers within tolerance," << std::endl <<
+                        "       default is " << COMPARETOLERANCE << " pixel and " << COMPAREANGLETOLERANCE << " deg for .blobs)." << std::endl;
                 return 1;
             } else {
                 std::cout << "Unknown option in parameter " << i <<
@@ -147,10 +253,6 @@ int OnInit(int argc, char *argv[]) {
     }
 
     std::ostringstream outfile;
-    // define common output file name part (without path)
-    outfile.str(cs.inputvideofile);
-    i = (int) outfile.str().find_last_of("\\/");
-    strncpy(cs.outputfilecommon, outfile.str().substr(i + 1).c_str(), MAXPATH);
     // correct output directory
     outfile.str(cs.outputdirectory);
     if (*(outfile.str().rbegin()) != '\\' && *(outfile.str().rbegin()) != '/')  // check last char of string
@@ -163,13 +265,25 @@ int OnInit(int argc, char *argv[]) {
         cs.outputdirectory[outfile.str().length() + 1] = 0;
     }
     // and create it if needed
-    outfile.str("");
-#ifdef ON_LINUX
-    outfile << "mkdir -p " << cs.outputdirectory;
-#else
-    outfile << "mkdir " << cs.outputdirectory;
-#endif
-    system(outfile.str().c_str());      // TODO: does it work on linux??? \,/ characters, etc.
+    if (!MakeDirectory(cs.outputdirectory)) {
+        LOG_ERROR("Could not create output directory '%s'.", cs.outputdirectory);
+        return 20;
+    }
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int OnInitVideo() {
+    // some variables
+    int i;
+    char cc[16];
+    std::ostringstream outfile;
+
+    // define common output file name part (without path)
+    outfile.str(cs.inputvideofile);
+    i = (int) outfile.str().find_last_of("\\/");
+    strncpy(cs.outputfilecommon, outfile.str().substr(i + 1).c_str(), MAXPATH);
 
     // define input/output file names
     std::cout << "Using input video file: " << cs.inputvideofile << std::endl;
@@ -181,13 +295,15 @@ int OnInit(int argc, char *argv[]) {
     std::cout << "Using output video file: " << cs.outputvideofile << std::endl;
 
     outfile.str("");
-    outfile << cs.outputdirectory << cs.outputfilecommon << ".blobs";
+    outfile << cs.outputdirectory << cs.outputfilecommon << ".blobs" <<
+            (cs.blobfileformat == BLOBFILE_BINARY ? BINARYBLOBTAG : "");
     strncpy(cs.inputdatfile, outfile.str().c_str(), MAXPATH);     // {} style data
     std::cout << "Using input blob file: " << cs.inputdatfile << std::endl;
 
     outfile.str("");
     outfile << cs.outputdirectory << cs.outputfilecommon << (cs.
-            bProcessText ? BARCODETAG ".blobs" : ".blobs");
+            bProcessText ? BARCODETAG ".blobs" : ".blobs") <<
+            (cs.blobfileformat == BLOBFILE_BINARY ? BINARYBLOBTAG : "");
     strncpy(cs.outputdatfile, outfile.str().c_str(), MAXPATH);    // {} style data
     std::cout << "Using output blob file: " << cs.outputdatfile << std::endl;
 
@@ -239,15 +355,51 @@ int OnInit(int argc, char *argv[]) {
         mLight = NIGHTLIGHT;
         if (!SetHSVDetectionParams(mLight, cs.colorselectionmethod,
                 cs.dayssincelastpaint, inputvideostarttime,
-                mColorDataBase, mColor, &mBGColor)) {
+                mColorDataBase, mColor, &mBGColor, &mHSVLookup)) {
             return 8;
         }
     }
+    // initialize color lookup table (updated on all color changes later on)
+    BuildHSVLookup(&mHSVLookup, mColor, &mBGColor);
+    // name blob detection stages by color in the profile report
+    for (i = 0; i < MAXMBASE; i++) {
+        if (mColor[i].mUse) {
+            profiler.stages[STAGE_FINDHSVBLOBS_COLOR + i].name =
+                    std::string("findhsvblobs_") + mColor[i].name;
+        }
+    }
     // capture video input
     std::cout << "Opening video file..." << std::endl;
     if (!initializeVideo(cs.inputvideofile)) {
         return 9;
     }
+    // split frame range between worker processes if requested
+    if (cs.chunks > 1) {
+        // chunk workers would return into the batch worker of the video
+        if (cs.filelist[0]) {
+            std::cout << "  Warning: chunk mode is not available in batch mode, using a single process per video." << std::endl;
+        } else if (cs.bProcessText || !cs.bWriteText || cs.bWriteVideo == 1 ||
+                cs.bShowVideo || cs.bShowDebugVideo) {
+            std::cout << "  Warning: chunk mode needs bWriteText=1 and no video display or output, using a single process." << std::endl;
+        } else {
+            // the frame index is shared by all workers, create it only once
+            if (cs.bVideoIndex) {
+                cVideoIndex videoindex;
+                loadVideoIndex(videoindex);
+            }
+            // decoder state must not be shared with the workers
+            inputvideo.release();
+            chunkindex = RunChunks(&cs, bFramecountUnknown ? 0 : framecount);
+            if (chunkindex == CHUNK_ERROR) {
+                return -18;
+            } else if (chunkindex == CHUNK_PARENT) {
+                return 0;
+            }
+            if (!initializeVideo(cs.inputvideofile)) {
+                return 9;
+            }
+        }
+    }
     // decrease image size if there is a ROI defined
     // TODO: how should ROI appear in the output coordinates??? What should be the origin?
     if (cs.imageROI.height && cs.imageROI.width) {
@@ -267,10 +419,13 @@ int OnInit(int argc, char *argv[]) {
     } else
         framesizeROI = framesize;
 
+    // tiled detection is not used when debug images are shown
+    bTiledDetection = cs.tilerows > 0 && cs.bProcessImage && !cs.bShowDebugVideo;
     // initialize global images
-    smoothinputimage = cv::Mat(framesizeROI, CV_8UC3);    // smooth input image on ROI
-    maskimage = cv::Mat(framesizeROI, CV_8UC1);   // binary mask containing rat blobs
-    HSVimage = cv::Mat(framesizeROI, CV_8UC3);    // HSV image on ROI - almost all image processing is done on this image
+    frame.smoothinputimage = cv::Mat(framesizeROI, CV_8UC3);    // smooth input image on ROI
+    workspace.Create(framesizeROI);     // all scratch images of blob detection
+    workspace.ReserveBlobs(cs.mRats * 20);
+    frame.ReserveBlobs(cs.mRats * 20 * MAXMBASE, cs.mRats * 2);
 
     // get first good frame from video
     if (!readVideoUntilFirstGoodFrame()) {
@@ -278,7 +433,8 @@ int OnInit(int argc, char *argv[]) {
     }
     // create initial moving average image
     if (cs.bMotionDetection) {
-        smoothinputimage.convertTo(movingAverage, CV_32FC3);
+        cv::Mat inputimageROI = GetInputImageROI(&frame);
+        InitMotionDetection(&frame, inputimageROI, &cs, &workspace);
     }
     // debug options
     if (cs.bShowVideo) {
@@ -289,6 +445,11 @@ int OnInit(int argc, char *argv[]) {
     }
 
     if (cs.bShowDebugVideo) {
+        // debug windows can only be used from the main thread
+        if (cs.pipelinequeue) {
+            std::cout << "  Warning: pipelined processing is turned off as debug video is shown." << std::endl;
+            cs.pipelinequeue = 0;
+        }
         // colors
         for (i = 0; i < MAXMBASE; i++) {
             if (!mColor[i].mUse)
@@ -324,23 +485,38 @@ int OnInit(int argc, char *argv[]) {
 
     // init input files
     if (cs.bProcessText) {
-        if (!OpenInputFileStream(ifsbarcode, cs.inputbarcodefile)) {
+        if (!ifsbarcode.Open(cs.inputbarcodefile)) {
             LOG_ERROR("Could not open input barcode file.");
             return -13;
         }
-        if (!OpenInputFileStream(ifsdat, cs.inputdatfile)) {
+        if (cs.blobfileformat == BLOBFILE_BINARY) {
+            if (!binifsdat.Open(cs.inputdatfile)) {
+                LOG_ERROR("Could not open input blob file.");
+                return -14;
+            }
+        } else if (!ifsdat.Open(cs.inputdatfile)) {
             LOG_ERROR("Could not open input blob file.");
             return -14;
         }
-        if (!OpenInputFileStream(ifslog, cs.inputlogfile)) {
+        if (!ifslog.Open(cs.inputlogfile)) {
             LOG_ERROR("Could not open input log file.");
             return -15;
         }
     } 
     // init output files
     else {
-        WriteBlobFileHeader(&cs, ofsdat);
-        WriteLogFileHeader(&cs, args, ofslog);
+        if (cs.blobfileformat == BLOBFILE_BINARY) {
+            if (cs.bWriteText && !binofsdat.Open(cs.outputdatfile,
+                    (cs.bMotionDetection ? BLOBFILE_MD : 0) |
+                    (cs.bBlobE ? BLOBFILE_BLOBE : 0))) {
+                return -17;
+            }
+        } else if (!WriteBlobFileHeader(&cs, ofsdat)) {
+            return -17;
+        }
+        if (!WriteLogFileHeader(&cs, args, ofslog)) {
+            return -20;
+        }
     }
 
     return 0;
@@ -350,14 +526,14 @@ int OnInit(int argc, char *argv[]) {
 void OnExit(bool bReleaseVars) {
     if (bReleaseVars) {
         // flush and close files, pipes
-        ifsbarcode.close();
-        ifsdat.close();
-        ifslog.close();
+        ifsbarcode.Close();
+        ifsdat.Close();
+        binifsdat.Close();
+        ifslog.Close();
         if (cs.bWriteText) {
-            ofslog.flush();
-            ofslog.close();
-            ofsdat.flush();
-            ofsdat.close();
+            ofslog.Close();
+            ofsdat.Close();
+            binofsdat.Close();
         }
         std::cout.flush();
         std::cerr.flush();
@@ -375,134 +551,216 @@ void OnExit(bool bReleaseVars) {
 
 ////////////////////////////////////////////////////////////////////////////////
 bool OnStep() {
-    int i;
+    // do all image and text processing
+    {
+        cStageTimer stagetimer(STAGE_PROCESSFRAME);
+        if (!ProcessFrame(&frame, ofslog)) {
+            return false;
+        }
+    }
 
-    // clear particle vectors
-    mBlobParticles.clear();
-    mMDParticles.clear();
-    mRatParticles.clear();
-    mBarcodes.clear();
+    // save and show output
+    {
+        cStageTimer stagetimer(STAGE_GENERATEOUTPUT);
+        if (!GenerateOutput(&frame)) {
+            return false;
+        }
+    }
 
-    // run main image processing
-    if (cs.bProcessImage) {
+    return true;
+}
 
-        // create images (when it is not initialized or when size changed)
-        static cv::Mat filterimage;
-        filterimage = cvCreateImageOnce(filterimage, HSVimage.size(), 8, 1, false); // no need to zero
-
-        // detect day/night light from RED LED
-        // LED detection is always on on first 50 frames, frame skipping starts only after that
-        if (cs.bLED && (currentframe < 50 ||
-                (currentframe % cs.LEDdetectionskipfactor) == 0)) {
-            // LED detection is on the ORIGINAL frame, not using ROI
-            if (!ReadDayNightLED(HSVimage, inputimage, ofslog,
-                    &cs, mColorDataBase, mColor, &mBGColor, &mLight,
-                    inputvideostarttime, currentframe)) {
-                return false;
-            }
+////////////////////////////////////////////////////////////////////////////////
+// decode stage of the pipeline: read frames until the end of the video
+static void DecodeThread(cBoundedQueue<cFrame*>* freeframes,
+        cBoundedQueue<cFrame*>* decodedframes) {
+    cFrame* f = &frame;
+
+    // the first frame has already been read by OnInit()
+    while (!f->inputimage.empty() && (cs.lastframe < 1 ||
+            (cs.lastframe >= 1 && f->currentframe <= cs.lastframe))) {
+        if (!decodedframes->Push(f)) {
+            break;
         }
+        // get an unused frame and read next image into it
+        if (!freeframes->Pop(f) || !ReadNextFrame(f)) {
+            break;
+        }
+    }
+    decodedframes->Close();
+}
 
-        // try to detect rats as a whole (and store in global maskimage + as blobs)
-        MEASURE_DURATION(DetectRats(HSVimage, maskimage, &mBGColor, &cs,
-                mRatParticles, currentframe, ofslog));
-
-        //for (int iii=0;iii<5;iii++) {
-        //      std::cout << mColor[iii].name << " ";
-        //      for (int jjj=0;jjj<3;jjj++)
-        //              std::cout << mColor[iii].mColor.mColorHSV.val[jjj] << " ";
-        //      for (int jjj=0;jjj<3;jjj++)
-        //              std::cout << mColor[iii].mColor.mRangeHSV.val[jjj] << " ";
-        //      std::cout << std::endl;
-        //}
-
-        // mask HSVimage with maskimage for main blob detection
-        // Note: no mask can be used on sub-calls, so no speed-up is possible
-        cv::Mat maskedHSVimage(HSVimage.size(), CV_8UC3);
-        HSVimage.copyTo(maskedHSVimage, maskimage);
-        // Detect the blobs of all the used colors
-        for (i = 0; i < cs.mBase; i++)
-            if (mColor[i].mUse) {
-                mColor[i].mNumBlobsFound = 0;
-                MEASURE_DURATION(FindHSVBlobs(maskedHSVimage, i, filterimage,
-                        mColor, &cs, mBlobParticles, currentframe, ofslog));
-            }
-        //cvReleaseImage(&maskedHSVimage);
+// detection stage of the pipeline: process frames in order
+static void DetectionThread(cBoundedQueue<cFrame*>* freeframes,
+        cBoundedQueue<cFrame*>* decodedframes,
+        cBoundedQueue<cFrame*>* processedframes, bool* bError) {
+    cFrame* f;
+
+    while (decodedframes->Pop(f)) {
+        cStageTimer stagetimer(STAGE_PROCESSFRAME);
+        if (!ProcessFrame(f, f->log)) {
+            // stop decoding as well
+            *bError = true;
+            decodedframes->Close();
+            freeframes->Close();
+            break;
+        }
+        processedframes->Push(f);
+    }
+    processedframes->Close();
+}
 
-        // motion detection filter and MD blobfinder
-        if (cs.bMotionDetection) {
-            MEASURE_DURATION(FilterMotion(smoothinputimage, movingAverage,
-                    filterimage, cs.mdAlpha, cs.mdThreshold));
-            if (cs.bShowDebugVideo) {
-                cv::imshow("MD", filterimage);
+////////////////////////////////////////////////////////////////////////////////
+// decode and detection runs on separate threads, output is generated here
+bool RunPipeline() {
+    int i, n = 2 * cs.pipelinequeue + 3; // all queues full and one frame in each stage
+    std::vector<cFrame> frames(n - 1);  // + the global frame read by OnInit()
+    cBoundedQueue<cFrame*> freeframes(n);
+    cBoundedQueue<cFrame*> decodedframes(cs.pipelinequeue);
+    cBoundedQueue<cFrame*> processedframes(cs.pipelinequeue);
+    bool bError = false;        // set by the detection thread
+    bool bOutputError = false;
+    cFrame* f;
+
+    for (i = 0; i < n - 1; i++) {
+        frames[i].ReserveBlobs(cs.mRats * 20 * MAXMBASE, cs.mRats * 2);
+        freeframes.Push(&frames[i]);
+    }
+    std::thread decodethread(DecodeThread, &freeframes, &decodedframes);
+    std::thread detectionthread(DetectionThread, &freeframes, &decodedframes,
+            &processedframes, &bError);
+
+    // write log of the frame and generate all output in frame order
+    while (processedframes.Pop(f)) {
+        ofslog << f->log;
+        f->log.clear();
+        {
+            cStageTimer stagetimer(STAGE_GENERATEOUTPUT);
+            if (!GenerateOutput(f)) {
+                // stop decoding and detection as well
+                bOutputError = true;
+                processedframes.Close();
+                decodedframes.Close();
+                break;
             }
-            MEASURE_DURATION(FindMDorRatBlobs(filterimage, &cs, mMDParticles,
-                    currentframe, ofslog));
         }
-        // Release temporary images
-        //cvReleaseImage(&filterimage);
+        PrintProgress(f->currentframe);
+        freeframes.Push(f);
+    }
+    freeframes.Close();
+
+    detectionthread.join();
+    decodethread.join();
+
+    return !bError && !bOutputError;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ProcessFrame(cFrame* f, cTextWriter& framelog) {
+    int i;
+
+    // clear particle vectors
+    f->mBlobParticles.clear();
+    f->mMDParticles.clear();
+    f->mRatParticles.clear();
+    f->mBarcodes.clear();
+
+    // run main image processing
+    if (cs.bProcessImage) {
+        cv::Mat inputimageROI = GetInputImageROI(f);
+        if (!DetectFrame(f, inputimageROI, framelog, &cs, mColorDataBase,
+                mColor, &mBGColor, &mHSVLookup, &workspace, &mLight,
+                inputvideostarttime)) {
+            return false;
+        }
     }
 
     // load previuosly/externally saved data created by trajognize
     if (cs.bProcessText) {
         // read barcodes from trajognize output
-        if (!ReadNextBarcodesFromFile(ifsbarcode, mBarcodes, &cs, currentframe)) {
+        if (!ReadNextBarcodesFromFile(ifsbarcode, f->mBarcodes, &cs, f->currentframe)) {
             return false;
         }
         // read blobs from previous ratognize output
-        if (!ReadNextBlobsFromFile(ifsdat, mBlobParticles, mMDParticles,
-                mRatParticles, &cs, currentframe)) {
+        if (cs.blobfileformat == BLOBFILE_BINARY) {
+            if (!ReadNextBlobsFromBinaryFile(binifsdat, workspace.blobframe,
+                    f->mBlobParticles, f->mMDParticles, f->mRatParticles, &cs,
+                    f->currentframe)) {
+                return false;
+            }
+        } else if (!ReadNextBlobsFromFile(ifsdat, f->mBlobParticles,
+                f->mMDParticles, f->mRatParticles, &cs, f->currentframe)) {
             return false;
         }
         // read log from previous ratognize output (parsing LED lines only)
-        i = ReadNextLightFromLogFile(ifslog, &mLight, currentframe);
+        i = ReadNextLightFromLogFile(ifslog, &mLight, f->currentframe);
         if (i < 0) {
             return false;
         } else if (i > 0) {
             if (!SetHSVDetectionParams(mLight, cs.colorselectionmethod,
                     cs.dayssincelastpaint, inputvideostarttime,
-                    mColorDataBase, mColor, &mBGColor)) {
+                    mColorDataBase, mColor, &mBGColor, &mHSVLookup)) {
                 return false;
             }
 
         }
     }
 
-    // save and show output
-    MEASURE_DURATION(GenerateOutput());
+    // store frame specific results needed by the output
+    f->mLight = mLight;
+    for (i = 0; i < MAXMBASE; i++) {
+        f->mColor[i] = mColor[i];
+    }
 
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void GenerateOutput() {
+bool GenerateOutput(cFrame* f) {
     // save data file
     if (cs.bWriteText) {
-        WriteBlobFile(&cs, ofsdat, mBlobParticles,
-                mMDParticles, mRatParticles, currentframe);
+        cStageTimer stagetimer(STAGE_WRITEBLOBFILE);
+        if (cs.blobfileformat == BLOBFILE_BINARY) {
+            if (!WriteBinaryBlobFile(&cs, binofsdat, f->blobframe,
+                    f->mBlobParticles, f->mMDParticles, f->mRatParticles,
+                    f->currentframe)) {
+                LOG_ERROR("Could not write binary blob file at frame %d.", f->currentframe);
+                return false;
+            }
+        } else {
+            if (!WriteBlobFile(&cs, ofsdat, f->blobframe, f->mBlobParticles,
+                    f->mMDParticles, f->mRatParticles, f->currentframe)) {
+                LOG_ERROR("Could not write blob file at frame %d.", f->currentframe);
+                return false;
+            }
+        }
+        // write buffered text output to disk from time to time
+        ofsdat.FlushIfDue();
+        ofslog.FlushIfDue();
     }
 
     // write result to output if needed
     if (cs.bCout) {
-        std::cout << "frame: " << currentframe
-                << ", c0-" << mColor[0].name << ": " << mColor[0].mNumBlobsFound
-                << ", c1-" << mColor[1].name << ": " << mColor[1].mNumBlobsFound
-                << ", c2-" << mColor[2].name << ": " << mColor[2].mNumBlobsFound
-                << ", c3-" << mColor[3].name << ": " << mColor[3].mNumBlobsFound
-                << ", c4-" << mColor[4].name << ": " << mColor[4].mNumBlobsFound
-                << ", MD: " << (int) mMDParticles.size()
-                << ", RAT: " << (int) mRatParticles.size()
+        std::cout << "frame: " << f->currentframe
+                << ", c0-" << f->mColor[0].name << ": " << f->mColor[0].mNumBlobsFound
+                << ", c1-" << f->mColor[1].name << ": " << f->mColor[1].mNumBlobsFound
+                << ", c2-" << f->mColor[2].name << ": " << f->mColor[2].mNumBlobsFound
+                << ", c3-" << f->mColor[3].name << ": " << f->mColor[3].mNumBlobsFound
+                << ", c4-" << f->mColor[4].name << ": " << f->mColor[4].mNumBlobsFound
+                << ", MD: " << (int) f->mMDParticles.size()
+                << ", RAT: " << (int) f->mRatParticles.size()
                 << std::endl;
     }
 
     //////////////////////////////////////////////////////
     // debug results
     //char* cc = {"RYGBP"};
-    //for (int i = 0; i < (int)mBlobParticles.size(); i++) {
-    //    std::cout << cc[mBlobParticles[i].index] << mBlobParticles[i].index
-    //        << " X" << mBlobParticles[i].mCenter.x
-    //        << " Y" << mBlobParticles[i].mCenter.y
-    //        << " D" << mBlobParticles[i].mRadius * 2
-    //        << " E" << mBlobParticles[i].mAxisA / mBlobParticles[i].mAxisB
+    //for (int i = 0; i < (int)f->mBlobParticles.size(); i++) {
+    //    std::cout << cc[f->mBlobParticles[i].index] << f->mBlobParticles[i].index
+    //        << " X" << f->mBlobParticles[i].mCenter.x
+    //        << " Y" << f->mBlobParticles[i].mCenter.y
+    //        << " D" << f->mBlobParticles[i].mRadius * 2
+    //        << " E" << f->mBlobParticles[i].mAxisA / f->mBlobParticles[i].mAxisB
     //        << std::endl;
     //}
     ////////////////////////////////////////////////////
@@ -511,16 +769,16 @@ void GenerateOutput() {
     if (cs.bShowVideo || cs.bWriteVideo) {
         // generate output video frame
         // pass original image to write to, not ROI one
-        WriteVisualOutput(inputimage, &cs,
-                mBlobParticles, mMDParticles, mRatParticles,
-                mBarcodes, mColor, mLight,
-                inputvideostarttime, currentframe, framesize, framesizeROI, fps);
+        MEASURE_DURATION(STAGE_WRITEVISUALOUTPUT, WriteVisualOutput(
+                f->inputimage, &cs, f->mBlobParticles, f->mMDParticles,
+                f->mRatParticles, f->mBarcodes, f->mColor, f->mLight,
+                inputvideostarttime, f->currentframe, framesize, framesizeROI, fps));
         // show image frame with blobs
         if (cs.bShowVideo) {
             if (cs.bApplyROIToVideoOutput && cs.imageROI.width && cs.imageROI.height) {
-                cv::imshow("OutputVideo", inputimage(cs.imageROI));
+                cv::imshow("OutputVideo", f->inputimage(cs.imageROI));
             } else {
-                cv::imshow("OutputVideo", inputimage);
+                cv::imshow("OutputVideo", f->inputimage);
             }
 
             if (cs.bCin) {
@@ -540,6 +798,8 @@ void GenerateOutput() {
     } else if (cs.bCin) {
         std::cin.get();              // wait for return if needed and no image was shown
     }
+
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -570,6 +830,7 @@ bool initializeVideo(char *filename) {
         std::cout << "  Warning: could not get proper framecount (received " <<
                 framecount << "). Framecount is set to 1000000 temporarily.";
         framecount = 1000000;
+        bFramecountUnknown = true;
         // end of temporary solution
     }
     fps = inputvideo.get(cv::CAP_PROP_FPS);
@@ -588,22 +849,57 @@ bool initializeVideo(char *filename) {
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// load frame index of the input video, or build and save it if needed
+bool loadVideoIndex(cVideoIndex& videoindex) {
+    std::ostringstream indexfile;
+    indexfile << cs.outputdirectory << cs.outputfilecommon << VIDEOINDEXTAG;
+    if (videoindex.Load(indexfile.str().c_str(), cs.inputvideofile)) {
+        std::cout << "  Frame index loaded from " << indexfile.str() << std::endl;
+        return true;
+    }
+    std::cout << "  Building frame index (reading all frames once)..." << std::endl;
+    if (!videoindex.Build(cs.inputvideofile))
+        return false;
+    if (!videoindex.Save(indexfile.str().c_str(), cs.inputvideofile))
+        std::cout << "  Warning: could not save frame index to " <<
+                indexfile.str() << std::endl;
+
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // read until first OK frame
-bool readVideoUntilFirstGoodFrame() {
+bool readVideoUntilFirstGoodFrame(bool bUseIndex) {
+    cVideoIndex videoindex;
+    bool bIndexed = false;
     // TODO:  OpenCv2.3.1 cvSetCaptureProperty does not work well on patek .ts videos!!! Should not be called at all if started from beginning!
     std::cout << "Reading video until first good frame is found..." << std::endl;
-    if (cs.firstframe)
+    currentframe = 0;
+    if (cs.firstframe && cs.bVideoIndex && bUseIndex) {
+        // seek to the last keyframe before firstframe using the frame index
+        loadVideoIndex(videoindex);
+        if (SeekVideoBeforeFrame(inputvideo, videoindex, cs.firstframe, &currentframe)) {
+            bIndexed = true;
+            std::cout << "  Video positioned to keyframe " << currentframe - 1 <<
+                    " using the frame index." << std::endl;
+        } else {
+            std::cout << "  Warning: could not seek using the frame index, reading all frames before first frame." << std::endl;
+            inputvideo.release();
+            if (!initializeVideo(cs.inputvideofile))
+                return false;
+            currentframe = 0;
+        }
+    } else if (cs.firstframe)
         std::cout << "  First frame is defined (" << cs.
                 firstframe <<
                 "). Since video positioning is not exact, we need to read all frames before that."
                 << std::endl;
 //      if (cs.firstframe < 100)
 //      {
-    currentframe = 0;
-    while ((inputimage.empty() || currentframe <= cs.firstframe)
+    while ((frame.inputimage.empty() || currentframe <= cs.firstframe)
             && currentframe < cs.firstframe + 128) {
-        ReadNextFrame();
+        ReadNextFrame(&frame);
         if ((currentframe % 100) == 0)
             std::cout << currentframe << " frames read (" << cs.firstframe -
                     currentframe << " left)" << std::endl;
@@ -618,53 +914,63 @@ bool readVideoUntilFirstGoodFrame() {
             ReadNextFrame();
     }
 */
-    if (inputimage.empty()) {
+    if (frame.inputimage.empty()) {
         LOG_ERROR("Could not retreive good frame from video even after 128 trials.");
         return false;
     }
+    frame.currentframe = --currentframe;
+    // verify that seeking resulted in the same frame as reading would have
+    if (bIndexed && !CheckVideoFrame(inputvideo, videoindex, currentframe)) {
+        std::cout << "  Warning: frame timestamp does not match the frame index after seeking, reading all frames before first frame." << std::endl;
+        frame.inputimage.release();
+        inputvideo.release();
+        if (!initializeVideo(cs.inputvideofile))
+            return false;
+        return readVideoUntilFirstGoodFrame(false);
+    }
     std::cout << "  First good frame number (starting from zero): " <<
-            (--currentframe) << std::endl;
+            currentframe << std::endl;
 
     // return without error
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool ReadNextFrame() {
-    cv::Mat inputimageROI;
+cv::Mat GetInputImageROI(cFrame* f) {
+    // set image ROI if needed (cvQueryFrame resets it on every call)
+    if (cs.imageROI.width && cs.imageROI.height) {
+        return f->inputimage(cs.imageROI);
+    }
+    return f->inputimage;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReadNextFrame(cFrame* f) {
     // try to get next frame
-    inputvideo.read(inputimage);
-    currentframe++;
+    MEASURE_DURATION(STAGE_DECODE, inputvideo.read(f->inputimage));
+    f->currentframe = ++currentframe;
 
     // error check
-    if (inputimage.empty()) {
+    if (f->inputimage.empty()) {
         LOG_ERROR("Could not retrieve image from video!");
         return false;
     }
-    if (inputimage.channels() != 3) {
+    if (f->inputimage.channels() != 3) {
         LOG_ERROR("The input image is not a color image.");
         return false;
     }
     // TODO: convert this from c to cpp header style
-    //if (memcmp(inputimage->channelSeq, "BGR", 3)) {
+    //if (memcmp(f->inputimage->channelSeq, "BGR", 3)) {
     //    LOG_ERROR("The input image is not a BGR image. The result may be unexpected.");
     //    return false;
     //}
-    // set image ROI if needed (cvQueryFrame resets it on every call)
-    if (cs.imageROI.width && cs.imageROI.height) {
-        inputimageROI = inputimage(cs.imageROI);
-    } else {
-        inputimageROI = inputimage;
+    // tiled detection smoothes the input image band by band
+    if (bTiledDetection) {
+        return true;
     }
+    cv::Mat inputimageROI = GetInputImageROI(f);
     // smooth input image if needed (and possible), but keep original for output video
-    if (cs.gausssmoothing) {
-        cv::GaussianBlur(inputimageROI, smoothinputimage,
-                cv::Size(cs.gausssmoothing, cs.gausssmoothing), 0);
-    } else {
-        inputimageROI.copyTo(smoothinputimage);
-    }
-    // convert BGR image to HSV image
-    cv::cvtColor(smoothinputimage, HSVimage, cv::COLOR_BGR2HSV);
+    MEASURE_DURATION(STAGE_BLUR, SmoothFrame(f, inputimageROI, &cs));
 
     // return without error
     return true;
@@ -8,40 +8,36 @@
 /////////////////////////////////////////////////
 // include standard C++ libraries
 #include <iostream>
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <list>
 #include <string>
 #include <iterator>
+#include <thread>
 #include <time.h>
 
 /////////////////////////////////////////////////
 // include from self project
+#include "batch.h"
+#include "blobfile.h"
+#include "chunks.h"
+#include "detection.h"
+#include "fileutils.h"
+#include "frame.h"
 #include "ini.h"
 #include "light.h"
+#include "mappedfile.h"
 #include "mfix.h"
+#include "profiler.h"
+#include "textwriter.h"
+#include "tiles.h"
+#include "videoindex.h"
+#include "workspace.h"
 
 #define CV_WARN(message) fprintf(stderr, "warning: %s (%s:%d)\n", message, __FILE__, __LINE__)
 
-clock_t measure_duration_start, measure_duration_stop;
-#ifdef ON_LINUX
-#define MEASURE_DURATION(NAME) \
-	measure_duration_start = clock(); \
-	 NAME  ; \
-	measure_duration_stop = clock(); \
-	if (cs.bCout) std::cout << "time:  NAME : " << (((measure_duration_stop - measure_duration_start) * 1000) / CLOCKS_PER_SEC) << " ms" << std::endl;
-#else
-#define MEASURE_DURATION(NAME) \
-	measure_duration_start = clock(); \
-	## NAME ##  ; \
-	measure_duration_stop = clock(); \
-	if (cs.bCout) std::cout << "time: " #NAME ": " << (((measure_duration_stop - measure_duration_start) * 1000) / CLOCKS_PER_SEC) << " ms" << std::endl;
-
-#endif
-// To disable benchmarking, uncomment following line:
-//#define MEASURE_DURATION(NAME) NAME;
-
 /* fix "‘INT64_C’ was not declared in this scope" errors,
    see: http://vskrishnan.wordpress.com/2007/07/31/ffmpeg-int64_c-problem-and-workaround/ */
 //#ifdef ON_LINUX
@@ -58,49 +54,59 @@ cCS cs;                         //!< all control states read from the ini file
 std::list < cColorSet > mColorDataBase[2]; // the full color database list [day/night]
 cColor mColor[MAXMBASE];        //!< actual colors to detect - parsed dynamically from list/interpolation
 tColor mBGColor;                //!< actual background color definition
+tHSVLookup mHSVLookup;          //!< lookup table of the actual color definitions
 
 // from paintdates file
 std::list < time_t > mPaintDates;       // seconds since 1970 1 January
+bool tempDSLP = false;          // dayssincelastpaint is given in the command line (paint dates are not used)
 
 lighttype_t mLight;             // DAYLIGHT, NIGHTLIGHT or EXTRALIGHT (as part of daylight)
 
-// variables for blob detection
-tBarcode mBarcodes;             // barcodes loaded from trajognize output
-tBlob mBlobParticles;           //!< The list of detected colored-particles.
-tBlob mMDParticles;             // list of motion-detected blobs
-tBlob mRatParticles;            // list of rat blobs
-cv::Mat movingAverage;        // used by the motion detection filter
+// scratch images and state of blob detection
+cWorkspace workspace;
+bool bTiledDetection = false;   // detection is done band by band (see DetectTiled())
 
 // image, video and text output parameters
 cv::Size framesize;
 cv::Size framesizeROI;
 int framecount;
+bool bFramecountUnknown = false; // framecount is a placeholder, the video did not tell it
 double fps;
-int currentframe;
-cv::Mat inputimage;           // BGR original image read from the video
-cv::Mat smoothinputimage;     // BGR ROI image smoothed
-cv::Mat HSVimage;             // HSV ROI image to work on with all image prcessing tools
-cv::Mat maskimage;            // binary mask image containing only enlarged rat blobs
+int currentframe;               // number of the last frame read from the video
+cFrame frame;                   // the frame processed in serial mode (or the first frame of the pipeline)
 cv::VideoCapture inputvideo;
 timed_t inputvideostarttime;    // like time_t but increased with fraction of a second
 
 // stream and string variables
-std::ifstream ifsbarcode;
-std::ifstream ifsdat;
-std::ifstream ifslog;
-std::ofstream ofsdat;
-std::ofstream ofslog;
+cMappedFile ifsbarcode;
+cMappedFile ifsdat;
+cMappedFile ifslog;
+cTextWriter ofsdat;
+cBinaryBlobReader binifsdat;    // used instead of ifsdat with binary blob files
+cBinaryBlobWriter binofsdat;    // used instead of ofsdat with binary blob files
+cTextWriter ofslog;
 std::string args;
 
+// chunk mode
+int chunkindex = CHUNK_NONE;   // index of the chunk processed by this worker process, or CHUNK_NONE/CHUNK_PARENT
+
 /////////////////////////////////////////////////
 // functions
 
 int OnInit(int argc, char *argv[]); // called at initialization once, returns error code, which is positive if release is needed in consecutive OnExit()
+int OnInitVideo();              // called by ProcessVideo() once for each video, returns error code like OnInit()
+int ProcessVideo(int* nframes); // called by main() for the input video or by each worker in batch mode, returns error code
+void WriteProfile();            // called by ProcessVideo() at the end to write the stage duration report
 bool initializeVideo(char *filename); // called by OnInit() once
-bool readVideoUntilFirstGoodFrame(); // called by OnInit() once
-bool OnStep();                  // called on each frame
-bool ReadNextFrame();           // called by OnStep(), reads next frame to input image
-void GenerateOutput();          // called by OnStep(), generate video, image, text, etc.
+bool loadVideoIndex(cVideoIndex& videoindex); // called by OnInit() and readVideoUntilFirstGoodFrame()
+bool readVideoUntilFirstGoodFrame(bool bUseIndex = true); // called by OnInit() once
+bool OnStep();                  // called on each frame in serial mode
+bool RunPipeline();             // called instead of the OnStep() loop in pipeline mode
+bool ReadNextFrame(cFrame* f);  // reads next frame from video to input image (decode stage)
+cv::Mat GetInputImageROI(cFrame* f); // returns the ROI of the input image of a frame
+bool ProcessFrame(cFrame* f, cTextWriter& log); // called by OnStep(), all image and text processing (detection stage)
+bool GenerateOutput(cFrame* f); // called by OnStep(), generate video, image, text, etc. (output stage)
+void PrintProgress(int framenum); // prints framerate and remaining time once in a second
 void OnExit(bool bReleaseVars = true);  // called once to release all allocated memory
 
 #endif
@@ -0,0 +1,22 @@
+#ifndef HEADER_SIMD
+#define HEADER_SIMD
+
+// SIMD_X86 is defined on x86 targets, where the SSE/AVX intrinsics are
+// available. Functions using them are compiled for the given instruction
+// set with the TARGET_* attributes only, and must be called only if
+// cv::checkHardwareSupport() reports the instruction set at run time.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86
+#include <immintrin.h>
+#if defined(__GNUC__)
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX __attribute__((target("avx")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE41
+#define TARGET_AVX
+#define TARGET_AVX2
+#endif
+#endif
+
+#endif
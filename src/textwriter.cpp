@@ -0,0 +1,198 @@
+#include <cmath>
+#include <cstdio>
+
+#include "log.h"
+#include "textwriter.h"
+
+// powers of ten used by fixed notation
+static const double pow10table[10] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// append unsigned integer in decimal, padded with zeros to at least width digits
+static void AppendUnsigned(std::string& dst, unsigned long long n, int width) {
+    char digits[24];
+    int i = 24;
+    do {
+        digits[--i] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n);
+    while (24 - i < width)
+        digits[--i] = '0';
+    dst.append(digits + i, 24 - i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// |value| * 10^decimals rounded to nearest integer, ties to even, exactly as
+// printf("%.*f") does; returns false for large, non-finite and very precise values
+static bool ScaleFixed(double value, int decimals, double* rounded) {
+    double v, t, e, fl, f;
+    v = std::fabs(value);
+    t = (decimals >= 0 && decimals <= 9) ? v * pow10table[decimals] : NAN;
+    if (!(t < 4503599627370496.0)) // 2^52
+        return false;
+    // v * 10^decimals == t + e exactly, round it to nearest, ties to even
+    e = std::fma(v, pow10table[decimals], -t);
+    fl = std::floor(t);
+    f = t - fl;
+    if (f > 0.5 || (f == 0.5 && (e > 0 || (e == 0 && std::fmod(fl, 2) != 0))))
+        fl += 1;
+    *rounded = fl;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double RoundFixed(double value, int decimals) {
+    double fl;
+    if (!ScaleFixed(value, decimals, &fl))
+        return value;
+
+    return std::copysign(fl / pow10table[decimals], value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AppendFixed(std::string& dst, double value, int decimals) {
+    double fl;
+    unsigned long long n, scale;
+    char cc[64];
+    // fall back to snprintf for large, non-finite and very precise values
+    if (!ScaleFixed(value, decimals, &fl)) {
+        int len = snprintf(cc, sizeof(cc), "%.*f", decimals, value);
+        if (len < (int)sizeof(cc)) {
+            dst.append(cc, len);
+        } else {
+            std::string tmp(len + 1, 0);
+            snprintf(&tmp[0], len + 1, "%.*f", decimals, value);
+            dst.append(tmp.c_str(), len);
+        }
+        return;
+    }
+    // write sign, integer part and decimals
+    n = (unsigned long long)fl;
+    scale = (unsigned long long)pow10table[decimals];
+    if (std::signbit(value))
+        dst.push_back('-');
+    AppendUnsigned(dst, n / scale, 1);
+    if (decimals > 0) {
+        dst.push_back('.');
+        AppendUnsigned(dst, n % scale, decimals);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cTextWriter::Open(const char* filename, double flushinterval,
+        size_t buffersize) {
+    this->flushinterval = flushinterval;
+    this->buffersize = buffersize;
+    buffer.clear();
+    buffer.reserve(buffersize + 4096);
+    ofs.open(filename, std::ios::out | std::ios::trunc);
+    lastflush = std::chrono::steady_clock::now();
+
+    return ofs.is_open();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cTextWriter::Flush() {
+    if (!ofs.is_open())
+        return true;
+    if (!buffer.empty()) {
+        ofs.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+    ofs.flush();
+    lastflush = std::chrono::steady_clock::now();
+    if (!ofs.good()) {
+        LOG_ERROR("Could not write to text output file.");
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cTextWriter::FlushIfDue() {
+    if (flushinterval <= 0 || !ofs.is_open())
+        return;
+    if (std::chrono::duration<double>(std::chrono::steady_clock::now() -
+            lastflush).count() >= flushinterval)
+        Flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cTextWriter::Close() {
+    bool ret;
+    if (!ofs.is_open())
+        return true;
+    ret = Flush();
+    ofs.close();
+
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void cTextWriter::SetFixed(int decimals) {
+    bFixed = (decimals >= 0);
+    precision = bFixed ? decimals : 6;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+cTextWriter& cTextWriter::operator<<(const char* s) {
+    buffer.append(s);
+    Check();
+    return *this;
+}
+
+cTextWriter& cTextWriter::operator<<(const std::string& s) {
+    buffer.append(s);
+    Check();
+    return *this;
+}
+
+cTextWriter& cTextWriter::Append(const char* begin, const char* end) {
+    buffer.append(begin, end);
+    Check();
+    return *this;
+}
+
+cTextWriter& cTextWriter::operator<<(char c) {
+    buffer.push_back(c);
+    Check();
+    return *this;
+}
+
+cTextWriter& cTextWriter::operator<<(int i) {
+    return *this << (long long)i;
+}
+
+cTextWriter& cTextWriter::operator<<(long long i) {
+    if (i < 0) {
+        buffer.push_back('-');
+        AppendUnsigned(buffer, 0ULL - (unsigned long long)i, 1);
+    } else {
+        AppendUnsigned(buffer, (unsigned long long)i, 1);
+    }
+    Check();
+    return *this;
+}
+
+cTextWriter& cTextWriter::operator<<(double d) {
+    if (bFixed) {
+        AppendFixed(buffer, d, precision);
+    } else {
+        // default notation of std::ostream
+        char cc[64];
+        int len = snprintf(cc, sizeof(cc), "%.*g", precision, d);
+        buffer.append(cc, len);
+    }
+    Check();
+    return *this;
+}
+
+cTextWriter& cTextWriter::operator<<(const cTextWriter& other) {
+    buffer.append(other.buffer);
+    Check();
+    return *this;
+}
@@ -0,0 +1,105 @@
+#ifndef HEADER_TEXTWRITER
+#define HEADER_TEXTWRITER
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+// default buffer size of text output files [bytes]
+#define TEXTWRITERBUFFERSIZE (1 << 20)
+
+// Buffered text output used for the .blobs and .log files.
+//
+// All text is formatted into a large buffer without locale handling and
+// is written to the file only if the buffer is full, on Flush() or on
+// Close(), or if FlushIfDue() is called after the flush interval elapsed.
+// Numbers are formatted exactly like the default or fixed std::ostream
+// formatting, so output is identical to streaming into an std::ofstream.
+// If no file is opened, text is only collected in memory (e.g. the log
+// lines of a single frame) and can be appended to another writer.
+class cTextWriter {
+  public:
+    //! Constructor.
+    cTextWriter() : precision(6), bFixed(false), flushinterval(0),
+            buffersize(TEXTWRITERBUFFERSIZE) {
+    }
+    //! Destructor.
+    ~cTextWriter() {
+        Close();
+    }
+    // open file for writing (truncate), flushinterval is in seconds (0 - never)
+    bool Open(const char* filename, double flushinterval = 0,
+            size_t buffersize = TEXTWRITERBUFFERSIZE);
+    bool is_open() const {
+        return ofs.is_open();
+    }
+    // false after a write error to the file (buffered text is written late)
+    bool good() const {
+        return !ofs.is_open() || ofs.good();
+    }
+    // flush buffer and close file, returns false on write error
+    bool Close();
+    // write buffer to file (buffer is kept in memory mode)
+    bool Flush();
+    // flush if flush interval has elapsed since the last flush
+    void FlushIfDue();
+    // set fixed notation with given number of decimals (like std::fixed
+    // and precision()), or default notation if decimals is negative
+    void SetFixed(int decimals);
+    // text collected so far (not yet written to file)
+    const std::string& str() const {
+        return buffer;
+    }
+    // drop text collected so far
+    void clear() {
+        buffer.clear();
+    }
+
+    cTextWriter& operator<<(const char* s);
+    cTextWriter& operator<<(const std::string& s);
+    cTextWriter& operator<<(char c);
+    cTextWriter& operator<<(int i);
+    cTextWriter& operator<<(long long i);
+    cTextWriter& operator<<(double d);
+    cTextWriter& operator<<(const cTextWriter& other);
+    // append text [begin, end) as is
+    cTextWriter& Append(const char* begin, const char* end);
+
+  private:
+    std::ofstream ofs;
+    std::string buffer;
+    int precision;              // number of decimals (fixed) or significant digits
+    bool bFixed;                // fixed or default notation
+    double flushinterval;       // [s]
+    size_t buffersize;          // buffer is written to file above this size
+    std::chrono::steady_clock::time_point lastflush;
+    void Check() {
+        if (buffer.size() >= buffersize && ofs.is_open())
+            Flush();
+    }
+};
+
+/**
+ * Append a double in fixed notation, exactly like printf("%.*f").
+ *
+ * Exact decimal rounding is done with the error-free product of a fused
+ * multiply-add, snprintf() is only used for large and non-finite values.
+ *
+ * \param dst       the string to append to
+ * \param value     the number to format
+ * \param decimals  number of decimals
+ */
+void AppendFixed(std::string& dst, double value, int decimals);
+
+/**
+ * Round a double to the value written by AppendFixed().
+ *
+ * \param value     the number to round
+ * \param decimals  number of decimals
+ *
+ * \return the nearest double to the decimal written in fixed notation
+ *         (value itself where AppendFixed() falls back to snprintf())
+ */
+double RoundFixed(double value, int decimals);
+
+#endif
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <vector>
+
+#include "cvutils.h"
+#include "profiler.h"
+#include "tiles.h"
+
+////////////////////////////////////////////////////////////////////////////////
+void SmoothRect(cv::Mat &dst, cv::Mat &src, int ksize, cv::Rect rect) {
+    cv::Mat dstrect = dst(rect);
+
+    // rect is a view, so pixels around it are used by the filter, not the border
+    if (ksize) {
+        cv::GaussianBlur(src(rect), dstrect, cv::Size(ksize, ksize), 0);
+    } else {
+        src(rect).copyTo(dstrect);
+    }
+}
+
+// erode or dilate rows [y0, y1) of an image as part of the whole image,
+// i.e. the given number of source rows around the band must be ready
+static void MorphRows(cv::Mat &dst, cv::Mat &src, bool bDilate, int iterations,
+        int y0, int y1) {
+    cv::Mat dstrows = dst.rowRange(y0, y1);
+
+    if (!iterations) {
+        src.rowRange(y0, y1).copyTo(dstrows);
+    } else if (bDilate) {
+        cv::dilate(src.rowRange(y0, y1), dstrows, cv::Mat(), cv::Point(-1,-1), iterations);
+    } else {
+        cv::erode(src.rowRange(y0, y1), dstrows, cv::Mat(), cv::Point(-1,-1), iterations);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void DetectTiled(cv::Mat &inputimage, cv::Mat &smoothimage, cCS* cs,
+        cColor* mColor, tHSVLookup* mHSVLookup, cWorkspace* ws,
+        tBlob& mRatParticles, tBlob& mBlobParticles, int currentframe,
+        cTextWriter& ofslog) {
+    std::vector<cv::Moments>& blobmoments = ws->blobws.blobmoments;
+    bool bComponents = (cs->blobextraction == BLOB_EXTRACT_COMPONENTS);
+    int height = inputimage.rows;
+    int tilerows = std::max(cs->tilerows, 1);
+    // rows ready after each step and the rows needed from them
+    int yA = 0, yB = 0, yC = 0, yD = 0, yE = 0;
+    int tA, tB, tC, tD, tE;
+    int i;
+
+    // all images are allocated only once
+    smoothimage.create(inputimage.size(), CV_8UC3);
+    ws->rattmpimage.create(inputimage.size(), CV_8UC1);
+    ws->ratlabeler.Reset();
+    for (i = 0; i < cs->mBase; i++) {
+        if (!mColor[i].mUse)
+            continue;
+        ws->colorbinimage[i].create(inputimage.size(), CV_8UC1);
+        ws->colortmpimage[i].create(inputimage.size(), CV_8UC1);
+        ws->colorlabeler[i].Reset();
+    }
+
+    {
+        cStageTimer stagetimer(STAGE_TILES);
+        while (yE < height) {
+            // next band of final rows and the halo rows needed by each step
+            tE = std::min(height, yE + tilerows);
+            tD = std::min(height, tE + cs->mErodeBlob);
+            tC = std::min(height, tD + cs->mDilateBlob);
+            tB = std::min(height, tC + cs->mDilateRat);
+            tA = std::min(height, tB + cs->mErodeRat);
+
+            // A: smoothing, classification and inverted background (as ClassifyColors()
+            // and the first part of DetectRats())
+            if (yA < tA) {
+                SmoothRect(smoothimage, inputimage, cs->gausssmoothing,
+                        cv::Rect(0, yA, inputimage.cols, tA - yA));
+                cv::Mat smoothrows = smoothimage.rowRange(yA, tA);
+                cv::Mat labelrows = ws->labelimage.rowRange(yA, tA);
+                cv::Mat ratrows = ws->ratimage.rowRange(yA, tA);
+                ClassifyColors(smoothrows, labelrows, mHSVLookup);
+                cvLabelToBinary(ratrows, labelrows, 1 << BGLABELBIT);
+                cv::bitwise_not(ratrows, ratrows);
+                yA = tA;
+            }
+            // B: erode rats
+            if (yB < tB) {
+                MorphRows(ws->rattmpimage, ws->ratimage, false, cs->mErodeRat, yB, tB);
+                yB = tB;
+            }
+            // C: dilate rats into the mask, mask labels and get colors
+            // (as the rest of DetectRats(), MaskColorLabels() and FindHSVBlobs())
+            if (yC < tC) {
+                MorphRows(ws->maskimage, ws->rattmpimage, true, cs->mDilateRat, yC, tC);
+                if (bComponents)
+                    ws->ratlabeler.AddRows(ws->maskimage, yC, tC);
+                cv::Mat labelrows = ws->labelimage.rowRange(yC, tC);
+                cv::Mat maskrows = ws->maskimage.rowRange(yC, tC);
+                MaskColorLabels(labelrows, maskrows, mHSVLookup);
+                for (i = 0; i < cs->mBase; i++) {
+                    if (!mColor[i].mUse)
+                        continue;
+                    cv::Mat binrows = ws->colorbinimage[i].rowRange(yC, tC);
+                    cvLabelToBinary(binrows, labelrows, 1 << i);
+                }
+                yC = tC;
+            }
+            // D: dilate colors
+            if (yD < tD) {
+                for (i = 0; i < cs->mBase; i++) {
+                    if (mColor[i].mUse)
+                        MorphRows(ws->colortmpimage[i], ws->colorbinimage[i],
+                                true, cs->mDilateBlob, yD, tD);
+                }
+                yD = tD;
+            }
+            // E: erode colors
+            for (i = 0; i < cs->mBase; i++) {
+                if (!mColor[i].mUse)
+                    continue;
+                MorphRows(ws->colorfilterimage[i], ws->colortmpimage[i], false,
+                        cs->mErodeBlob, yE, tE);
+                if (bComponents)
+                    ws->colorlabeler[i].AddRows(ws->colorfilterimage[i], yE, tE);
+            }
+            yE = tE;
+        }
+    }
+
+    // rat blobs
+    {
+        cStageTimer stagetimer(STAGE_DETECTRATS);
+        if (bComponents) {
+            blobmoments.clear();
+            ws->ratlabeler.GetMoments(blobmoments);
+            MDorRatBlobsFromMoments(blobmoments, cs, &ws->blobws, mRatParticles,
+                    currentframe, ofslog);
+        } else {
+            // keep the mask, contour finding modifies its input
+            ws->maskimage.copyTo(ws->ratimage);
+            FindMDorRatBlobs(ws->ratimage, cs, &ws->blobws, mRatParticles,
+                    currentframe, ofslog);
+        }
+    }
+
+    // colored blobs, in the same order as without tiles
+    cStageTimer stagetimer(STAGE_FINDHSVBLOBS);
+    for (i = 0; i < cs->mBase; i++) {
+        if (!mColor[i].mUse)
+            continue;
+        cStageTimer colortimer(STAGE_FINDHSVBLOBS_COLOR + i);
+        mColor[i].mNumBlobsFound = 0;
+        if (bComponents) {
+            blobmoments.clear();
+            ws->colorlabeler[i].GetMoments(blobmoments);
+            SubBlobsFromMoments(blobmoments, i, mColor, cs, &ws->blobws,
+                    mBlobParticles, currentframe, ofslog);
+        } else {
+            FindSubBlobs(ws->colorfilterimage[i], i, mColor, cs, &ws->blobws,
+                    mBlobParticles, currentframe, ofslog);
+        }
+    }
+}
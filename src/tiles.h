@@ -0,0 +1,53 @@
+#ifndef HEADER_TILES
+#define HEADER_TILES
+
+#include <opencv2/opencv.hpp>
+
+#include "blob.h"
+#include "color.h"
+#include "ini.h"
+#include "textwriter.h"
+#include "workspace.h"
+
+/**
+ * Smooth a rectangle of an image exactly as it would be smoothed as
+ * part of the whole image (pixels around the rectangle are used).
+ *
+ * \param dst    the destination image (same size as src)
+ * \param src    the source BGR image
+ * \param ksize  size of the Gauss kernel, 0 means simple copy
+ * \param rect   the rectangle to smooth
+ */
+void SmoothRect(cv::Mat &dst, cv::Mat &src, int ksize, cv::Rect rect);
+
+/**
+ * Tiled detection: smoothing, ClassifyColors(), DetectRats(),
+ * MaskColorLabels() and FindHSVBlobs() of all used colors on horizontal
+ * bands of cs->tilerows rows, so that all intermediate images of a band
+ * stay in cache between the steps.
+ *
+ * Each step runs ahead of the next one by the number of rows its dilate or
+ * erode operation needs below a band (halo rows), so results are exactly
+ * the same as with the whole image steps. With BLOB_EXTRACT_COMPONENTS
+ * the final binary images are also labeled band by band, components are
+ * merged across band boundaries.
+ *
+ * \param inputimage      the input BGR image (ROI)
+ * \param smoothimage     the smoothed image (output, same size as inputimage)
+ * \param cs              control state structure
+ * \param mColor          the color definition database
+ * \param mHSVLookup      the lookup table of the current color definitions
+ * \param ws              workspace holding all scratch images
+ * \param mRatParticles   structure holding the found rat blobs
+ * \param mBlobParticles  structure holding the found colored blobs
+ * \param currentframe    the current video frame index
+ * \param ofslog          output log file stream
+ *
+ * Note that debug windows are not shown and colors are processed serially.
+ */
+void DetectTiled(cv::Mat &inputimage, cv::Mat &smoothimage, cCS* cs,
+        cColor* mColor, tHSVLookup* mHSVLookup, cWorkspace* ws,
+        tBlob& mRatParticles, tBlob& mBlobParticles, int currentframe,
+        cTextWriter& ofslog);
+
+#endif
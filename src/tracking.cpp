@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+
+#include "tracking.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// window around blob j with the given margin, clipped to the image
+static cv::Rect BlobWindow(tBlob& blobs, size_t j, int margin, cv::Rect image) {
+    int r = (int)ceil(std::max(blobs.axisA[j], blobs.radius[j])) + margin;
+
+    return cv::Rect((int)floor(blobs.cx[j]) - r, (int)floor(blobs.cy[j]) - r,
+            2 * r + 2, 2 * r + 2) & image;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void GetTrackingWindows(cCS* cs, cColor* mColor, cTracking* tracking,
+        tBlob& mRatParticles, cv::Size size, int currentframe,
+        std::vector<cv::Rect>** windows) {
+    cv::Rect image(0, 0, size.width, size.height);
+    // blobs in the padding might continue outside the window,
+    // FindHSVBlobs() searches the color fully then
+    int padding = RegionPadding(cs);
+    int count[MAXMBASE] = {0};
+    bool bContinuous = (tracking->lastframe >= 0 &&
+            tracking->lastframe == currentframe - 1);
+    size_t j, k;
+    int i;
+
+    for (j = 0; j < tracking->lastBlobs.size(); j++)
+        count[tracking->lastBlobs.index[j]]++;
+    // full search on the first frame, after a jump, periodically or when
+    // blobs were lost
+    for (i = 0; i < MAXMBASE; i++) {
+        windows[i] = NULL;
+        tracking->windows[i].clear();
+        tracking->bFullScan[i] = !bContinuous ||
+                currentframe - tracking->lastfullscan[i] >= cs->trackingfullscan ||
+                count[i] < tracking->fullscancount[i];
+    }
+    if (!bContinuous)
+        return;
+
+    // windows around the blobs of the previous frame
+    for (j = 0; j < tracking->lastBlobs.size(); j++) {
+        i = tracking->lastBlobs.index[j];
+        if (!tracking->bFullScan[i])
+            tracking->windows[i].push_back(BlobWindow(tracking->lastBlobs, j,
+                    cs->trackingwindow + padding, image));
+    }
+    // rats without tracked blobs might have new blobs of any color
+    for (k = 0; k < mRatParticles.size(); k++) {
+        cv::Rect rat = BlobWindow(mRatParticles, k, padding, image);
+        for (j = 0; j < tracking->lastBlobs.size(); j++) {
+            if (rat.contains(cv::Point((int)tracking->lastBlobs.cx[j],
+                    (int)tracking->lastBlobs.cy[j])))
+                break;
+        }
+        if (j < tracking->lastBlobs.size())
+            continue;
+        for (i = 0; i < cs->mBase; i++) {
+            if (!tracking->bFullScan[i])
+                tracking->windows[i].push_back(rat);
+        }
+    }
+    for (i = 0; i < cs->mBase; i++) {
+        if (!mColor[i].mUse || tracking->bFullScan[i])
+            continue;
+        MergeRegions(tracking->windows[i]);
+        windows[i] = &tracking->windows[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void UpdateTracking(cTracking* tracking, tBlob& mBlobParticles,
+        int currentframe) {
+    int count[MAXMBASE] = {0};
+    size_t j;
+
+    for (j = 0; j < mBlobParticles.size(); j++)
+        count[mBlobParticles.index[j]]++;
+    for (int i = 0; i < MAXMBASE; i++) {
+        if (tracking->bFullScan[i]) {
+            tracking->lastfullscan[i] = currentframe;
+            tracking->fullscancount[i] = count[i];
+        }
+    }
+    tracking->lastBlobs = mBlobParticles;
+    tracking->lastframe = currentframe;
+}
@@ -0,0 +1,79 @@
+#ifndef HEADER_TRACKING
+#define HEADER_TRACKING
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "blob.h"
+#include "constants.h"
+#include "ini.h"
+
+// State of the tracking-assisted color blob detection, where colors are
+// searched only in windows around the blobs of the previous frame and the
+// whole image is searched only from time to time.
+class cTracking {
+  public:
+    tBlob lastBlobs;            // colored blobs of the previous frame
+    int lastframe;              // index of the previous frame (-1 - none)
+    int lastfullscan[MAXMBASE]; // frame of the last full search of each color
+    int fullscancount[MAXMBASE]; // number of blobs found at the last full search
+    bool bFullScan[MAXMBASE];   // color is fully searched on the current frame
+    std::vector<cv::Rect> windows[MAXMBASE]; // search windows of the current frame
+    //! Constructor.
+    cTracking() {
+        Reset();
+    }
+    //! Destructor.
+    ~cTracking() {
+    }
+    // forget all previous frames
+    void Reset() {
+        lastBlobs.clear();
+        lastframe = -1;
+        for (int i = 0; i < MAXMBASE; i++) {
+            lastfullscan[i] = 0;
+            fullscancount[i] = 0;
+            bFullScan[i] = true;
+            windows[i].clear();
+        }
+    }
+};
+
+/**
+ * Decide which colors are searched on the whole image on the current frame
+ * and create the search windows of the others.
+ *
+ * A color is fully searched on the first frame, after a jump in frame
+ * indices, every cs->trackingfullscan frames and when less blobs were
+ * found of it on the previous frame than on its last full search.
+ * Otherwise it is searched in windows around its blobs of the previous
+ * frame (blob size + cs->trackingwindow pixels) and around the rats that
+ * had no colored blob on the previous frame. Windows are padded with
+ * RegionPadding(), FindHSVBlobs() searches a color fully if any of its
+ * blobs reaches into the padding (and sets tracking->bFullScan then).
+ *
+ * \param cs            control state structure
+ * \param mColor        the color definition database
+ * \param tracking      the tracking state
+ * \param mRatParticles the rat blobs of the current frame
+ * \param size          size of the (ROI) image
+ * \param currentframe  the current video frame index
+ * \param windows       array of MAXMBASE window lists used by
+ *                      FindHSVBlobs(), set to the windows of the colors
+ *                      that are not fully searched, NULL for the others
+ */
+void GetTrackingWindows(cCS* cs, cColor* mColor, cTracking* tracking,
+        tBlob& mRatParticles, cv::Size size, int currentframe,
+        std::vector<cv::Rect>** windows);
+
+/**
+ * Store the colored blobs of the current frame for the next one.
+ *
+ * \param tracking        the tracking state
+ * \param mBlobParticles  the colored blobs found on the current frame
+ * \param currentframe    the current video frame index
+ */
+void UpdateTracking(cTracking* tracking, tBlob& mBlobParticles,
+        int currentframe);
+
+#endif
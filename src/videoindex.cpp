@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "mappedfile.h"
+#include "textwriter.h"
+#include "videoindex.h"
+
+// frame timestamps and types can be queried since OpenCV 4.7
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7)
+#define VIDEOINDEX_SUPPORTED
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// get size and modification time of the video file to validate the cache
+static bool GetVideoFileStamp(const char* videofile, long long* size,
+        long long* mtime) {
+    struct stat st;
+    if (stat(videofile, &st) != 0)
+        return false;
+    *size = (long long)st.st_size;
+    *mtime = (long long)st.st_mtime;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cVideoIndex::Build(const char* videofile) {
+    pts.clear();
+    keyframes.clear();
+#ifdef VIDEOINDEX_SUPPORTED
+    cv::VideoCapture video;
+    video.open(videofile);
+    if (!video.isOpened()) {
+        LOG_ERROR("Could not open input video file: \"%s\"", videofile);
+        return false;
+    }
+    // grab (decode without conversion) all frames
+    while (video.grab()) {
+        if ((int)video.get(cv::CAP_PROP_FRAME_TYPE) == 'I')
+            keyframes.push_back((int)pts.size());
+        pts.push_back((long long)video.get(cv::CAP_PROP_PTS));
+        if ((pts.size() % 10000) == 0)
+            std::cout << "  " << pts.size() << " frames indexed" << std::endl;
+    }
+    // timestamps must identify frames
+    for (size_t i = 1; i < pts.size(); i++) {
+        if (pts[i] <= pts[i - 1]) {
+            std::cout << "  Warning: video timestamps are not increasing (frame "
+                    << i << "), frame index cannot be used." << std::endl;
+            pts.clear();
+            keyframes.clear();
+            return false;
+        }
+    }
+
+    return !pts.empty();
+#else
+    std::cout << "  Warning: frame index needs OpenCV 4.7 or later." << std::endl;
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cVideoIndex::Load(const char* indexfile, const char* videofile) {
+    cMappedFile ifs;
+    const char *line, *lineend, *token, *tokenend;
+    long long size, mtime;
+    int i = -1, n = 0;
+
+    pts.clear();
+    keyframes.clear();
+    if (!GetVideoFileStamp(videofile, &size, &mtime) || !ifs.Open(indexfile))
+        return false;
+    while (ifs.NextLine(&line, &lineend)) {
+        if (line == lineend || line[0] == '#')
+            continue;
+        cLineTokens lineTokens(line, lineend);
+        // header: video file size, modification time and number of frames
+        if (i < 0) {
+            lineTokens.Next(&token, &tokenend);
+            if (ParseLongLong(token, tokenend) != size)
+                return false;
+            lineTokens.Next(&token, &tokenend);
+            if (ParseLongLong(token, tokenend) != mtime)
+                return false;
+            lineTokens.Next(&token, &tokenend);
+            n = ParseInt(token, tokenend);
+            if (n <= 0)
+                return false;
+            pts.reserve(n);
+            i = 0;
+            continue;
+        }
+        // frames: framenum pts keyframe
+        lineTokens.Next(&token, &tokenend);
+        if (ParseInt(token, tokenend) != i)
+            break;
+        lineTokens.Next(&token, &tokenend);
+        pts.push_back(ParseLongLong(token, tokenend));
+        lineTokens.Next(&token, &tokenend);
+        if (ParseInt(token, tokenend))
+            keyframes.push_back(i);
+        i++;
+    }
+    if (i != n) {
+        LOG_ERROR("Invalid video index file: %s", indexfile);
+        pts.clear();
+        keyframes.clear();
+        return false;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool cVideoIndex::Save(const char* indexfile, const char* videofile) {
+    cTextWriter ofs;
+    long long size, mtime;
+    size_t i, k = 0;
+
+    if (!GetVideoFileStamp(videofile, &size, &mtime) || !ofs.Open(indexfile))
+        return false;
+    ofs << "# ratognize frame index of " << videofile << "\n"
+            << "# video file size, modification time and number of frames:\n"
+            << size << "\t" << mtime << "\t" << (int)pts.size() << "\n"
+            << "# framenum\tpts\tkeyframe\n";
+    for (i = 0; i < pts.size(); i++) {
+        bool bKey = (k < keyframes.size() && keyframes[k] == (int)i);
+        if (bKey)
+            k++;
+        ofs << (int)i << "\t" << pts[i] << "\t" << (bKey ? "1" : "0") << "\n";
+    }
+
+    return ofs.Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int cVideoIndex::KeyframeBefore(int framenum) const {
+    std::vector<int>::const_iterator it =
+            std::lower_bound(keyframes.begin(), keyframes.end(), framenum);
+    if (it == keyframes.begin())
+        return -1;
+
+    return *(it - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SeekVideoBeforeFrame(cv::VideoCapture& video, cVideoIndex& index,
+        int framenum, int* nextframe) {
+#ifdef VIDEOINDEX_SUPPORTED
+    int keyframe = index.KeyframeBefore(std::min(framenum, (int)index.pts.size()));
+    if (keyframe <= 0)
+        return false;
+    if (!video.set(cv::CAP_PROP_POS_FRAMES, keyframe) || !video.grab() ||
+            !CheckVideoFrame(video, index, keyframe))
+        return false;
+    *nextframe = keyframe + 1;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CheckVideoFrame(cv::VideoCapture& video, cVideoIndex& index, int framenum) {
+#ifdef VIDEOINDEX_SUPPORTED
+    if (framenum < 0 || framenum >= (int)index.pts.size())
+        return false;
+
+    return (long long)video.get(cv::CAP_PROP_PTS) == index.pts[framenum];
+#else
+    return false;
+#endif
+}
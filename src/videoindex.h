@@ -0,0 +1,62 @@
+#ifndef HEADER_VIDEOINDEX
+#define HEADER_VIDEOINDEX
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// file name tag of video index files (appended to the output file common part)
+#define VIDEOINDEXTAG ".frameindex"
+
+// Index of all frames of a video, in the order of linear reading (frame
+// numbers are the same as used everywhere else). It is built once with a
+// full pass over the video and is cached in a text file afterwards, which
+// is only used while the video file size and modification time match.
+class cVideoIndex {
+  public:
+    std::vector<long long> pts;     // presentation timestamp of each frame
+    std::vector<int> keyframes;     // frame numbers of keyframes (I frames), ascending
+    //! Constructor.
+    cVideoIndex() {
+    }
+    //! Destructor.
+    ~cVideoIndex() {
+    }
+    // read all frames of the video and store their timestamp and type
+    bool Build(const char* videofile);
+    // load index from cache file if it belongs to the current video file
+    bool Load(const char* indexfile, const char* videofile);
+    // save index to cache file
+    bool Save(const char* indexfile, const char* videofile);
+    // last keyframe with frame number less than framenum, -1 if none
+    int KeyframeBefore(int framenum) const;
+};
+
+/**
+ * Position video before a given frame using the frame index.
+ *
+ * The video is set to the last keyframe before the given frame, which is
+ * then read and its timestamp is checked against the index.
+ *
+ * \param video      the opened input video
+ * \param index      the frame index of the video
+ * \param framenum   the frame number to seek before
+ * \param nextframe  the frame number of the next frame read (if successful)
+ *
+ * \return true on success, false if seeking was not possible or not exact
+ */
+bool SeekVideoBeforeFrame(cv::VideoCapture& video, cVideoIndex& index,
+        int framenum, int* nextframe);
+
+/**
+ * Check whether the last frame read from the video is the given frame.
+ *
+ * \param video     the input video
+ * \param index     the frame index of the video
+ * \param framenum  the expected frame number of the last frame read
+ *
+ * \return true if timestamp of the last frame read matches the index
+ */
+bool CheckVideoFrame(cv::VideoCapture& video, cVideoIndex& index, int framenum);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef HEADER_WORKSPACE
+#define HEADER_WORKSPACE
+
+#include <opencv2/opencv.hpp>
+
+#include "bitmask.h"
+#include "blob.h"
+#include "blobfile.h"
+#include "constants.h"
+#include "light.h"
+#include "pipeline.h"
+#include "tracking.h"
+
+// All scratch images and state of the detection stage. It is created once
+// in OnInit() and passed down to the image processing functions, so that
+// no image is allocated on consecutive frames and no function-local static
+// is needed.
+class cWorkspace {
+  public:
+    cv::Mat labelimage;         // color label image, bit i is set where color i is found
+    cBitMask ratmask;           // mask containing only enlarged rat blobs
+    cBitMask motionmask;        // mask of the motion filter
+    cBitMask smallratmask;      // downscaled mask of rat blobs (ratdownscale only)
+    cv::Mat maskimage;          // binary mask image of rat blobs (tiled detection only)
+    cv::Mat ratimage;           // binary image of rat blobs (background filtered)
+    cv::Mat colorfilterimage[MAXMBASE]; // filter images of colors (tiled detection only)
+    cv::Mat smallratimage;      // downscaled binary image of rat blobs (ratdownscale only)
+    cv::Mat smallimage;         // downscaled smooth image for motion detection (ratdownscale only)
+    cv::Mat movingAverage;      // used by the motion detection filter (fixed-point)
+    cv::Mat LEDhsvimage;        // HSV image of the LED area
+    cv::Mat LEDfilterimage;     // binary image of the LED filter
+    cv::Mat LEDtmpimage;        // temporary image of the LED filter
+    cv::Mat rattmpimage;        // eroded rat image (tiled detection only)
+    cv::Mat colorbinimage[MAXMBASE]; // binary images of colors (tiled detection only)
+    cv::Mat colortmpimage[MAXMBASE]; // dilated images of colors (tiled detection only)
+    cComponentLabeler ratlabeler; // band by band labeling of rats (tiled detection only)
+    cComponentLabeler colorlabeler[MAXMBASE]; // and of colors
+    cComponentLabeler regionlabeler; // labeling of the mask to find rat regions
+    std::vector<cv::Rect> ratregions; // regions of colored blob detection
+    cBlobWorkspace blobws;      // scratch memory of blob finding in the detection thread
+    cBlobWorkspace colorws[MAXMBASE]; // and in the workers of parallel color detection
+    cWorkerPool colorworkers;   // worker threads of parallel color detection
+    tBlob colorparticles[MAXMBASE]; // blobs of each color of parallel color detection
+    cTextWriter colorlog[MAXMBASE]; // and their log lines
+    cBlobFrame blobframe;       // blob file columns read from binary input (bProcessText only)
+    cTracking tracking;         // blobs of the previous frame (tracking mode only)
+    lighttype_t lastLight;      // light setting of the last LED detection
+    //! Constructor.
+    cWorkspace() {
+        lastLight = UNINITIALIZEDLIGHT;
+    }
+    //! Destructor.
+    ~cWorkspace() {
+    }
+    // create all images of the given (ROI) size
+    void Create(cv::Size size) {
+        labelimage.create(size, CV_8UC1);
+        maskimage.create(size, CV_8UC1);
+        ratimage.create(size, CV_8UC1);
+        for (int i = 0; i < MAXMBASE; i++)
+            colorfilterimage[i].create(size, CV_8UC1);
+        tracking.Reset();
+        lastLight = UNINITIALIZEDLIGHT;
+    }
+    // reserve memory for the given number of blobs of each color
+    void ReserveBlobs(size_t colorblobs) {
+        for (int i = 0; i < MAXMBASE; i++)
+            colorparticles[i].reserve(colorblobs);
+    }
+};
+
+#endif